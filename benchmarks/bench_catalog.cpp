@@ -0,0 +1,93 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+// Completion on a schema of many tables: the schema check paid by every
+// complete_request, a full rebuild of the catalog and the lookups.
+
+#include <string>
+#include <utility>
+
+#include <benchmark/benchmark.h>
+
+#include "xeus-sqlite/xcatalog.hpp"
+
+namespace xeus_sqlite
+{
+namespace bench
+{
+    /* Database with the given number of tables of 8 columns each */
+    static SQLite::Database& wide_schema_db(std::int64_t tables)
+    {
+        static SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+        static std::int64_t current_tables = 0;
+        if (current_tables < tables)
+        {
+            db.exec("BEGIN");
+            for (std::int64_t i = current_tables; i < tables; ++i)
+            {
+                std::string name = "table_" + std::to_string(i);
+                db.exec("CREATE TABLE " + name + "(id INTEGER PRIMARY KEY, name TEXT, "
+                        "created_at TEXT, amount REAL, category TEXT, flag INTEGER, "
+                        "payload BLOB, comment TEXT)");
+                db.exec("CREATE INDEX " + name + "_category ON " + name + "(category)");
+            }
+            db.exec("COMMIT");
+            current_tables = tables;
+        }
+        return db;
+    }
+
+    static void BM_catalog_refresh(benchmark::State& state)
+    {
+        SQLite::Database& db = wide_schema_db(state.range(0));
+        catalog names;
+        names.refresh(db);
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(names.refresh(db));
+        }
+    }
+    BENCHMARK(BM_catalog_refresh)->Arg(5000)->Unit(benchmark::kMicrosecond);
+
+    static void BM_catalog_rebuild(benchmark::State& state)
+    {
+        SQLite::Database& db = wide_schema_db(state.range(0));
+        for (auto _ : state)
+        {
+            catalog names;
+            names.refresh(db);
+            benchmark::DoNotOptimize(names.size());
+        }
+    }
+    BENCHMARK(BM_catalog_rebuild)->Arg(5000)->Unit(benchmark::kMillisecond);
+
+    static void BM_catalog_complete(benchmark::State& state)
+    {
+        SQLite::Database& db = wide_schema_db(state.range(0));
+        catalog names;
+        names.refresh(db);
+        /* Code and cursor position */
+        const std::pair<std::string, std::size_t> requests[] =
+        {
+            {"SELECT * FROM table_42", 22},
+            {"SELECT t.cat FROM table_4242 t", 12},
+            {"SELECT * FROM table_7 WHERE am", 30}
+        };
+        for (auto _ : state)
+        {
+            for (const auto& request : requests)
+            {
+                benchmark::DoNotOptimize(names.complete(request.first, request.second));
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * 3);
+    }
+    BENCHMARK(BM_catalog_complete)->Arg(5000)->Unit(benchmark::kMicrosecond);
+}
+}
@@ -0,0 +1,93 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+// Statistical functions against the plain SQL computing the same value,
+// on the analytics table of bench_utils.hpp.
+
+#include <cstdint>
+
+#include <benchmark/benchmark.h>
+
+#include "xeus-sqlite/xfunctions.hpp"
+
+#include "bench_utils.hpp"
+
+namespace xeus_sqlite
+{
+namespace bench
+{
+    constexpr std::int64_t function_rows = 1000000;
+
+    static SQLite::Database& analytics_db()
+    {
+        static SQLite::Database db = []()
+        {
+            SQLite::Database res(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+            register_functions(res);
+            fill_analytics_table(res, function_rows);
+            return res;
+        }();
+        return db;
+    }
+
+    static void BM_function_query(benchmark::State& state, const char* sql)
+    {
+        SQLite::Database& db = analytics_db();
+        for (auto _ : state)
+        {
+            SQLite::Statement query(db, sql);
+            while (query.executeStep())
+            {
+                benchmark::DoNotOptimize(query.getColumn(0).getDouble());
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * function_rows);
+    }
+
+    BENCHMARK_CAPTURE(BM_function_query, median,
+        "SELECT median(amount) FROM analytics")->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(BM_function_query, median_sql,
+        "SELECT avg(amount) FROM (SELECT amount FROM analytics ORDER BY amount "
+        "LIMIT 2 - (SELECT count(*) FROM analytics) % 2 "
+        "OFFSET ((SELECT count(*) FROM analytics) - 1) / 2)")->Unit(benchmark::kMillisecond);
+
+    BENCHMARK_CAPTURE(BM_function_query, percentile_cont,
+        "SELECT percentile_cont(amount, 0.9) FROM analytics")->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(BM_function_query, percentile_cont_sql,
+        "SELECT amount FROM analytics ORDER BY amount "
+        "LIMIT 1 OFFSET (SELECT CAST(0.9 * (count(*) - 1) AS INTEGER) FROM analytics)")
+        ->Unit(benchmark::kMillisecond);
+
+    BENCHMARK_CAPTURE(BM_function_query, stddev,
+        "SELECT stddev(amount) FROM analytics")->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(BM_function_query, stddev_sql,
+        "SELECT sqrt((sum(amount * amount) - sum(amount) * sum(amount) / count(amount)) "
+        "/ (count(amount) - 1)) FROM analytics")->Unit(benchmark::kMillisecond);
+
+    BENCHMARK_CAPTURE(BM_function_query, corr,
+        "SELECT corr(amount, quantity) FROM analytics")->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(BM_function_query, corr_sql,
+        "SELECT (count(*) * sum(amount * quantity) - sum(amount) * sum(quantity)) "
+        "/ sqrt((count(*) * sum(amount * amount) - sum(amount) * sum(amount)) "
+        "* (count(*) * sum(quantity * quantity) - sum(quantity) * sum(quantity))) "
+        "FROM analytics")->Unit(benchmark::kMillisecond);
+
+    BENCHMARK_CAPTURE(BM_function_query, histogram,
+        "SELECT histogram(amount, 20) FROM analytics")->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(BM_function_query, histogram_sql,
+        "WITH bounds AS (SELECT min(amount) AS lo, (max(amount) - min(amount)) / 20 AS width "
+        "FROM analytics) SELECT min(CAST((amount - lo) / width AS INTEGER), 19) AS bin, count(*) "
+        "FROM analytics, bounds GROUP BY bin")->Unit(benchmark::kMillisecond);
+
+    BENCHMARK_CAPTURE(BM_function_query, approx_count_distinct,
+        "SELECT approx_count_distinct(label) FROM analytics")->Unit(benchmark::kMillisecond);
+    BENCHMARK_CAPTURE(BM_function_query, count_distinct_sql,
+        "SELECT count(DISTINCT label) FROM analytics")->Unit(benchmark::kMillisecond);
+}
+}
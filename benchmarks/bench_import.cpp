@@ -0,0 +1,89 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+// Throughput of %IMPORT on a 10 column numeric CSV, in rows per second.
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "xeus-sqlite/ximport.hpp"
+
+namespace xeus_sqlite
+{
+namespace bench
+{
+    static const std::string& numeric_csv(std::int64_t rows)
+    {
+        static const std::string path = "bench_import.csv";
+        static std::int64_t current_rows = -1;
+        if (current_rows != rows)
+        {
+            std::ofstream file(path, std::ios::out | std::ios::trunc);
+            file << "c0,c1,c2,c3,c4,c5,c6,c7,c8,c9\n";
+            for (std::int64_t row = 0; row < rows; ++row)
+            {
+                for (int col = 0; col < 10; ++col)
+                {
+                    file << (col == 0 ? "" : ",");
+                    if (col % 2 == 0)
+                    {
+                        file << row * 7 + col;
+                    }
+                    else
+                    {
+                        file << (row % 1000) * 0.25 + col;
+                    }
+                }
+                file << '\n';
+            }
+            current_rows = rows;
+        }
+        return path;
+    }
+
+    static void BM_delimited_scanner(benchmark::State& state)
+    {
+        mapped_file file(numeric_csv(state.range(0)));
+        std::vector<std::string_view> fields;
+        for (auto _ : state)
+        {
+            delimited_scanner scanner(file.data(), file.size(), ',');
+            while (scanner.next_record(fields))
+            {
+                benchmark::DoNotOptimize(fields.data());
+            }
+        }
+        state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(file.size()));
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_delimited_scanner)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+    static void BM_import_file(benchmark::State& state)
+    {
+        const std::string& path = numeric_csv(state.range(0));
+        import_options options;
+        options.relax_durability = true;
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            std::remove("bench_import.db");
+            SQLite::Database db("bench_import.db", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+            state.ResumeTiming();
+
+            import_file(db, path, "numbers", options, nullptr);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        std::remove("bench_import.db");
+    }
+    BENCHMARK(BM_import_file)->Arg(1000000)->Unit(benchmark::kMillisecond);
+}
+}
@@ -0,0 +1,163 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+// Drives interpreter::execute_request_impl and complete_request_impl the
+// way the kernel does, with a stub reply callback and a publisher capturing
+// the published messages instead of sending them. Every published message
+// is serialized, as the kernel would before sending it.
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "xeus-sqlite/xeus_sqlite_interpreter.hpp"
+
+#include "bench_utils.hpp"
+
+namespace xeus_sqlite
+{
+namespace bench
+{
+    class bench_interpreter : public interpreter
+    {
+    public:
+
+        bench_interpreter()
+        {
+            register_publisher([this](const std::string&, nl::json, nl::json content, auto&&)
+            {
+                ++m_messages;
+                m_bytes += content.dump().size();
+            });
+        }
+
+        /* Runs a cell, returns false if the reply isn't "ok" */
+        bool execute(const std::string& code)
+        {
+            bool ok = false;
+            execute_request_impl([&ok](nl::json reply) { ok = reply["status"] == "ok"; },
+                                 1, code, xeus::execute_request_config{false, true, false},
+                                 nl::json::object());
+            return ok;
+        }
+
+        nl::json complete(const std::string& code)
+        {
+            return complete_request_impl(code, static_cast<int>(code.size()));
+        }
+
+        std::size_t messages() const noexcept
+        {
+            return m_messages;
+        }
+
+        std::size_t bytes() const noexcept
+        {
+            return m_bytes;
+        }
+
+    private:
+
+        std::size_t m_messages = 0;
+        std::size_t m_bytes = 0;
+    };
+
+    /* Interpreter with the analytics table of the given size loaded */
+    static bench_interpreter& loaded_interpreter(std::int64_t rows)
+    {
+        static const std::string path = "bench_interpreter.db";
+        static std::unique_ptr<bench_interpreter> instance;
+        static std::int64_t current_rows = -1;
+        if (current_rows != rows)
+        {
+            instance.reset();
+            std::remove(path.c_str());
+            {
+                SQLite::Database db(path, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+                fill_analytics_table(db, rows);
+                db.exec("CREATE INDEX analytics_id ON analytics(id)");
+            }
+            instance = std::make_unique<bench_interpreter>();
+            instance->execute("%LOAD " + path + " rw");
+            current_rows = rows;
+        }
+        return *instance;
+    }
+
+    static void run_cell(benchmark::State& state, std::int64_t rows, const std::string& code)
+    {
+        bench_interpreter& kernel = loaded_interpreter(rows);
+        std::size_t bytes = kernel.bytes();
+        for (auto _ : state)
+        {
+            if (!kernel.execute(code))
+            {
+                state.SkipWithError("The cell failed");
+                break;
+            }
+        }
+        state.counters["bytes_per_cell"] = benchmark::Counter(
+            static_cast<double>(kernel.bytes() - bytes), benchmark::Counter::kAvgIterations);
+    }
+
+    static void BM_point_query(benchmark::State& state)
+    {
+        run_cell(state, 100000, "SELECT * FROM analytics WHERE id = 4242");
+    }
+    BENCHMARK(BM_point_query);
+
+    static void BM_wide_scan(benchmark::State& state)
+    {
+        run_cell(state, 100000, "SELECT * FROM analytics LIMIT " + std::to_string(state.range(0)));
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_wide_scan)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+    static void BM_large_result(benchmark::State& state)
+    {
+        run_cell(state, state.range(0), "SELECT * FROM analytics");
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_large_result)->Arg(1000000)->Iterations(3)->Unit(benchmark::kMillisecond);
+
+    static void BM_magic_parsing(benchmark::State& state)
+    {
+        run_cell(state, 1000, "%TRANSACTION off");
+    }
+    BENCHMARK(BM_magic_parsing);
+
+    static void BM_batch(benchmark::State& state)
+    {
+        run_cell(state, 1000, "UPDATE analytics SET quantity = quantity WHERE id = 1; "
+                              "SELECT count(*) FROM analytics");
+    }
+    BENCHMARK(BM_batch);
+
+    static void BM_complete_request(benchmark::State& state)
+    {
+        bench_interpreter& kernel = loaded_interpreter(1000);
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(kernel.complete("SELECT * FROM analytics WHERE cat"));
+        }
+    }
+    BENCHMARK(BM_complete_request);
+
+    static void BM_xvega(benchmark::State& state)
+    {
+        run_cell(state, 100000,
+                 "%XVEGA_PLOT X_FIELD category Y_FIELD amount MARK bar WIDTH 200 HEIGHT 200 "
+                 "<> SELECT category, amount FROM analytics LIMIT " + std::to_string(state.range(0)));
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+    BENCHMARK(BM_xvega)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+}
+}
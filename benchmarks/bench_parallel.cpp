@@ -0,0 +1,64 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+// %PARALLEL fan-out: eight CPU bound aggregates over a WAL database run
+// on 1, 2, 4 and 8 threads, each thread with its own read only connection.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "xeus-sqlite/xparallel.hpp"
+
+#include "bench_utils.hpp"
+
+namespace xeus_sqlite
+{
+namespace bench
+{
+    static const std::string& analytics_wal_db()
+    {
+        static const std::string path = []()
+        {
+            std::string file = "bench_parallel.db";
+            std::remove(file.c_str());
+            SQLite::Database db(file, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+            db.exec("PRAGMA journal_mode = WAL");
+            fill_analytics_table(db, 200000);
+            return file;
+        }();
+        return path;
+    }
+
+    static void BM_parallel_query(benchmark::State& state)
+    {
+        std::size_t threads = static_cast<std::size_t>(state.range(0));
+        connection_pool connections(analytics_wal_db(), threads);
+        work_stealing_pool workers(threads);
+        std::vector<std::string> statements;
+        for (int i = 0; i < 8; ++i)
+        {
+            statements.push_back("SELECT category, sum(amount * " + std::to_string(i + 1)
+                                 + "), avg(quantity) FROM analytics GROUP BY category");
+        }
+        for (auto _ : state)
+        {
+            parallel_query(connections, workers, statements, [](std::size_t, result_table& result)
+            {
+                benchmark::DoNotOptimize(result.rows());
+            });
+        }
+        state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(statements.size()));
+    }
+    BENCHMARK(BM_parallel_query)->Arg(1)->Arg(2)->Arg(4)->Arg(8)
+        ->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+}
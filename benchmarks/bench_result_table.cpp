@@ -0,0 +1,187 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+// Compares the former triple materialization of process_SQLite_input
+// (tabulate table, HTML stream and string dataframe filled row by row) with
+// the single pass result_table. peak_heap_MB is the most heap held at once by
+// a run of the benchmark and allocated_MB the heap allocated per iteration,
+// see heap_scope.
+// BM_render_budget renders a filled result without bound (second argument
+// 0) and within the display budget of the kernel (1).
+// BM_result_transport compares the bytes published for a whole result as
+// text/plain and text/html (second argument 0) with its Arrow stream read
+// in the same pass (1).
+
+#include <sstream>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "tabulate/table.hpp"
+#include "xvega/xvega.hpp"
+
+#include "xeus-sqlite/xexport.hpp"
+#include "xeus-sqlite/xresult_table.hpp"
+
+#include "bench_utils.hpp"
+
+namespace xeus_sqlite
+{
+namespace bench
+{
+    static SQLite::Database& analytics_db(std::int64_t rows)
+    {
+        static SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+        static std::int64_t current_rows = -1;
+        if (current_rows != rows)
+        {
+            fill_analytics_table(db, rows);
+            current_rows = rows;
+        }
+        return db;
+    }
+
+    static void BM_legacy_materialization(benchmark::State& state)
+    {
+        SQLite::Database& db = analytics_db(state.range(0));
+        heap_scope heap;
+        for (auto _ : state)
+        {
+            SQLite::Statement query(db, "SELECT * FROM analytics");
+            tabulate::Table plain_table;
+            std::stringstream html_table("");
+            xv::df_type xv_sqlite_df;
+
+            tabulate::Table::Row_t col_names;
+            html_table << "<table>\n<tr>\n";
+            for (int col = 0; col < query.getColumnCount(); col++)
+            {
+                std::string name = query.getColumnName(col);
+                col_names.push_back(name);
+                html_table << "<th>" << name << "</th>\n";
+                xv_sqlite_df[name] = { "name" };
+            }
+            plain_table.add_row(col_names);
+            html_table << "</tr>\n";
+
+            while (query.executeStep())
+            {
+                html_table << "<tr>\n";
+                tabulate::Table::Row_t row;
+                for (int col = 0; col < query.getColumnCount(); col++)
+                {
+                    std::string col_name = query.getColumnName(col);
+                    std::string cell = query.getColumn(col);
+                    row.push_back(cell);
+                    html_table << "<td>" << cell << "</td>\n";
+                    xv_sqlite_df[col_name].push_back(cell);
+                }
+                html_table << "</tr>\n";
+                plain_table.add_row(row);
+            }
+            html_table << "</table>";
+
+            std::string plain = plain_table.str();
+            std::string html = html_table.str();
+            benchmark::DoNotOptimize(plain);
+            benchmark::DoNotOptimize(html);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        heap.report(state);
+    }
+
+    static void BM_result_table(benchmark::State& state)
+    {
+        SQLite::Database& db = analytics_db(state.range(0));
+        heap_scope heap;
+        for (auto _ : state)
+        {
+            SQLite::Statement query(db, "SELECT * FROM analytics");
+            result_table result;
+            result.fill(query);
+
+            std::string plain = result.to_plain();
+            std::string html = result.to_html();
+            benchmark::DoNotOptimize(plain);
+            benchmark::DoNotOptimize(html);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        heap.report(state);
+    }
+
+    static void BM_result_table_fill(benchmark::State& state)
+    {
+        SQLite::Database& db = analytics_db(state.range(0));
+        heap_scope heap;
+        for (auto _ : state)
+        {
+            SQLite::Statement query(db, "SELECT * FROM analytics");
+            result_table result;
+            benchmark::DoNotOptimize(result.fill(query));
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        heap.report(state);
+    }
+
+    static void BM_render_budget(benchmark::State& state)
+    {
+        SQLite::Database& db = analytics_db(state.range(0));
+        SQLite::Statement query(db, "SELECT * FROM analytics");
+        result_table result;
+        result.fill(query);
+
+        display_budget budget;
+        if (state.range(1) != 0)
+        {
+            budget = {60, 40, 1 << 20};
+        }
+        for (auto _ : state)
+        {
+            std::string plain = result.to_plain(budget);
+            std::string html = result.to_html(budget);
+            benchmark::DoNotOptimize(plain);
+            benchmark::DoNotOptimize(html);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+    }
+
+    static void BM_result_transport(benchmark::State& state)
+    {
+        SQLite::Database& db = analytics_db(state.range(0));
+        std::size_t bytes = 0;
+        for (auto _ : state)
+        {
+            SQLite::Statement query(db, "SELECT * FROM analytics");
+            result_table result;
+            if (state.range(1) == 0)
+            {
+                result.fill(query);
+                nl::json pub_data = result.mime_bundle();
+                bytes = pub_data["text/plain"].get_ref<const std::string&>().size()
+                      + pub_data["text/html"].get_ref<const std::string&>().size();
+            }
+            else
+            {
+                message_buffers messages;
+                bytes = stream_query(query, result, messages).bytes;
+            }
+            benchmark::DoNotOptimize(bytes);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.counters["published_MB"] = bytes / (1024. * 1024.);
+    }
+
+    BENCHMARK(BM_legacy_materialization)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+    BENCHMARK(BM_result_table)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+    BENCHMARK(BM_result_table_fill)->Arg(10000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+    BENCHMARK(BM_render_budget)->Args({10000, 0})->Args({10000, 1})->Args({1000000, 0})->Args({1000000, 1})
+                               ->Unit(benchmark::kMillisecond);
+    BENCHMARK(BM_result_transport)->Args({1000000, 0})->Args({1000000, 1})->Unit(benchmark::kMillisecond);
+}
+}
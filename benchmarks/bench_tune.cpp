@@ -0,0 +1,101 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+// Queries and a bulk insert on a copy of examples/chinook.db, opened with
+// the SQLite defaults (profile 0) and with each %TUNE profile: 1 analytics,
+// 2 bulkload, 3 safe.
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "xeus-sqlite/xtune.hpp"
+
+#ifndef XSQL_BENCH_CHINOOK_DB
+#define XSQL_BENCH_CHINOOK_DB "examples/chinook.db"
+#endif
+
+namespace xeus_sqlite
+{
+namespace bench
+{
+    static const char* const tuned_profiles[] = {"", "analytics", "bulkload", "safe"};
+
+    /* Fresh copy of chinook.db opened with the profile of the benchmark */
+    static std::unique_ptr<SQLite::Database> tuned_chinook(benchmark::State& state)
+    {
+        static const std::string path = "bench_tune.db";
+        std::remove((path + "-wal").c_str());
+        std::remove((path + "-shm").c_str());
+        {
+            std::ifstream source(XSQL_BENCH_CHINOOK_DB, std::ios::binary);
+            std::ofstream copy(path, std::ios::binary | std::ios::trunc);
+            copy << source.rdbuf();
+        }
+        auto db = std::make_unique<SQLite::Database>(path, SQLite::OPEN_READWRITE);
+        const char* profile = tuned_profiles[state.range(0)];
+        if (profile[0] != '\0')
+        {
+            apply_tuning_profile(*db, find_tuning_profile(profile));
+        }
+        state.SetLabel(profile[0] != '\0' ? profile : "defaults");
+        return db;
+    }
+
+    static void BM_tuned_query(benchmark::State& state, const char* sql)
+    {
+        std::unique_ptr<SQLite::Database> db = tuned_chinook(state);
+        for (auto _ : state)
+        {
+            SQLite::Statement query(*db, sql);
+            while (query.executeStep())
+            {
+                benchmark::DoNotOptimize(query.getColumn(0).getText());
+            }
+        }
+    }
+
+    BENCHMARK_CAPTURE(BM_tuned_query, revenue_by_country,
+        "SELECT c.Country, sum(ii.UnitPrice * ii.Quantity) FROM invoice_items ii "
+        "JOIN invoices i ON ii.InvoiceId = i.InvoiceId "
+        "JOIN customers c ON i.CustomerId = c.CustomerId "
+        "GROUP BY c.Country ORDER BY 2 DESC")->DenseRange(0, 3)->Unit(benchmark::kMicrosecond);
+
+    BENCHMARK_CAPTURE(BM_tuned_query, sort_text,
+        "SELECT Name, Composer FROM tracks ORDER BY Composer, Name")
+        ->DenseRange(0, 3)->Unit(benchmark::kMicrosecond);
+
+    BENCHMARK_CAPTURE(BM_tuned_query, window_rank,
+        "SELECT TrackId, rank() OVER (PARTITION BY GenreId ORDER BY Milliseconds DESC) "
+        "FROM tracks")->DenseRange(0, 3)->Unit(benchmark::kMicrosecond);
+
+    /* One transaction copying the tracks, the synchronous and journal
+       settings weigh on the commit */
+    static void BM_tuned_insert(benchmark::State& state)
+    {
+        std::unique_ptr<SQLite::Database> db = tuned_chinook(state);
+        db->exec("CREATE TABLE tracks_copy AS SELECT * FROM tracks WHERE 0");
+        for (auto _ : state)
+        {
+            db->exec("BEGIN");
+            db->exec("INSERT INTO tracks_copy SELECT * FROM tracks");
+            db->exec("COMMIT");
+        }
+        state.SetItemsProcessed(state.iterations() * db->execAndGet("SELECT count(*) FROM tracks").getInt64());
+        db.reset();
+        std::remove("bench_tune.db");
+        std::remove("bench_tune.db-wal");
+        std::remove("bench_tune.db-shm");
+    }
+    BENCHMARK(BM_tuned_insert)->DenseRange(0, 3)->Unit(benchmark::kMicrosecond);
+}
+}
@@ -0,0 +1,87 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_BENCH_UTILS_HPP
+#define XEUS_SQLITE_BENCH_UTILS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+namespace xeus_sqlite
+{
+namespace bench
+{
+    /* Bytes of the blocks allocated through operator new, which main.cpp
+       replaces to count them */
+    struct heap_usage
+    {
+        std::size_t current;
+        std::size_t peak;
+        std::size_t allocated;
+    };
+
+    heap_usage current_heap_usage() noexcept;
+
+    /* Starts a new peak from the current usage */
+    void reset_heap_peak() noexcept;
+
+    /*! \brief heap_scope - heap used by one run of a benchmark.
+     *
+     * Unlike the peak RSS of the process, which never goes down, the peak
+     * restarts with each scope, so that a benchmark isn't charged with the
+     * peak of the ones that ran before it. Memory allocated by SQLite with
+     * malloc isn't counted.
+     */
+    class heap_scope
+    {
+    public:
+
+        heap_scope() noexcept
+        {
+            reset_heap_peak();
+            m_start = current_heap_usage();
+        }
+
+        /* Sets peak_heap_MB, the most bytes held at once above the usage at
+           the start of the scope, and allocated_MB, the bytes allocated per
+           iteration */
+        void report(benchmark::State& state) const
+        {
+            heap_usage end = current_heap_usage();
+            const double megabyte = 1024. * 1024.;
+            state.counters["peak_heap_MB"] = (end.peak - m_start.current) / megabyte;
+            state.counters["allocated_MB"] = benchmark::Counter((end.allocated - m_start.allocated) / megabyte,
+                                                                benchmark::Counter::kAvgIterations);
+        }
+
+    private:
+
+        heap_usage m_start;
+    };
+
+    /* Fills table "analytics" with rows of mixed integer, real and text cells */
+    inline void fill_analytics_table(SQLite::Database& db, std::int64_t rows)
+    {
+        db.exec("DROP TABLE IF EXISTS analytics");
+        db.exec("CREATE TABLE analytics(id INTEGER, amount REAL, label TEXT, "
+                "category TEXT, quantity INTEGER)");
+        db.exec("WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 "
+                "FROM seq WHERE n < " + std::to_string(rows) + ") "
+                "INSERT INTO analytics SELECT n, n * 1.25, 'label_' || n, "
+                "'category_' || (n % 17), n % 1000 FROM seq");
+    }
+}
+}
+
+#endif
@@ -0,0 +1,145 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+// Compares the chart values of a XVEGA_PLOT built from every row of the
+// query (second argument 0) with the values reduced within the default
+// budget of 5000 points, for a scatter (1), a line (2) and a bar chart
+// averaging a category (3). values_MB is the size of the JSON sent.
+// BM_xvega_spec builds the data.values of a chart over every row: from the
+// former dataframe of strings seeded with a "name" row (second argument 0),
+// from a result_table (1) and from a typed dataframe (2). spec_MB is the
+// size of the serialized values. peak_heap_MB and allocated_MB measure the
+// heap used by each run, see heap_scope.
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "xeus-sqlite/xdataframe.hpp"
+#include "xeus-sqlite/xresult_table.hpp"
+#include "xeus-sqlite/xvega_sqlite.hpp"
+
+#include "bench_utils.hpp"
+
+namespace xeus_sqlite
+{
+namespace bench
+{
+    static SQLite::Database& chart_db(std::int64_t rows)
+    {
+        static SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+        static std::int64_t current_rows = -1;
+        if (current_rows != rows)
+        {
+            fill_analytics_table(db, rows);
+            current_rows = rows;
+        }
+        return db;
+    }
+
+    static void BM_xvega_values(benchmark::State& state)
+    {
+        SQLite::Database& db = chart_db(state.range(0));
+        const std::string sql = "SELECT * FROM analytics";
+        const std::vector<std::vector<std::string>> inputs = {
+            {"X_FIELD", "id", "Y_FIELD", "amount", "MARK", "point"},
+            {"X_FIELD", "id", "Y_FIELD", "amount", "MARK", "point"},
+            {"X_FIELD", "id", "Y_FIELD", "amount", "MARK", "line"},
+            {"X_FIELD", "category", "Y_FIELD", "amount", "AGGREGATE", "mean", "MARK", "bar"}
+        };
+        auto encoding = xv_sqlite::parse_encoding(inputs[state.range(1)]);
+        std::size_t bytes = 0;
+        heap_scope heap;
+        for (auto _ : state)
+        {
+            nl::json values;
+            if (state.range(1) == 0)
+            {
+                SQLite::Statement query(db, sql);
+                result_table result;
+                result.fill(query);
+                values = result.to_records();
+            }
+            else
+            {
+                auto reduction = xv_sqlite::plan_reduction(db, encoding, sql, 5000);
+                SQLite::Statement query(db, reduction.query);
+                values = xv_sqlite::chart_values(query, reduction, 5000);
+            }
+            bytes = values.dump().size();
+            benchmark::DoNotOptimize(bytes);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.counters["values_MB"] = bytes / (1024. * 1024.);
+        heap.report(state);
+    }
+
+    static void BM_xvega_spec(benchmark::State& state)
+    {
+        SQLite::Database& db = chart_db(state.range(0));
+        const std::string sql = "SELECT id, amount, category FROM analytics";
+        std::size_t bytes = 0;
+        heap_scope heap;
+        for (auto _ : state)
+        {
+            SQLite::Statement query(db, sql);
+            nl::json values = nl::json::array();
+            if (state.range(1) == 0)
+            {
+                xv::df_type df;
+                for (int col = 0; col < query.getColumnCount(); ++col)
+                {
+                    df[query.getColumnName(col)] = { "name" };
+                }
+                while (query.executeStep())
+                {
+                    for (int col = 0; col < query.getColumnCount(); ++col)
+                    {
+                        df[query.getColumnName(col)].push_back(query.getColumn(col).getString());
+                    }
+                }
+                std::size_t rows = df.begin()->second.size();
+                for (std::size_t row = 0; row < rows; ++row)
+                {
+                    nl::json record = nl::json::object();
+                    for (const auto& column : df)
+                    {
+                        record[column.first] = column.second[row];
+                    }
+                    values.push_back(std::move(record));
+                }
+            }
+            else if (state.range(1) == 1)
+            {
+                result_table result;
+                result.fill(query);
+                values = result.to_records();
+            }
+            else
+            {
+                dataframe frame;
+                frame.fill(query);
+                values = frame.to_values();
+            }
+            bytes = values.dump().size();
+            benchmark::DoNotOptimize(bytes);
+        }
+        state.SetItemsProcessed(state.iterations() * state.range(0));
+        state.counters["spec_MB"] = bytes / (1024. * 1024.);
+        heap.report(state);
+    }
+
+    BENCHMARK(BM_xvega_spec)->Args({1000000, 0})->Args({1000000, 1})->Args({1000000, 2})
+                            ->Unit(benchmark::kMillisecond);
+    BENCHMARK(BM_xvega_values)->Args({100000, 0})->Args({100000, 1})->Args({100000, 2})->Args({100000, 3})
+                              ->Args({1000000, 0})->Args({1000000, 1})->Args({1000000, 2})->Args({1000000, 3})
+                              ->Unit(benchmark::kMillisecond);
+}
+}
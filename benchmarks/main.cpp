@@ -0,0 +1,128 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#include <benchmark/benchmark.h>
+
+#include "bench_utils.hpp"
+
+namespace
+{
+    std::atomic<std::size_t> current_bytes(0);
+    std::atomic<std::size_t> peak_bytes(0);
+    std::atomic<std::size_t> allocated_bytes(0);
+
+    /* The size of a block is stored in front of it, the header keeps the
+       alignment of malloc */
+    constexpr std::size_t header_size = alignof(std::max_align_t);
+
+    void* counted_alloc(std::size_t size) noexcept
+    {
+        void* block = std::malloc(size + header_size);
+        if (block == nullptr)
+        {
+            return nullptr;
+        }
+        *static_cast<std::size_t*>(block) = size;
+        allocated_bytes += size;
+        std::size_t current = current_bytes += size;
+        std::size_t peak = peak_bytes.load();
+        while (current > peak && !peak_bytes.compare_exchange_weak(peak, current))
+        {
+        }
+        return static_cast<char*>(block) + header_size;
+    }
+
+    void counted_free(void* ptr) noexcept
+    {
+        if (ptr != nullptr)
+        {
+            void* block = static_cast<char*>(ptr) - header_size;
+            current_bytes -= *static_cast<std::size_t*>(block);
+            std::free(block);
+        }
+    }
+}
+
+namespace xeus_sqlite
+{
+namespace bench
+{
+    heap_usage current_heap_usage() noexcept
+    {
+        return {current_bytes.load(), peak_bytes.load(), allocated_bytes.load()};
+    }
+
+    void reset_heap_peak() noexcept
+    {
+        peak_bytes = current_bytes.load();
+    }
+}
+}
+
+void* operator new(std::size_t size)
+{
+    void* ptr = counted_alloc(size);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_alloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_alloc(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    counted_free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    counted_free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    counted_free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    counted_free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    counted_free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    counted_free(ptr);
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,65 @@
+############################################################################
+# Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              #
+#                                                                          #
+#                                                                          #
+# Distributed under the terms of the BSD 3-Clause License.                 #
+#                                                                          #
+# The full license is in the file LICENSE, distributed with this software. #
+############################################################################
+
+# Runs the query suite built with both SQLite profiles and reports the
+# median time of every query under each of them.
+# Usage: cmake -DDIAGNOSTICS=<exe> -DPERFORMANCE=<exe> -DDATABASE=<db>
+#              [-DITERATIONS=<n>] -P compare_profiles.cmake
+
+cmake_policy(SET CMP0054 NEW)
+
+if (NOT ITERATIONS)
+    set(ITERATIONS 20)
+endif ()
+
+foreach(profile DIAGNOSTICS PERFORMANCE)
+    execute_process(COMMAND ${${profile}} ${DATABASE} ${ITERATIONS}
+                    OUTPUT_VARIABLE output
+                    RESULT_VARIABLE result)
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "The ${profile} query suite failed: ${result}")
+    endif ()
+
+    string(REPLACE "\n" ";" lines "${output}")
+    foreach(line ${lines})
+        if (line MATCHES "^([a-z_]+)\t([0-9]+)$")
+            set(${profile}_${CMAKE_MATCH_1} ${CMAKE_MATCH_2})
+            if (profile STREQUAL "DIAGNOSTICS")
+                list(APPEND queries ${CMAKE_MATCH_1})
+            endif ()
+        elseif (line MATCHES "^# (.*)$")
+            message(STATUS "${CMAKE_MATCH_1}")
+        endif ()
+    endforeach()
+endforeach()
+
+set(diagnostics_total 0)
+set(performance_total 0)
+message(STATUS "query                  diagnostics (us)  performance (us)  speedup (%)")
+foreach(query ${queries})
+    set(diagnostics ${DIAGNOSTICS_${query}})
+    set(performance ${PERFORMANCE_${query}})
+    math(EXPR diagnostics_total "${diagnostics_total} + ${diagnostics}")
+    math(EXPR performance_total "${performance_total} + ${performance}")
+    if (performance GREATER 0)
+        math(EXPR speedup "(${diagnostics} - ${performance}) * 100 / ${performance}")
+    else ()
+        set(speedup "-")
+    endif ()
+
+    string(SUBSTRING "${query}                       " 0 23 query_column)
+    string(SUBSTRING "${diagnostics}                  " 0 18 diagnostics_column)
+    string(SUBSTRING "${performance}                  " 0 18 performance_column)
+    message(STATUS "${query_column}${diagnostics_column}${performance_column}${speedup}")
+endforeach()
+
+if (performance_total GREATER 0)
+    math(EXPR speedup "(${diagnostics_total} - ${performance_total}) * 100 / ${performance_total}")
+    message(STATUS "Total: ${diagnostics_total} us with diagnostics, ${performance_total} us with performance, ${speedup}% faster")
+endif ()
@@ -0,0 +1,130 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+// Runs a fixed query suite on the chinook database and prints the median
+// time of every query, one "name<TAB>microseconds" line each. Built once
+// per SQLite build profile, see compare_profiles.cmake.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "sqlite3.h"
+
+#ifndef XSQL_BENCH_PROFILE
+#define XSQL_BENCH_PROFILE "unknown"
+#endif
+
+namespace
+{
+    struct bench_query
+    {
+        const char* name;
+        const char* sql;
+    };
+
+    const bench_query query_suite[] =
+    {
+        {"scan_tracks",
+         "SELECT * FROM tracks"},
+        {"artist_durations",
+         "SELECT ar.Name, count(*), sum(t.Milliseconds) FROM tracks t "
+         "JOIN albums al ON t.AlbumId = al.AlbumId "
+         "JOIN artists ar ON al.ArtistId = ar.ArtistId "
+         "GROUP BY ar.Name ORDER BY 3 DESC"},
+        {"revenue_by_country",
+         "SELECT c.Country, sum(ii.UnitPrice * ii.Quantity) FROM invoice_items ii "
+         "JOIN invoices i ON ii.InvoiceId = i.InvoiceId "
+         "JOIN customers c ON i.CustomerId = c.CustomerId "
+         "GROUP BY c.Country ORDER BY 2 DESC"},
+        {"like_filter",
+         "SELECT count(*) FROM tracks WHERE Name LIKE '%love%'"},
+        {"window_rank",
+         "SELECT TrackId, rank() OVER (PARTITION BY GenreId ORDER BY Milliseconds DESC) "
+         "FROM tracks"},
+        {"correlated_subquery",
+         "SELECT Name FROM tracks t WHERE Milliseconds > "
+         "(SELECT avg(Milliseconds) FROM tracks WHERE GenreId = t.GenreId)"},
+        {"playlist_distinct",
+         "SELECT p.Name, count(DISTINCT pt.TrackId) FROM playlists p "
+         "JOIN playlist_track pt ON p.PlaylistId = pt.PlaylistId GROUP BY p.PlaylistId"},
+        {"sort_text",
+         "SELECT Name, Composer FROM tracks ORDER BY Composer, Name"},
+        {"employee_hierarchy",
+         "WITH RECURSIVE chain(id, depth) AS ("
+         "SELECT EmployeeId, 0 FROM employees WHERE ReportsTo IS NULL "
+         "UNION ALL SELECT e.EmployeeId, depth + 1 FROM employees e "
+         "JOIN chain ON e.ReportsTo = chain.id) "
+         "SELECT depth, count(*) FROM chain GROUP BY depth"}
+    };
+
+    double run_query(sqlite3* db, const char* sql)
+    {
+        auto start = std::chrono::steady_clock::now();
+        sqlite3_stmt* statement = nullptr;
+        if (sqlite3_prepare_v2(db, sql, -1, &statement, nullptr) != SQLITE_OK)
+        {
+            std::fprintf(stderr, "%s\n", sqlite3_errmsg(db));
+            std::exit(1);
+        }
+        int rc;
+        while ((rc = sqlite3_step(statement)) == SQLITE_ROW)
+        {
+            for (int col = 0; col < sqlite3_column_count(statement); ++col)
+            {
+                sqlite3_column_text(statement, col);
+            }
+        }
+        sqlite3_finalize(statement);
+        if (rc != SQLITE_DONE)
+        {
+            std::fprintf(stderr, "%s\n", sqlite3_errmsg(db));
+            std::exit(1);
+        }
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s <database> [iterations]\n", argv[0]);
+        return 1;
+    }
+    int iterations = argc > 2 ? std::max(1, std::atoi(argv[2])) : 20;
+
+    sqlite3* db = nullptr;
+    if (sqlite3_open_v2(argv[1], &db, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK)
+    {
+        std::fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    std::printf("# profile %s, SQLite %s\n", XSQL_BENCH_PROFILE, sqlite3_libversion());
+    for (const bench_query& query : query_suite)
+    {
+        /* The first run warms the page cache */
+        run_query(db, query.sql);
+        std::vector<double> times;
+        for (int i = 0; i < iterations; ++i)
+        {
+            times.push_back(run_query(db, query.sql));
+        }
+        std::nth_element(times.begin(), times.begin() + iterations / 2, times.end());
+        std::printf("%s\t%.0f\n", query.name, times[static_cast<std::size_t>(iterations / 2)]);
+    }
+
+    sqlite3_close(db);
+    return 0;
+}
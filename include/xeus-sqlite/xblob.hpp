@@ -0,0 +1,93 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_BLOB_HPP
+#define XEUS_SQLITE_BLOB_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "nlohmann/json.hpp"
+
+#include "xeus_sqlite_config.hpp"
+
+namespace nl = nlohmann;
+
+namespace xeus_sqlite
+{
+    /*! \brief detect_mime_type - guesses the MIME type of a value.
+     *
+     * Looks at the signature of common image, document and archive formats
+     * in the first bytes of the value, values holding valid UTF-8 without
+     * null bytes are text/plain.
+     *
+     * return the MIME type, application/octet-stream if unknown
+     */
+    XEUS_SQLITE_API std::string detect_mime_type(std::string_view head);
+
+    /* Base64 of bytes, chunks whose size is a multiple of 3 can be encoded
+       one after the other */
+    XEUS_SQLITE_API std::string base64_encode(std::string_view bytes);
+
+    /*! \brief blob_reader - reads a single value with incremental blob I/O.
+     *
+     * The value is opened with sqlite3_blob_open and read in chunks, it is
+     * never held in memory at once unless it is displayed inline. Works on
+     * TEXT and BLOB values of rowid tables.
+     */
+    class XEUS_SQLITE_API blob_reader
+    {
+    public:
+
+        using sink_type = std::function<void(std::string_view)>;
+
+        /* Values larger than this are only written to files */
+        static constexpr std::size_t inline_limit = 8 * 1024 * 1024;
+
+        /* table can be qualified with its schema, e.g. aux.images */
+        blob_reader(SQLite::Database& db, const std::string& table,
+                    const std::string& column, std::int64_t rowid);
+        ~blob_reader();
+
+        blob_reader(const blob_reader&) = delete;
+        blob_reader& operator=(const blob_reader&) = delete;
+
+        std::size_t size() const noexcept;
+
+        /* Reads up to count bytes at offset, returns the bytes read */
+        std::size_t read(char* buffer, std::size_t count, std::size_t offset);
+
+        /* Passes the value to sink one chunk after the other */
+        void stream(const sink_type& sink, std::size_t chunk_size = 3 * 64 * 1024);
+
+        /* Streams the value to a file, returns the bytes written */
+        std::size_t write_to(const std::string& path);
+
+        /*! \brief mime_bundle - displays the value.
+         *
+         * Images are published as such, text as text/plain and other values
+         * as a hex dump of their first bytes. Throws for images and text
+         * larger than inline_limit.
+         */
+        nl::json mime_bundle();
+
+    private:
+
+        sqlite3* m_handle;
+        sqlite3_blob* m_blob = nullptr;
+        std::size_t m_size = 0;
+    };
+}
+
+#endif
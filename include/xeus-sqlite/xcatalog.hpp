@@ -0,0 +1,111 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_CATALOG_HPP
+#define XEUS_SQLITE_CATALOG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "xeus_sqlite_config.hpp"
+
+namespace xeus_sqlite
+{
+    /*! \brief catalog - names known to the completion of a connection.
+     *
+     * Keywords, schemas, tables, views, indexes, columns and functions are
+     * kept in a flat index sorted on their upper case name, so that the
+     * names starting with a prefix are found with a binary search. The
+     * index is only rebuilt when the schema_version of one of the attached
+     * databases changes, or when databases are attached or detached.
+     */
+    class XEUS_SQLITE_API catalog
+    {
+    public:
+
+        enum class kind : std::uint8_t
+        {
+            keyword,
+            schema,
+            table,
+            view,
+            index,
+            column,
+            function
+        };
+
+        struct completion
+        {
+            std::size_t cursor_start = 0;
+            std::vector<std::string> matches;
+        };
+
+        /* At most that many matches are returned by complete */
+        static constexpr std::size_t max_matches = 1000;
+
+        catalog();
+
+        /* Rebuilds the index if the schema changed, return true if it did */
+        bool refresh(SQLite::Database& db);
+
+        /* Forgets the objects of the connection, only keywords are kept */
+        void clear();
+
+        /* Names of the given kinds starting with prefix, ignoring case */
+        std::vector<std::string> lookup(const std::string& prefix,
+                                        std::initializer_list<kind> kinds) const;
+
+        /* Columns of table, or of schema.table, starting with prefix */
+        std::vector<std::string> columns(const std::string& table,
+                                         const std::string& prefix) const;
+
+        /*! \brief complete - completes the identifier ending at cursor.
+         *
+         * Tables and views are offered after FROM, JOIN, INTO, UPDATE and
+         * TABLE, indexes after INDEX, the columns of a table after its name
+         * or alias followed by a dot and the tables of a schema after its
+         * name followed by a dot. Elsewhere, the columns of the tables the
+         * statement refers to come first, then functions and keywords.
+         */
+        completion complete(const std::string& code, std::size_t cursor) const;
+
+        std::size_t size() const noexcept;
+        std::size_t rebuilds() const noexcept;
+
+    private:
+
+        struct entry
+        {
+            std::string key;
+            std::string name;
+            std::string owner;
+            kind type;
+        };
+
+        std::vector<std::string> collect(const std::string& prefix,
+                                         std::initializer_list<kind> kinds,
+                                         const std::string& owner) const;
+        void rebuild(SQLite::Database& db, const std::vector<std::string>& schemas);
+        void read_columns(SQLite::Database& db, const std::string& schema);
+        void sort_entries();
+
+        std::vector<entry> m_entries;
+        std::unordered_map<std::string, std::vector<std::string>> m_columns;
+        std::string m_signature;
+        std::size_t m_rebuilds = 0;
+    };
+}
+
+#endif
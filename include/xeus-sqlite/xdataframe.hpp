@@ -0,0 +1,140 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_DATAFRAME_HPP
+#define XEUS_SQLITE_DATAFRAME_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "nlohmann/json.hpp"
+
+#include "xeus_sqlite_config.hpp"
+
+namespace nl = nlohmann;
+
+namespace xeus_sqlite
+{
+    /* Type of all the values of a dataframe column */
+    enum class column_kind : std::uint8_t
+    {
+        integer,
+        real,
+        text
+    };
+
+    /*! \brief dataframe_column - contiguous values of a single type.
+     *
+     * Integers and reals are stored in a vector of their own, texts as
+     * codes into a dictionary holding each distinct text once. Nulls are
+     * cleared bits of a validity bitmap, their slot is left at zero. A
+     * column starts as integer and is promoted to real when a real is
+     * pushed, then to text when a text is: the values already pushed are
+     * converted once. Blobs have no chart value, they are pushed as null.
+     */
+    class XEUS_SQLITE_API dataframe_column
+    {
+    public:
+
+        explicit dataframe_column(std::string name);
+
+        const std::string& name() const noexcept;
+        column_kind kind() const noexcept;
+        std::size_t size() const noexcept;
+        void reserve(std::size_t rows);
+
+        void push_null();
+        void push_integer(std::int64_t value);
+        void push_real(double value);
+        void push_text(std::string_view value);
+
+        bool is_null(std::size_t row) const noexcept;
+        std::size_t null_count() const noexcept;
+
+        std::int64_t integer(std::size_t row) const noexcept;
+        /* Value of an integer or real column */
+        double real(std::size_t row) const noexcept;
+        /* Value of a text column, valid as long as the column lives */
+        const std::string& text(std::size_t row) const noexcept;
+
+        const std::vector<std::string>& dictionary() const noexcept;
+
+        /* Value as a double, fallback for nulls and texts */
+        double number(std::size_t row, double fallback) const noexcept;
+
+        /* Numbers stay numbers, NULL is null */
+        nl::json to_json(std::size_t row) const;
+
+    private:
+
+        void push_valid(bool valid);
+        void promote_to_real();
+        void promote_to_text();
+        std::uint32_t code(std::string_view value);
+
+        std::string m_name;
+        column_kind m_kind = column_kind::integer;
+        std::size_t m_size = 0;
+        std::size_t m_null_count = 0;
+        std::vector<std::uint64_t> m_validity;
+        std::vector<std::int64_t> m_integers;
+        std::vector<double> m_reals;
+        std::vector<std::uint32_t> m_codes;
+        std::vector<std::string> m_dictionary;
+        std::unordered_map<std::string, std::uint32_t> m_lookup;
+    };
+
+    /*! \brief dataframe - typed columnar data source of the charts.
+     *
+     * Filled straight from SQLite::Statement::executeStep, one typed column
+     * per result column, and serialized to the records of the Vega-Lite
+     * data.values with numbers written as JSON numbers.
+     */
+    class XEUS_SQLITE_API dataframe
+    {
+    public:
+
+        /* Resolves the column names of the statement once */
+        void reset(SQLite::Statement& query);
+
+        /* Copies the current row of the statement */
+        void append_row(SQLite::Statement& query);
+
+        /* Steps the statement to completion or until max_rows rows are
+           read, returns the number of rows read */
+        std::size_t fill(SQLite::Statement& query,
+                         std::size_t max_rows = std::numeric_limits<std::size_t>::max());
+
+        std::size_t rows() const noexcept;
+        std::size_t columns() const noexcept;
+        const dataframe_column& column(std::size_t index) const;
+
+        /* Rows as JSON objects keyed on the column names */
+        nl::json to_values() const;
+
+        /* Records of the given rows, in the order given */
+        nl::json to_values(const std::vector<std::size_t>& rows) const;
+
+    private:
+
+        nl::json record(std::size_t row) const;
+
+        std::vector<dataframe_column> m_columns;
+        std::size_t m_rows = 0;
+    };
+}
+
+#endif
@@ -11,8 +11,25 @@
 #define XEUS_SQLITE_INTERPRETER_HPP
 
 #include "xeus_sqlite_config.hpp"
+#include "xcatalog.hpp"
+#include "xexport.hpp"
+#include "ximport.hpp"
+#include "xparallel.hpp"
+#include "xparameters.hpp"
+#include "xprofile.hpp"
+#include "xprogress.hpp"
+#include "xresult_cache.hpp"
+#include "xresult_table.hpp"
+#include "xsnapshot.hpp"
+#include "xstatement_cache.hpp"
+#include "xtable_store.hpp"
 #include "xvega_sqlite.hpp"
 
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
 #include <SQLiteCpp/SQLiteCpp.h>
 #include <SQLiteCpp/VariadicBind.h>
 
@@ -30,14 +47,15 @@ namespace xeus_sqlite
     public:
 
         interpreter();
-        virtual ~interpreter() = default;
+        virtual ~interpreter();
 
-    private:
-        std::unique_ptr<SQLite::Database> m_db = nullptr;
-        std::unique_ptr<SQLite::Database> m_backup_db = nullptr;
-        bool m_bd_is_loaded = false;
-        std::string m_db_path;
+        /* Profile applied to every database opened, see %TUNE and --tune.
+           Throws std::runtime_error if the profile is unknown */
+        void set_tuning_profile(const std::string& name);
+
+    protected:
 
+        /* Request handlers, protected so that benchmarks can drive them */
         void configure_impl() override;
         void execute_request_impl(send_reply_callback cb,
                                           int execution_counter,
@@ -53,6 +71,72 @@ namespace xeus_sqlite
         nl::json kernel_info_request_impl() override;
         void shutdown_request_impl() override;
 
+    private:
+
+        std::unique_ptr<SQLite::Database> m_db = nullptr;
+        bool m_bd_is_loaded = false;
+        std::string m_db_path;
+
+        /* Rows of the last query that are still to be displayed, see %PAGE */
+        struct result_cursor
+        {
+            std::shared_ptr<SQLite::Statement> query = nullptr;
+            std::string display_id;
+            std::size_t rows_read = 0;
+        };
+        result_cursor m_cursor;
+        std::size_t m_page_size = 0;
+
+        /* Bounds and MIME types of the displayed results, see %DISPLAY */
+        display_budget m_display_budget = {60, 40, 1 << 20};
+        mime_selection m_mimes;
+
+        /* Results exceeding the budget are also served page by page to the
+           front end when set */
+        bool m_virtual_tables = false;
+        table_store m_tables;
+        std::map<xeus::xguid, xeus::xcomm> m_table_comms;
+        std::vector<xeus::xguid> m_closed_table_comms;
+
+        /* Rows per record batch of the Arrow streams of the results, 0
+           when they aren't sent, see %ARROW */
+        std::size_t m_arrow_batch_rows = 0;
+
+        /* Points sent to the front end per chart, see %XVEGA_BUDGET */
+        std::size_t m_xvega_budget = 5000;
+
+        /* Wraps cells holding several statements in a single transaction */
+        bool m_cell_transaction = false;
+
+        /* Profiles single statement cells, see %PROFILE */
+        bool m_profile = false;
+
+        /* Values bound to the parameters of the statements, see %SET */
+        session_parameters m_parameters;
+
+        /* Displays the progress of long statements, see %PROGRESS */
+        bool m_progress = true;
+
+        /* Statements compiled on m_db, cleared before m_db is replaced */
+        statement_cache m_statement_cache;
+
+        /* Results of read only queries on m_db, see %RESULT_CACHE */
+        result_cache m_result_cache;
+
+        /* Names offered by the completion, refreshed when the schema changes */
+        catalog m_catalog;
+
+        /* Profile applied to the databases loaded next, see %TUNE */
+        std::string m_tuning_profile;
+
+        /* Writes an in memory database back to its file, see %LOAD */
+        std::unique_ptr<snapshotter> m_snapshotter = nullptr;
+
+        /* Workers and read only connections of %PARALLEL, opened by its
+           first cell. The workers are declared last to stop first */
+        std::unique_ptr<connection_pool> m_read_pool = nullptr;
+        std::unique_ptr<work_stealing_pool> m_workers = nullptr;
+
         /**
          * Parses magic and calls the correct function.
          */
@@ -148,29 +232,332 @@ namespace xeus_sqlite
          */
         nl::json get_header_info();
 
-        /*! \brief get_header_info - backups a database.
+        /*! \brief backup - backups a database.
          *
          * This function is used to load the contents of a database file on disk
-         * into the "main" database of open database connection pInMemory, or
-         * to save the current contents of the database opened by pInMemory into
-         * a database file on disk.
+         * into the "main" database of m_db, or to save the current contents of
+         * m_db into a database file on disk. The file defaults to the one the
+         * database was loaded from.
+         *
+         * return void
+         */
+        void backup(const std::vector<std::string>& tokenized_input);
+
+        /*! \brief apply_tuning - applies m_tuning_profile to m_db.
+         *
+         * Sends the resulting values of the pragmas, does nothing when no
+         * profile is set.
+         *
+         * return void
+         */
+        void apply_tuning();
+
+        /*! \brief tune - sets the profile of the databases, see %TUNE.
+         *
+         * Receives a profile, applied to m_db and to the databases loaded
+         * next, or OFF. Without argument reports the current settings.
+         *
+         * return the resulting values of the pragmas
+         */
+        nl::json tune(const std::vector<std::string>& tokenized_input);
+
+        /*! \brief load_db_in_memory - loads the file at path in memory.
+         *
+         * The file is copied to an in memory database with the backup API,
+         * the changes are written back to it by m_snapshotter.
+         *
+         * return void
+         */
+        void load_db_in_memory(const std::string& path);
+
+        /*! \brief use_db - replaces m_db with a connection already opened.
+         *
+         * Releases m_db, then registers db and applies the functions and
+         * the tuning profile to it, so that the registered connection is
+         * always m_db.
+         *
+         * return void
+         */
+        void use_db(std::unique_ptr<SQLite::Database> db, const std::string& path);
+
+        /*! \brief snapshot - writes an in memory database to its file.
+         *
+         * return the number of pages written and the time spent
+         */
+        nl::json snapshot();
+
+
+        /*! \brief release_statements - finalizes the statements of m_db.
+         *
+         * Also forgets the catalog of m_db and unregisters m_db from the
+         * connections aborted on interrupt.
+         * Must be called before m_db is closed or replaced.
+         *
+         * return void
+         */
+        void release_statements();
+
+        /*! \brief cache_stats - statistics of the statement and result
+         * caches.
+         *
+         * return the mime bundle reporting hits, misses and evictions
+         */
+        nl::json cache_stats() const;
+
+        /*! \brief set_result_cache - sizes the cache of query results.
+         *
+         * Receives the megabytes of results kept, 0 or "off" disables the
+         * cache and drops the results it holds.
+         *
+         * return void
+         */
+        void set_result_cache(const std::vector<std::string>& tokenized_input);
+
+        /*! \brief prepare_statement - compiles SQLite code.
+         *
+         * Statements are looked up in the statement cache first. Throws if no
+         * database is loaded.
+         *
+         * return the compiled statement, reset and without bindings
+         */
+        std::shared_ptr<SQLite::Statement> prepare_statement(const std::string& code);
+
+        /*! \brief set_page_size - enables or disables paged results.
+         *
+         * Receives the number of rows displayed per page, 0 or "off"
+         * disables paging and displays every row at once.
+         *
+         * return void
+         */
+        void set_page_size(const std::vector<std::string>& tokenized_input);
+
+        /*! \brief set_display - sets the display budget.
+         *
+         * Receives the rows, then optionally the columns and the bytes of a
+         * rendered result, "off" removes the bounds. Also receives VIRTUAL
+         * followed by ON or OFF to toggle the virtual tables, or MIME
+         * followed by PLAIN, HTML or ALL to select the rendered types.
          *
          * return void
          */
-        void backup(std::string backup_type);
+        void set_display(const std::vector<std::string>& tokenized_input);
 
+        /*! \brief result_bundle - renders a result within the display budget.
+         *
+         * Adds the virtual table entry of the result when it exceeds the
+         * budget and the virtual tables are enabled.
+         *
+         * return the mime bundle of the result
+         */
+        nl::json result_bundle(result_table&& result);
+
+        /*! \brief run_with_progress - runs a statement, reporting its progress.
+         *
+         * run steps query, whose rows are appended to result if not null.
+         * The progress is displayed once the statement ran for a while and
+         * the display is updated a few times per second until it ends.
+         *
+         * return void
+         */
+        void run_with_progress(SQLite::Statement& query,
+                               const result_table* result,
+                               const std::function<void()>& run);
+
+        /*! \brief set_arrow - toggles the Arrow streams of the results.
+         *
+         * Receives ON, optionally followed by the rows per record batch,
+         * or OFF.
+         *
+         * return void
+         */
+        void set_arrow(const std::vector<std::string>& tokenized_input);
+
+        /*! \brief set_parameter - stores a session parameter.
+         *
+         * Receives the cell: %SET, the name of the parameter and its value,
+         * written as in SQL up to the end of the cell.
+         *
+         * return void
+         */
+        void set_parameter(const std::string& code);
+
+        /*! \brief parameters - lists or drops the session parameters.
+         *
+         * Receives nothing to list them, CLEAR or UNSET followed by names
+         * to drop them.
+         *
+         * return the mime bundle of the parameters
+         */
+        nl::json parameters(const std::vector<std::string>& tokenized_input);
+
+        /*! \brief evaluate_user_expressions - evaluates the user_expressions
+         * of an execute request.
+         *
+         * Each expression is selected with the session parameters bound,
+         * its result or its error is reported under its name.
+         *
+         * return the user_expressions of the execute reply
+         */
+        nl::json evaluate_user_expressions(const nl::json& user_expressions);
+
+        /*! \brief open_table_comm - serves the pages of a virtual table.
+         *
+         * return void
+         */
+        void open_table_comm(xeus::xcomm&& comm, const std::string& table_id);
+
+        /*! \brief open_cursor - displays the first page of a query.
+         *
+         * Keeps the statement open so that the next pages can be fetched
+         * with %NEXT, only one page of rows is held in memory at a time.
+         *
+         * return void
+         */
+        void open_cursor(std::shared_ptr<SQLite::Statement> query);
+
+        /*! \brief next_page - displays the next page of the open cursor.
+         *
+         * Updates the display of the previous page in place.
+         *
+         * return void
+         */
+        void next_page();
+
+        /*! \brief close_cursor - finalizes the statement of the open cursor.
+         *
+         * return void
+         */
+        void close_cursor();
+
+        /*! \brief fetch_page - reads the next page of the open cursor.
+         *
+         * return the mime bundle of the page
+         */
+        nl::json fetch_page();
+
+        /*! \brief plot_SQLite_input - runs the query of a XVEGA_PLOT cell.
+         *
+         * The aggregation, binning or sampling of the chart is pushed into
+         * the query so that at most m_xvega_budget points are sent, see
+         * %XVEGA_BUDGET. Statements that don't return rows are simply
+         * executed. The chart is the sole output of the cell.
+         *
+         * return void
+         */
+        void plot_SQLite_input(int execution_counter,
+                               const std::vector<std::string>& xvega_input,
+                               const std::string& code);
+
+        /*! \brief set_xvega_budget - bounds the points of the charts.
+         *
+         * Receives the number of points, 0 or "off" sends every row.
+         *
+         * return void
+         */
+        void set_xvega_budget(const std::vector<std::string>& tokenized_input);
+
+        /*! \brief set_cell_transaction - toggles the implicit transaction.
+         *
+         * Receives ON or OFF. When ON, cells holding several statements are
+         * run between a single BEGIN and COMMIT.
+         *
+         * return void
+         */
+        void set_cell_transaction(const std::vector<std::string>& tokenized_input);
+
+        /*! \brief import_file - bulk loads a CSV, TSV or JSON lines file.
+         *
+         * Receives the file, the table and optionally the format and "fast",
+         * which relaxes the durability of the database during the import.
+         * The progress is streamed on stdout.
+         *
+         * return the mime bundle summarizing the import
+         */
+        nl::json import_file(const std::vector<std::string>& tokenized_input);
+
+        /*! \brief export_query - writes the result of a query to a file.
+         *
+         * Receives the format (arrow or csv), the path, optionally the rows
+         * per record batch, then <> and the query. Rows are streamed to the
+         * file one batch at a time.
+         *
+         * return the mime bundle summarizing the export
+         */
+        nl::json export_query(const std::vector<std::string>& tokenized_input);
+
+        /*! \brief read_blob - displays or saves a single value.
+         *
+         * Receives the table, the column, the rowid and optionally a file.
+         * The value is read in chunks with the incremental blob I/O API and
+         * streamed to the file when one is given.
+         *
+         * return the mime bundle of the value or of the summary
+         */
+        nl::json read_blob(const std::vector<std::string>& tokenized_input);
+
+        /*! \brief set_profile - toggles the profiling of cells.
+         *
+         * Receives ON or OFF.
+         *
+         * return void
+         */
+        void set_profile(const std::vector<std::string>& tokenized_input);
+
+        /*! \brief explain - renders the plan or the program of a query.
+         *
+         * Receives the query, optionally preceded by BYTECODE to list the
+         * virtual machine program instead of the query plan.
+         *
+         * return the mime bundle of the plan or of the program
+         */
+        nl::json explain(const std::vector<std::string>& tokenized_input);
+
+        /*! \brief profile_SQLite_input - runs and profiles a statement.
+         *
+         * Like process_SQLite_input without paging. The profile is attached
+         * to the metadata of the result and displayed under it.
+         *
+         * return void
+         */
+        void profile_SQLite_input(int execution_counter,
+                                  const std::string& code);
+
+        /*! \brief process_SQLite_batch - runs every statement of a cell.
+         *
+         * Steps through the statements of code one after the other using the
+         * tail returned by sqlite3_prepare_v2. Sends a report of the rows
+         * affected and time spent by each statement, followed by the result
+         * of the last statement returning rows.
+         *
+         * return void
+         */
+        void process_SQLite_batch(int execution_counter,
+                                  const std::string& code);
+
+        /*! \brief process_SQLite_parallel - runs the queries of a cell
+         * concurrently.
+         *
+         * Runs the statements following %PARALLEL [threads] on read only
+         * connections to the database file, one per thread. The results are
+         * sent in the order of the statements, followed by the time spent.
+         * The database must be loaded read only or be in WAL mode.
+         *
+         * return void
+         */
+        void process_SQLite_parallel(int execution_counter,
+                                     const std::string& code);
 
-        /*! \brief get_header_info - backups a database.
+        /*! \brief process_SQLite_input - runs pure SQLite code.
          *
          * Runs pure SQLite code. Sends the result as HTML or Text to the front
-         * end.
+         * end. The result of a read only query is looked up in the result
+         * cache first unless use_cache is false, e.g. for %NOCACHE.
          *
          * return void
          */
         void process_SQLite_input(int execution_counter,
-                                        std::unique_ptr<SQLite::Database> &m_db,
-                                        const std::string& code,
-                                        xv::df_type& xv_sqlite_df);
+                                  const std::string& code,
+                                  bool use_cache = true);
     };
 }
 
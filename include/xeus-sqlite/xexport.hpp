@@ -0,0 +1,162 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_EXPORT_HPP
+#define XEUS_SQLITE_EXPORT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "xeus_sqlite_config.hpp"
+#include "xresult_table.hpp"
+
+namespace xeus_sqlite
+{
+    enum class export_format
+    {
+        csv,
+        arrow
+    };
+
+    /* Type of an exported column, chosen once for the whole result */
+    enum class export_type
+    {
+        int64,
+        float64,
+        utf8,
+        binary
+    };
+
+    struct export_summary
+    {
+        std::size_t rows = 0;
+        std::size_t batches = 0;
+        std::size_t bytes = 0;
+        double seconds = 0.;
+        /* Values that didn't fit the type of their column */
+        std::size_t coerced = 0;
+    };
+
+    /* Messages of an Arrow stream, one buffer each */
+    using message_buffers = std::vector<std::vector<char>>;
+
+    /* Format named by the magic argument, throws for unsupported ones */
+    XEUS_SQLITE_API export_format export_format_from(const std::string& name);
+
+    /*! \brief batch_writer - sink of the record batches of an export.
+     *
+     * Receives the result one result_table at a time, so that only one
+     * batch of rows is held in memory whatever the size of the result.
+     */
+    class XEUS_SQLITE_API batch_writer
+    {
+    public:
+
+        virtual ~batch_writer() = default;
+
+        /* Writes the header, types are known from the first batch on */
+        virtual void write_schema(const std::vector<std::string>& names,
+                                  const std::vector<export_type>& types) = 0;
+        virtual void write_batch(const result_table& batch) = 0;
+        virtual void finish() = 0;
+
+        std::size_t coerced() const noexcept;
+
+    protected:
+
+        std::size_t m_coerced = 0;
+    };
+
+    /*! \brief csv_writer - writes batches as RFC 4180 CSV.
+     *
+     * Numbers are written with their shortest round trip representation,
+     * fields are only quoted when they hold a comma, a quote or a line break.
+     */
+    class XEUS_SQLITE_API csv_writer : public batch_writer
+    {
+    public:
+
+        explicit csv_writer(std::ostream& out);
+
+        void write_schema(const std::vector<std::string>& names,
+                          const std::vector<export_type>& types) override;
+        void write_batch(const result_table& batch) override;
+        void finish() override;
+
+    private:
+
+        void write_field(std::string_view field);
+
+        std::ostream& m_out;
+        std::string m_line;
+    };
+
+    /*! \brief arrow_stream_writer - writes batches in the Arrow IPC stream format.
+     *
+     * Emits a schema message, one record batch message per batch and the
+     * end of stream marker. Integers are written as Int64, reals as Double,
+     * text as Utf8 and blobs as Binary, every column is nullable. The
+     * messages are written to a stream, or appended to a sequence of
+     * buffers whose concatenation is the stream.
+     */
+    class XEUS_SQLITE_API arrow_stream_writer : public batch_writer
+    {
+    public:
+
+        explicit arrow_stream_writer(std::ostream& out);
+        explicit arrow_stream_writer(message_buffers& messages);
+
+        void write_schema(const std::vector<std::string>& names,
+                          const std::vector<export_type>& types) override;
+        void write_batch(const result_table& batch) override;
+        void finish() override;
+
+    private:
+
+        void write_message(const std::string& metadata, const std::string& body);
+
+        std::ostream* p_out = nullptr;
+        message_buffers* p_messages = nullptr;
+        std::vector<export_type> m_types;
+        std::string m_body;
+    };
+
+    /* Column types of a result, from the declared types of the statement
+       and the values of its first batch */
+    XEUS_SQLITE_API std::vector<export_type> export_types(SQLite::Statement& query,
+                                                          const result_table& first_batch);
+
+    /*! \brief export_query - streams the rows of a query to a file.
+     *
+     * Steps the statement batch_rows rows at a time and hands every batch
+     * to the writer of the format. The file is removed if the export fails.
+     */
+    XEUS_SQLITE_API export_summary export_query(SQLite::Statement& query,
+                                                const std::string& path,
+                                                export_format format,
+                                                std::size_t batch_rows = 65536);
+
+    /*! \brief stream_query - reads a query into a result and an Arrow stream.
+     *
+     * Steps the statement once, every row is appended to result and to the
+     * record batch being filled, written to messages every batch_rows rows.
+     * Only one batch is held besides the result.
+     */
+    XEUS_SQLITE_API export_summary stream_query(SQLite::Statement& query,
+                                                result_table& result,
+                                                message_buffers& messages,
+                                                std::size_t batch_rows = 65536);
+}
+
+#endif
@@ -0,0 +1,38 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_FUNCTIONS_HPP
+#define XEUS_SQLITE_FUNCTIONS_HPP
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "xeus_sqlite_config.hpp"
+
+namespace xeus_sqlite
+{
+    /*! \brief register_functions - adds the statistical functions to a
+     * connection.
+     *
+     * Aggregate and window functions, NULL values are ignored:
+     *  - median(x), percentile_cont(x, p) with p in [0, 1], interpolated
+     *    between the closest values
+     *  - stddev(x) and var(x), of the sample
+     *  - corr(y, x), Pearson correlation of the pairs without NULL
+     *  - histogram(x, bins), JSON array of {"lo", "hi", "count"} objects
+     *    splitting [min(x), max(x)] in bins of equal width
+     *
+     * And the aggregate approx_count_distinct(x), estimating count(DISTINCT x)
+     * with a HyperLogLog sketch of 2^14 registers, about 0.8% of error.
+     *
+     * Throws SQLite::Exception if a function can't be registered.
+     */
+    XEUS_SQLITE_API void register_functions(SQLite::Database& db);
+}
+
+#endif
@@ -0,0 +1,135 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_IMPORT_HPP
+#define XEUS_SQLITE_IMPORT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "xeus_sqlite_config.hpp"
+
+namespace xeus_sqlite
+{
+    enum class import_format
+    {
+        csv,
+        tsv,
+        jsonl
+    };
+
+    struct import_options
+    {
+        import_format format = import_format::csv;
+        /* Sets synchronous=OFF and journal_mode=MEMORY during the import */
+        bool relax_durability = false;
+        /* Rows inserted per transaction */
+        std::size_t batch_size = 100000;
+        /* Rows read to infer the column types */
+        std::size_t sample_size = 1000;
+    };
+
+    struct import_summary
+    {
+        std::size_t rows = 0;
+        std::size_t bytes = 0;
+        double seconds = 0.;
+        bool created_table = false;
+        std::vector<std::string> columns;
+        std::vector<std::string> types;
+    };
+
+    /* Receives the number of rows imported, bytes read and total bytes */
+    using import_progress = std::function<void(std::size_t, std::size_t, std::size_t)>;
+
+    /*! \brief mapped_file - read-only view of a whole file.
+     *
+     * Memory-maps the file where mmap is available and reads it in memory
+     * otherwise.
+     */
+    class XEUS_SQLITE_API mapped_file
+    {
+    public:
+
+        explicit mapped_file(const std::string& path);
+        ~mapped_file();
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        const char* data() const noexcept;
+        std::size_t size() const noexcept;
+
+    private:
+
+        const char* m_data = nullptr;
+        std::size_t m_size = 0;
+        std::string m_buffer;
+        bool m_mapped = false;
+    };
+
+    /*! \brief delimited_scanner - splits CSV/TSV input in records.
+     *
+     * Unquoted fields are delimited eight bytes at a time with a SWAR scan
+     * for the delimiter and line breaks, quoted fields with memchr. Fields
+     * are views on the input, except the quoted ones holding escaped quotes
+     * which are unescaped in an internal buffer, valid until the next call.
+     */
+    class XEUS_SQLITE_API delimited_scanner
+    {
+    public:
+
+        delimited_scanner(const char* data, std::size_t size, char delimiter);
+
+        /* Splits the next record in fields, returns false at the end of input */
+        bool next_record(std::vector<std::string_view>& fields);
+
+        std::size_t position() const noexcept;
+        std::size_t line() const noexcept;
+
+    private:
+
+        const char* find_field_end(const char* it) const noexcept;
+
+        const char* m_begin;
+        const char* m_end;
+        const char* m_it;
+        char m_delimiter;
+        std::uint64_t m_delimiter_pattern;
+        std::size_t m_line = 1;
+        std::deque<std::string> m_unescaped;
+    };
+
+    /* Format named by the magic argument, or deduced from the file extension */
+    XEUS_SQLITE_API import_format import_format_from(const std::string& name);
+
+    /* SQLite type (INTEGER, REAL or TEXT) fitting every value of a sample */
+    XEUS_SQLITE_API std::string infer_column_type(const std::vector<std::string_view>& sample);
+
+    /*! \brief import_file - bulk loads a file in a table.
+     *
+     * Creates the table from the header and the inferred column types if it
+     * doesn't exist, then inserts every row through a single prepared
+     * INSERT, committing every batch_size rows.
+     */
+    XEUS_SQLITE_API import_summary import_file(SQLite::Database& db,
+                                               const std::string& path,
+                                               const std::string& table,
+                                               const import_options& options,
+                                               const import_progress& progress);
+}
+
+#endif
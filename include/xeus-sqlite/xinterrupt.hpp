@@ -0,0 +1,72 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_INTERRUPT_HPP
+#define XEUS_SQLITE_INTERRUPT_HPP
+
+#include <cstddef>
+#include <exception>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "xeus_sqlite_config.hpp"
+
+namespace xeus_sqlite
+{
+    /*! \brief register_connection - makes a connection interruptible.
+     *
+     * Registered connections are the ones interrupt_connections aborts.
+     * A connection must be unregistered before it is closed.
+     */
+    XEUS_SQLITE_API void register_connection(sqlite3* handle);
+    XEUS_SQLITE_API void unregister_connection(sqlite3* handle) noexcept;
+
+    /* Connections that can be registered at once */
+    constexpr std::size_t max_registered_connections = 16;
+
+    /* Connections that can still be registered */
+    XEUS_SQLITE_API std::size_t free_connection_slots() noexcept;
+
+    /*! \brief connection_registration - registers a connection for its
+     * lifetime.
+     *
+     * Unregisters the connection even when the constructor of its owner
+     * throws after it was registered. It must be destroyed before the
+     * connection is closed.
+     */
+    class XEUS_SQLITE_API connection_registration
+    {
+    public:
+
+        explicit connection_registration(sqlite3* handle);
+        ~connection_registration();
+
+        connection_registration(connection_registration&& rhs) noexcept;
+        connection_registration(const connection_registration&) = delete;
+        connection_registration& operator=(const connection_registration&) = delete;
+        connection_registration& operator=(connection_registration&&) = delete;
+
+    private:
+
+        sqlite3* p_handle;
+    };
+
+    /*! \brief interrupt_connections - aborts the running statements.
+     *
+     * Calls sqlite3_interrupt on every registered connection, the running
+     * statements fail with SQLITE_INTERRUPT and the connections stay usable.
+     * Only reads lock-free atomics, so it can be called from a signal handler.
+     */
+    XEUS_SQLITE_API void interrupt_connections() noexcept;
+
+    /* True if err was raised by a statement aborted by sqlite3_interrupt */
+    XEUS_SQLITE_API bool is_interrupt(const std::exception& err) noexcept;
+}
+
+#endif
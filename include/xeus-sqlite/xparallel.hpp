@@ -0,0 +1,142 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_PARALLEL_HPP
+#define XEUS_SQLITE_PARALLEL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "xeus_sqlite_config.hpp"
+#include "xinterrupt.hpp"
+#include "xresult_table.hpp"
+
+namespace xeus_sqlite
+{
+    /*! \brief work_stealing_pool - fixed set of worker threads.
+     *
+     * Every worker has its own queue, tasks are handed out to the queues in
+     * turn. A worker runs the tasks of its queue first and steals from the
+     * back of the other queues once its own is empty, so that a few long
+     * statements don't leave the other workers idle.
+     */
+    class XEUS_SQLITE_API work_stealing_pool
+    {
+    public:
+
+        /* Receives the index of the worker running it */
+        using task_type = std::function<void(std::size_t)>;
+
+        explicit work_stealing_pool(std::size_t workers);
+
+        /* Runs the queued tasks, then joins the workers */
+        ~work_stealing_pool();
+
+        work_stealing_pool(const work_stealing_pool&) = delete;
+        work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+        std::size_t size() const noexcept;
+
+        void submit(task_type task);
+
+    private:
+
+        struct worker_queue
+        {
+            std::mutex mutex;
+            std::deque<task_type> tasks;
+        };
+
+        bool pop(std::size_t worker, task_type& task);
+        void run(std::size_t worker);
+
+        std::vector<std::unique_ptr<worker_queue>> m_queues;
+        std::atomic<std::size_t> m_next_queue;
+        std::mutex m_mutex;
+        std::condition_variable m_task_available;
+        /* Tasks submitted and not claimed by a worker yet */
+        std::size_t m_unclaimed = 0;
+        bool m_stop = false;
+        std::vector<std::thread> m_threads;
+    };
+
+    /*! \brief connection_pool - read only connections to a database file.
+     *
+     * The connections are registered to be aborted on interrupt, opening
+     * more connections than there are free slots throws. Each of them must
+     * only be used by one thread at a time.
+     */
+    class XEUS_SQLITE_API connection_pool
+    {
+    public:
+
+        connection_pool(const std::string& path, std::size_t size);
+        ~connection_pool();
+
+        connection_pool(const connection_pool&) = delete;
+        connection_pool& operator=(const connection_pool&) = delete;
+
+        std::size_t size() const noexcept;
+        SQLite::Database& at(std::size_t index);
+
+        /* Aborts the statements running on the connections */
+        void interrupt();
+
+    private:
+
+        std::vector<std::unique_ptr<SQLite::Database>> m_connections;
+        /* Destroyed before the connections are closed */
+        std::vector<connection_registration> m_registrations;
+    };
+
+    /*! \brief split_read_statements - statements of a %PARALLEL cell.
+     *
+     * Every statement is prepared on db to check that it is a read only
+     * query returning rows.
+     *
+     * return the SQL of the statements, in order
+     */
+    XEUS_SQLITE_API std::vector<std::string> split_read_statements(SQLite::Database& db,
+                                                                   const std::string& code);
+
+    struct parallel_summary
+    {
+        std::size_t statements = 0;
+        double elapsed_ms = 0.;
+        /* Sum of the time spent by every statement */
+        double query_ms = 0.;
+    };
+
+    /*! \brief parallel_query - runs read only statements concurrently.
+     *
+     * Every statement runs on the connection of the worker which picks it,
+     * connections must hold at least as many connections as there are
+     * workers. sink is called on the calling thread with the results in
+     * statement order, each one as soon as it and the ones before it are
+     * done. The first error interrupts the statements still running and is
+     * thrown once all of them stopped.
+     */
+    XEUS_SQLITE_API parallel_summary parallel_query(
+        connection_pool& connections,
+        work_stealing_pool& workers,
+        const std::vector<std::string>& statements,
+        const std::function<void(std::size_t, result_table&)>& sink);
+}
+
+#endif
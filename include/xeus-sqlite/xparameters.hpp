@@ -0,0 +1,102 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_PARAMETERS_HPP
+#define XEUS_SQLITE_PARAMETERS_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "nlohmann/json.hpp"
+
+#include "xeus_sqlite_config.hpp"
+
+namespace nl = nlohmann;
+
+namespace xeus_sqlite
+{
+    /* Typed value of a session parameter */
+    struct XEUS_SQLITE_API parameter_value
+    {
+        enum class kind_type
+        {
+            null,
+            integer,
+            real,
+            text,
+            blob
+        };
+
+        kind_type kind = kind_type::null;
+        std::int64_t integer = 0;
+        double real = 0.;
+        /* Text, or bytes of a blob */
+        std::string text;
+
+        /*! \brief parse - reads a value written as in SQL.
+         *
+         * NULL, integers, reals, 'quoted texts' and X'hex' blobs keep their
+         * type, anything else is taken as a text.
+         */
+        static parameter_value parse(const std::string& literal);
+
+        /* SQL literal of the value */
+        std::string to_sql() const;
+    };
+
+    /*! \brief session_parameters - values bound to the statements of cells.
+     *
+     * Values are named after their parameter without its prefix: :name,
+     * $name and @name all read name, ?NNN reads NNN and the i-th bare ?
+     * reads i. Binding a statement fails on a named parameter without a
+     * value instead of leaving it NULL as SQLite does, bare ? without a
+     * value are left NULL.
+     */
+    class XEUS_SQLITE_API session_parameters
+    {
+    public:
+
+        using map_type = std::map<std::string, parameter_value>;
+
+        void set(const std::string& name, parameter_value value);
+
+        /* Returns false when there was no value */
+        bool erase(const std::string& name);
+
+        void clear();
+
+        bool empty() const noexcept;
+        const map_type& values() const noexcept;
+
+        /* Binds every parameter of query through SQLite::Statement::bind */
+        void bind(SQLite::Statement& query) const;
+
+        /* Same for a statement compiled with sqlite3_prepare_v2 */
+        void bind(sqlite3_stmt* statement) const;
+
+        /* Table of the names, types and values */
+        nl::json mime_bundle() const;
+
+        /* Name of the value read by the index-th parameter of statement */
+        static std::string parameter_key(sqlite3_stmt* statement, int index);
+
+    private:
+
+        /* Value of the index-th parameter, nullptr for a bare ? without
+           one, throws for a named parameter without one */
+        const parameter_value* find(sqlite3_stmt* statement, int index) const;
+
+        map_type m_values;
+    };
+}
+
+#endif
@@ -0,0 +1,77 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_PROFILE_HPP
+#define XEUS_SQLITE_PROFILE_HPP
+
+#include <cstddef>
+#include <string>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "nlohmann/json.hpp"
+
+#include "xeus_sqlite_config.hpp"
+
+namespace nl = nlohmann;
+
+namespace xeus_sqlite
+{
+    /*! \brief statement_profile - costs of running one statement.
+     *
+     * Times are measured by the interpreter, the counters are read with
+     * sqlite3_stmt_status and only cover the last run of the statement.
+     */
+    struct XEUS_SQLITE_API statement_profile
+    {
+        double prepare_ms = 0.;
+        double step_ms = 0.;
+        double render_ms = 0.;
+        bool cached = false;
+        std::size_t rows = 0;
+        std::size_t bytes_published = 0;
+
+        int fullscan_steps = 0;
+        int sorts = 0;
+        int autoindexes = 0;
+        int vm_steps = 0;
+        int reprepares = 0;
+
+        /* Reads the counters of the last run of statement */
+        void read_counters(sqlite3_stmt* statement) noexcept;
+
+        /* Attached to the metadata of the published result */
+        nl::json to_json() const;
+
+        /* text/plain and text/html summary displayed under the result */
+        nl::json mime_bundle() const;
+    };
+
+    /* Resets the sqlite3_stmt_status counters of statement */
+    XEUS_SQLITE_API void reset_statement_counters(sqlite3_stmt* statement) noexcept;
+
+    /*! \brief explain_query_plan - renders EXPLAIN QUERY PLAN as a tree.
+     *
+     * return the text/plain and text/html bundle of the plan
+     */
+    XEUS_SQLITE_API nl::json explain_query_plan(SQLite::Database& db,
+                                                const std::string& code);
+
+    /*! \brief explain_bytecode - renders the EXPLAIN listing of a statement.
+     *
+     * The comment column is only filled when SQLite is built with
+     * SQLITE_ENABLE_EXPLAIN_COMMENTS.
+     *
+     * return the text/plain and text/html bundle of the program
+     */
+    XEUS_SQLITE_API nl::json explain_bytecode(SQLite::Database& db,
+                                              const std::string& code);
+}
+
+#endif
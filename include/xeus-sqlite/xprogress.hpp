@@ -0,0 +1,103 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_PROGRESS_HPP
+#define XEUS_SQLITE_PROGRESS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "nlohmann/json.hpp"
+
+#include "xeus_sqlite_config.hpp"
+#include "xresult_table.hpp"
+
+namespace nl = nlohmann;
+
+namespace xeus_sqlite
+{
+    /* Progress of a running statement */
+    struct XEUS_SQLITE_API query_progress
+    {
+        std::size_t vm_steps = 0;
+        std::size_t rows = 0;
+        /* Pages fetched through the page cache since the statement started,
+           pages visited twice are counted twice */
+        std::size_t pages_read = 0;
+        std::size_t database_pages = 0;
+        double elapsed_ms = 0.;
+        bool done = false;
+        /* The statement failed or was interrupted */
+        bool stopped = false;
+
+        /* text/plain and text/html line, with a progress bar of the pages
+           read when the database isn't empty */
+        nl::json mime_bundle() const;
+    };
+
+    /*! \brief progress_reporter - reports the progress of a statement.
+     *
+     * Installs a sqlite3_progress_handler on the connection for its
+     * lifetime. The handler runs every few thousands virtual machine
+     * instructions and only reads the clock, the callback is invoked once
+     * the statement ran for delay, then at most once per interval. The
+     * rows are read from result, which may be null, the VM steps from
+     * sqlite3_stmt_status and the pages from sqlite3_db_status. The
+     * handler never aborts the statement, sqlite3_interrupt still does.
+     */
+    class XEUS_SQLITE_API progress_reporter
+    {
+    public:
+
+        using callback_type = std::function<void(const query_progress&)>;
+        using clock = std::chrono::steady_clock;
+
+        /* Virtual machine instructions between two calls of the handler */
+        static constexpr int instructions = 10000;
+
+        progress_reporter(SQLite::Database& db,
+                          sqlite3_stmt* statement,
+                          const result_table* result,
+                          callback_type callback,
+                          std::chrono::milliseconds interval = std::chrono::milliseconds(250),
+                          std::chrono::milliseconds delay = std::chrono::milliseconds(500));
+        ~progress_reporter();
+
+        progress_reporter(const progress_reporter&) = delete;
+        progress_reporter& operator=(const progress_reporter&) = delete;
+
+        /* Number of times the callback was invoked */
+        std::size_t reports() const noexcept;
+
+        query_progress snapshot() const;
+
+    private:
+
+        static int on_progress(void* reporter);
+
+        std::size_t page_fetches() const noexcept;
+
+        sqlite3* p_handle;
+        sqlite3_stmt* p_statement;
+        const result_table* p_result;
+        callback_type m_callback;
+        std::chrono::milliseconds m_interval;
+        clock::time_point m_start;
+        clock::time_point m_next;
+        std::size_t m_database_pages = 0;
+        std::size_t m_initial_fetches = 0;
+        std::size_t m_calls = 0;
+        std::size_t m_reports = 0;
+    };
+}
+
+#endif
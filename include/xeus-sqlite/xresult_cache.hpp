@@ -0,0 +1,114 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_RESULT_CACHE_HPP
+#define XEUS_SQLITE_RESULT_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "nlohmann/json.hpp"
+
+#include "xeus_sqlite_config.hpp"
+
+namespace nl = nlohmann;
+
+namespace xeus_sqlite
+{
+    /* State of a connection a cached result was computed from */
+    struct database_version
+    {
+        /* Changes committed by other connections */
+        std::int64_t data_version = -1;
+        /* Changes made by the connection itself */
+        std::int64_t total_changes = -1;
+        std::int64_t schema_version = -1;
+
+        bool operator==(const database_version& rhs) const noexcept;
+        bool operator!=(const database_version& rhs) const noexcept;
+
+        static database_version read(SQLite::Database& db);
+    };
+
+    /*! \brief result_cache - LRU cache of rendered query results.
+     *
+     * Results are keyed on the normalized SQL text and hold the mime bundle
+     * published for it together with the version of the database it was
+     * computed from. A result is only returned while the database is still
+     * at that version. The cache is bounded by the bytes of its bundles and
+     * keys, a capacity of 0 disables it.
+     */
+    class XEUS_SQLITE_API result_cache
+    {
+    public:
+
+        explicit result_cache(std::size_t capacity_bytes = 0);
+
+        /* Returns the cached bundle of key, or nullptr on a miss. A stale
+           entry is dropped */
+        const nl::json* find(const std::string& key, const database_version& version);
+
+        /* Bundles larger than the capacity aren't cached */
+        void insert(const std::string& key, const database_version& version, nl::json pub_data);
+
+        /* Evicts the least recently used results until they fit */
+        void set_capacity(std::size_t capacity_bytes);
+
+        void clear();
+
+        bool enabled() const noexcept;
+        std::size_t size() const noexcept;
+        std::size_t bytes() const noexcept;
+        std::size_t capacity() const noexcept;
+        std::size_t hits() const noexcept;
+        std::size_t misses() const noexcept;
+        std::size_t evictions() const noexcept;
+
+        /*! \brief is_cacheable - tells if the result of statement may be
+         * reused.
+         *
+         * The statement must be read only and return rows, the results of
+         * a statement with parameters must be keyed on its expanded SQL.
+         * PRAGMA and EXPLAIN statements and those calling
+         * functions whose result changes between calls (random(), the
+         * current time, changes(), ...) aren't cached.
+         */
+        static bool is_cacheable(sqlite3_stmt* statement);
+
+    private:
+
+        struct entry
+        {
+            std::string key;
+            database_version version;
+            nl::json pub_data;
+            std::size_t bytes;
+        };
+        using list_type = std::list<entry>;
+
+        void erase(list_type::iterator position);
+        void evict(std::size_t capacity_bytes);
+
+        std::size_t m_capacity;
+        std::size_t m_bytes = 0;
+        list_type m_entries;
+        std::unordered_map<std::string, list_type::iterator> m_index;
+
+        std::size_t m_hits = 0;
+        std::size_t m_misses = 0;
+        std::size_t m_evictions = 0;
+    };
+}
+
+#endif
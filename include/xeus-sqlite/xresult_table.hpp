@@ -0,0 +1,212 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_RESULT_TABLE_HPP
+#define XEUS_SQLITE_RESULT_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "nlohmann/json.hpp"
+
+#include "xeus_sqlite_config.hpp"
+
+namespace nl = nlohmann;
+
+namespace xeus_sqlite
+{
+    /* Storage class of a single cell, mirrors SQLite fundamental datatypes */
+    enum class cell_type : std::uint8_t
+    {
+        null,
+        integer,
+        real,
+        text,
+        blob
+    };
+
+    /* Appends text to out with the HTML special characters escaped, for
+       the names and values written in text/html bundles */
+    XEUS_SQLITE_API void append_escaped(std::string_view text, std::string& out);
+
+    /*! \brief result_column - one typed column of a query result.
+     *
+     * Every cell is stored as its storage class plus an 8 bytes slot holding
+     * either the number itself or the location of its bytes in the column
+     * arena, so that text and blob values are copied once and never
+     * converted until a renderer asks for them. Values longer than the
+     * value limit only have their first bytes copied, they are rendered as
+     * a preview mentioning their full size.
+     */
+    class XEUS_SQLITE_API result_column
+    {
+    public:
+
+        explicit result_column(std::string name,
+                               std::size_t value_limit = std::numeric_limits<std::size_t>::max());
+
+        const std::string& name() const noexcept;
+        std::size_t size() const noexcept;
+        void reserve(std::size_t rows);
+
+        void push_null();
+        void push_integer(std::int64_t value);
+        void push_real(double value);
+        void push_text(const char* data, std::size_t size);
+        void push_blob(const void* data, std::size_t size);
+
+        cell_type type(std::size_t row) const noexcept;
+        std::int64_t integer(std::size_t row) const noexcept;
+        double real(std::size_t row) const noexcept;
+        /* Bytes of a text or blob cell, valid as long as the column lives */
+        std::string_view bytes(std::size_t row) const noexcept;
+
+        /* True if only the first bytes of the value were kept */
+        bool truncated(std::size_t row) const noexcept;
+        /* Size of the value in the database */
+        std::size_t full_size(std::size_t row) const noexcept;
+
+        /* Appends the text of a cell to out: numbers are only formatted
+           here, with std::to_chars, and blobs as X'..' literals. Long
+           values are previewed with their size and blobs with their
+           detected MIME type */
+        void append_to(std::size_t row, std::string& out) const;
+        std::string to_string(std::size_t row) const;
+
+        /* Numbers stay numbers, NULL is null */
+        nl::json to_json(std::size_t row) const;
+
+    private:
+
+        struct arena_ref
+        {
+            std::uint32_t offset;
+            std::uint32_t size;
+        };
+
+        union cell_slot
+        {
+            std::int64_t integer;
+            double real;
+            arena_ref ref;
+        };
+
+        void push_bytes(cell_type type, const void* data, std::size_t size);
+
+        std::string m_name;
+        std::size_t m_value_limit;
+        std::vector<cell_type> m_types;
+        std::vector<cell_slot> m_slots;
+        std::string m_arena;
+        /* Full sizes of the truncated values, keyed on their row */
+        std::unordered_map<std::size_t, std::size_t> m_full_sizes;
+    };
+
+    /*! \brief display_budget - bounds of a rendered result, 0 is unbounded.
+     *
+     * A result with more rows than rows is rendered as its first and last
+     * rows around a marker of the rows omitted, likewise for the columns.
+     * Rows are dropped from the middle until the rendering fits in bytes.
+     */
+    struct display_budget
+    {
+        std::size_t rows = 0;
+        std::size_t columns = 0;
+        std::size_t bytes = 0;
+    };
+
+    /*! \brief mime_selection - MIME types a result is rendered to.
+     *
+     * Only the renderers of the selected types run, a front end reading
+     * text/plain doesn't pay for the HTML table.
+     */
+    struct mime_selection
+    {
+        bool plain = true;
+        bool html = true;
+    };
+
+    /*! \brief result_table - columnar buffer holding the rows of a query.
+     *
+     * Filled in a single pass over SQLite::Statement::executeStep, then read
+     * by the renderers below, each of them only invoked for the MIME types
+     * that are actually published.
+     */
+    class XEUS_SQLITE_API result_table
+    {
+    public:
+
+        /* Bytes kept of a text or blob value meant to be displayed */
+        static constexpr std::size_t default_value_limit = 4096;
+        static constexpr std::size_t no_value_limit = std::numeric_limits<std::size_t>::max();
+
+        explicit result_table(std::size_t value_limit = default_value_limit);
+
+        /* Resolves the column names of the statement once */
+        void reset(SQLite::Statement& query);
+
+        /* Copies the current row of the statement */
+        void append_row(SQLite::Statement& query);
+
+        /* Steps the statement to completion or until max_rows rows are
+           read, returns the number of rows read */
+        std::size_t fill(SQLite::Statement& query,
+                         std::size_t max_rows = std::numeric_limits<std::size_t>::max());
+
+        std::size_t rows() const noexcept;
+        std::size_t columns() const noexcept;
+        const result_column& column(std::size_t index) const;
+
+        /* text/plain renderer, an aligned table */
+        std::string to_plain(const display_budget& budget = display_budget()) const;
+
+        /* text/html renderer, names and values are escaped */
+        std::string to_html(const display_budget& budget = display_budget()) const;
+
+        /* True if rendering with budget omits rows or columns */
+        bool exceeds(const display_budget& budget) const;
+
+        /* Rows as JSON objects keyed on the column names */
+        nl::json to_records() const;
+
+        /* Bundle published for a query, rendered for the selected types */
+        nl::json mime_bundle(const display_budget& budget = display_budget(),
+                             const mime_selection& mimes = mime_selection()) const;
+
+    private:
+
+        /* Rows and columns rendered within a budget, in order. The
+           omitted ones come after the first head_rows and head_columns */
+        struct display_layout
+        {
+            std::vector<std::size_t> rows;
+            std::vector<std::size_t> columns;
+            std::size_t head_rows = 0;
+            std::size_t head_columns = 0;
+        };
+
+        display_layout layout(const display_budget& budget) const;
+
+        /* "N rows x M columns, K rows omitted" when the layout omits any */
+        std::string omitted_summary(const display_layout& layout) const;
+
+        std::vector<result_column> m_columns;
+        std::size_t m_rows = 0;
+        std::size_t m_value_limit;
+    };
+}
+
+#endif
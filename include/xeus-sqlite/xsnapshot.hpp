@@ -0,0 +1,102 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_SNAPSHOT_HPP
+#define XEUS_SQLITE_SNAPSHOT_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "xeus_sqlite_config.hpp"
+
+namespace xeus_sqlite
+{
+    struct snapshot_stats
+    {
+        std::size_t snapshots = 0;
+        int pages = 0;
+        double elapsed_ms = 0.;
+    };
+
+    /*! \brief snapshotter - copies an in memory database to a file in the
+     * background.
+     *
+     * A thread checks the source every interval and copies it with the
+     * online backup API when it changed since the last snapshot. Pages are
+     * copied a few at a time and the thread yields the connection between
+     * the batches, so that queries run meanwhile are only delayed by the copy
+     * of a batch. The source connection must be opened in serialized mode
+     * (SQLITE_OPEN_FULLMUTEX) since both threads use it.
+     *
+     * Nothing is copied while a transaction is open on the source: periodic
+     * snapshots are postponed to the next interval and flush throws.
+     */
+    class XEUS_SQLITE_API snapshotter
+    {
+    public:
+
+        static constexpr int default_pages_per_step = 64;
+
+        snapshotter(SQLite::Database& source,
+                    std::string path,
+                    std::chrono::milliseconds interval = std::chrono::seconds(10),
+                    int pages_per_step = default_pages_per_step);
+
+        /* Stops the thread after a last snapshot of the changes, skipped
+           while a transaction is open */
+        ~snapshotter();
+
+        snapshotter(const snapshotter&) = delete;
+        snapshotter& operator=(const snapshotter&) = delete;
+
+        /* Waits for a snapshot of the current state, throws if it failed */
+        snapshot_stats flush();
+
+        const std::string& path() const noexcept;
+
+    private:
+
+        void run();
+
+        /* Copies the source if it changed, return an error message or "" */
+        std::string snapshot(bool forced);
+
+        /* True if the source has an open BEGIN */
+        bool in_transaction();
+
+        /* Schema version and total changes of the source */
+        std::int64_t signature();
+
+        SQLite::Database& m_source;
+        std::string m_path;
+        std::chrono::milliseconds m_interval;
+        int m_pages_per_step;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        /* Flushes requested and done, a flush waits for the one it requested */
+        std::size_t m_requested = 0;
+        std::size_t m_completed = 0;
+        std::string m_error;
+        snapshot_stats m_stats;
+        std::int64_t m_signature = 0;
+        bool m_stop = false;
+        std::thread m_thread;
+    };
+}
+
+#endif
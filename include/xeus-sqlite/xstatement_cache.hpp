@@ -0,0 +1,79 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_STATEMENT_CACHE_HPP
+#define XEUS_SQLITE_STATEMENT_CACHE_HPP
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "xeus_sqlite_config.hpp"
+
+namespace xeus_sqlite
+{
+    /*! \brief statement_cache - LRU cache of compiled statements.
+     *
+     * Statements are keyed on their normalized SQL text, so that re-running
+     * a cell only pays for sqlite3_prepare_v2 once. The cache belongs to a
+     * single connection: it must be cleared before that connection is
+     * closed, and it drops every statement when the schema cookie changes.
+     */
+    class XEUS_SQLITE_API statement_cache
+    {
+    public:
+
+        using statement_ptr = std::shared_ptr<SQLite::Statement>;
+
+        explicit statement_cache(std::size_t capacity = 64);
+
+        /* Returns a reset statement for code, compiling it on a miss */
+        statement_ptr acquire(SQLite::Database& db, const std::string& code);
+
+        /* Drops every statement, e.g. before the connection is closed */
+        void clear();
+
+        std::size_t size() const noexcept;
+        std::size_t capacity() const noexcept;
+        std::size_t hits() const noexcept;
+        std::size_t misses() const noexcept;
+        std::size_t evictions() const noexcept;
+        std::size_t invalidations() const noexcept;
+
+        /* Collapses whitespace and strips comments and the trailing
+           semicolon outside of quoted strings and identifiers */
+        static std::string normalize(const std::string& code);
+
+    private:
+
+        using entry_type = std::pair<std::string, statement_ptr>;
+        using list_type = std::list<entry_type>;
+
+        void check_schema(SQLite::Database& db);
+
+        std::size_t m_capacity;
+        list_type m_entries;
+        std::unordered_map<std::string, list_type::iterator> m_index;
+
+        std::unique_ptr<SQLite::Statement> m_schema_query = nullptr;
+        int m_schema_version = -1;
+
+        std::size_t m_hits = 0;
+        std::size_t m_misses = 0;
+        std::size_t m_evictions = 0;
+        std::size_t m_invalidations = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,86 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_TABLE_STORE_HPP
+#define XEUS_SQLITE_TABLE_STORE_HPP
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+
+#include "nlohmann/json.hpp"
+
+#include "xeus_sqlite_config.hpp"
+#include "xexport.hpp"
+#include "xresult_table.hpp"
+
+namespace nl = nlohmann;
+
+namespace xeus_sqlite
+{
+    /*! \brief table_store - results served page by page to the front end.
+     *
+     * A result too large to be displayed is published with a virtual table
+     * entry describing it and holding its first rows. The front end then
+     * opens a comm to the comm_target with the id of the table and sends
+     * {"offset", "count"} messages, each answered by the rows asked for.
+     * Results sent as an Arrow stream are kept the same way, the front end
+     * sends {"format": "arrow"} and receives the messages of the stream as
+     * the buffers of the answer. Only the last results are kept, a page of
+     * a dropped result is an error.
+     */
+    class XEUS_SQLITE_API table_store
+    {
+    public:
+
+        static constexpr const char* mime_type = "application/vnd.xeus-sqlite.table+json";
+        static constexpr const char* comm_target = "xeus-sqlite-table";
+        static constexpr const char* arrow_mime_type = "application/vnd.apache.arrow.stream";
+
+        explicit table_store(std::size_t capacity = 8);
+
+        /* Keeps table, returns its virtual table entry with the first
+           page_rows rows */
+        nl::json add(std::shared_ptr<const result_table> table, std::size_t page_rows);
+
+        using stream_type = message_buffers;
+
+        /* Keeps the messages of an Arrow stream, returns its entry */
+        nl::json add_stream(std::shared_ptr<const stream_type> stream, std::size_t rows);
+
+        /* {"offset", "rows"} with the rows as arrays, or {"error"} */
+        nl::json page(const std::string& id, std::size_t offset, std::size_t count) const;
+
+        /* Messages of the stream id, nullptr if it was dropped */
+        std::shared_ptr<const stream_type> stream(const std::string& id) const;
+
+        void clear();
+        std::size_t size() const;
+
+    private:
+
+        struct entry_type
+        {
+            std::string id;
+            std::shared_ptr<const result_table> table;
+            std::shared_ptr<const stream_type> stream;
+        };
+
+        void keep(entry_type entry);
+        entry_type find(const std::string& id) const;
+
+        static nl::json rows(const result_table& table, std::size_t offset, std::size_t count);
+
+        std::size_t m_capacity;
+        std::list<entry_type> m_tables;
+    };
+}
+
+#endif
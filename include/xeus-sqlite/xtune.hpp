@@ -0,0 +1,63 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#ifndef XEUS_SQLITE_TUNE_HPP
+#define XEUS_SQLITE_TUNE_HPP
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "nlohmann/json.hpp"
+
+#include "xeus_sqlite_config.hpp"
+
+namespace nl = nlohmann;
+
+namespace xeus_sqlite
+{
+    /*! \brief tuning_profile - PRAGMA settings applied to a connection.
+     *
+     * analytics: WAL, 1 GB of memory mapped I/O, 256 MB of page cache,
+     * temporary tables and sorts in memory.
+     * bulkload: in memory rollback journal without synchronization and a
+     * large page cache, a crash during a load may corrupt the database.
+     * safe: rollback journal synchronized on every commit, no memory map
+     * and the default cache, as a freshly opened connection has.
+     */
+    struct tuning_profile
+    {
+        std::string name;
+        std::vector<std::pair<std::string, std::string>> pragmas;
+    };
+
+    /* Names of the built-in profiles */
+    XEUS_SQLITE_API std::vector<std::string> tuning_profile_names();
+
+    /* Throws std::runtime_error listing the profiles if name is unknown */
+    XEUS_SQLITE_API const tuning_profile& find_tuning_profile(const std::string& name);
+
+    /*! \brief apply_tuning_profile - sets the pragmas of a profile.
+     *
+     * Every pragma is set, then read back since SQLite may keep another
+     * value, e.g. the journal mode of a read only or in memory database.
+     * A failing pragma doesn't stop the others.
+     *
+     * return a table of the requested and resulting values
+     */
+    XEUS_SQLITE_API nl::json apply_tuning_profile(SQLite::Database& db,
+                                                  const tuning_profile& profile);
+
+    /* Table of the current values of the pragmas the profiles set */
+    XEUS_SQLITE_API nl::json tuning_report(SQLite::Database& db);
+}
+
+#endif
@@ -10,6 +10,7 @@
 #ifndef XEUS_SQLITE_XVEGA_SQLITE_HPP
 #define XEUS_SQLITE_XVEGA_SQLITE_HPP
 
+#include <cstddef>
 #include <iterator>
 #include <functional>
 #include <map>
@@ -18,6 +19,9 @@
 #include <variant>
 #include <vector>
 
+#include <SQLiteCpp/SQLiteCpp.h>
+
+#include "nlohmann/json.hpp"
 #include "xvega/xvega.hpp"
 #include "xeus_sqlite_config.hpp"
 
@@ -33,6 +37,98 @@ namespace xeus_sqlite
 
         static std::pair<std::vector<std::string>, std::vector<std::string>>
                split_xv_sqlite_input(std::vector<std::string>);
+
+        /* Replaces the data values of the Vega-Lite specs of a chart bundle */
+        static void set_chart_values(nl::json& chart, nl::json values);
+
+        /* Fields and mark of a XVEGA_PLOT input, as far as the reduction
+           of its data needs them. Names are upper case */
+        struct chart_encoding
+        {
+            std::string x_field;
+            std::string y_field;
+            std::string mark;
+            std::string x_type;
+            std::string y_type;
+            std::string x_aggregate;
+            std::string y_aggregate;
+            bool x_bin = false;
+            bool x_time_unit = false;
+            std::size_t max_bins = 10;
+            double bin_step = 0.;
+        };
+
+        static chart_encoding parse_encoding(const std::vector<std::string>& xvega_input);
+
+        enum class reduction_kind
+        {
+            none,
+            group,
+            bins,
+            lttb,
+            sample
+        };
+
+        /* Query computing the data of a chart and how its rows are reduced */
+        struct chart_reduction
+        {
+            reduction_kind kind = reduction_kind::none;
+            std::string query;
+            /* Column of the aggregated values, and of the end of the bins */
+            std::string value_field;
+            std::string bin_end_field;
+            double bin_step = 0.;
+            /* True if the aggregate of the y field was computed by SQLite */
+            bool aggregated = false;
+        };
+
+        static const char* reduction_name(reduction_kind kind);
+
+        /*! \brief plan_reduction - pushes the reduction of a chart into SQLite.
+         *
+         * Aggregates of the y field are computed by a GROUP BY on the x field,
+         * so are the sums of stacked bars. A binned x field counted on y is
+         * binned in SQLite, which runs a first query for the bounds. Lines
+         * are sorted by x for a largest triangle three buckets downsampling
+         * and other marks are sampled, both on the rows read. Only the
+         * fields of the chart are selected. Without budget the query is sql.
+         *
+         * return the query and the reduction of its rows
+         */
+        static chart_reduction plan_reduction(SQLite::Database& db,
+                                              const chart_encoding& encoding,
+                                              const std::string& sql,
+                                              std::size_t budget);
+
+        /*! \brief chart_values - reads the rows of query as chart values.
+         *
+         * At most budget rows are returned, lines are downsampled and the
+         * other charts sampled with a reservoir, so that a single pass over
+         * the rows holds budget rows at most.
+         *
+         * return the values as JSON records
+         */
+        static nl::json chart_values(SQLite::Statement& query,
+                                     const chart_reduction& reduction,
+                                     std::size_t budget);
+
+        /* Removes the aggregates computed by SQLite from the encoding of a
+           chart bundle and marks pushed down bins as binned */
+        static void rewrite_encoding(nl::json& chart,
+                                     const chart_encoding& encoding,
+                                     const chart_reduction& reduction);
+
+        /*! \brief largest_triangle_buckets - LTTB downsampling of a series.
+         *
+         * Keeps the first and last points and, in each of threshold - 2
+         * buckets, the point forming the largest triangle with the point kept
+         * in the previous bucket and the average of the next one.
+         *
+         * return the indices of the points kept, in order
+         */
+        static std::vector<std::size_t> largest_triangle_buckets(const std::vector<double>& x,
+                                                                 const std::vector<double>& y,
+                                                                 std::size_t threshold);
     };
 }
 
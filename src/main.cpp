@@ -26,6 +26,7 @@
 
 #include "xeus-sqlite/xeus_sqlite_interpreter.hpp"
 #include "xeus-sqlite/xeus_sqlite_config.hpp"
+#include "xeus-sqlite/xinterrupt.hpp"
 
 #ifdef __GNUC__
 void handler(int sig)
@@ -47,6 +48,13 @@ void stop_handler(int /*sig*/)
     exit(0);
 }
 
+// Aborts the running query instead of the kernel, so that the session
+// and the in-memory databases survive an interrupt
+void interrupt_handler(int /*sig*/)
+{
+    xeus_sqlite::interrupt_connections();
+}
+
 bool should_print_version(int argc, char* argv[])
 {
     for (int i = 0; i < argc; ++i)
@@ -78,6 +86,19 @@ std::string extract_filename(int argc, char* argv[])
     return res;
 }
 
+// Profile of --tune <profile>, applied to every database the kernel opens
+std::string extract_tuning_profile(int argc, char* argv[])
+{
+    for (int i = 0; i < argc; ++i)
+    {
+        if ((std::string(argv[i]) == "--tune") && (i + 1 < argc))
+        {
+            return argv[i + 1];
+        }
+    }
+    return "";
+}
+
 int main(int argc, char* argv[])
 {
     if (should_print_version(argc, argv))
@@ -94,7 +115,7 @@ int main(int argc, char* argv[])
     // Registering SIGINT and SIGKILL handlers
     signal(SIGKILL, stop_handler);
 #endif
-    signal(SIGINT, stop_handler);
+    signal(SIGINT, interrupt_handler);
 
     // Load configuration file
     std::string file_name = extract_filename(argc, argv);
@@ -105,6 +126,20 @@ int main(int argc, char* argv[])
     using interpreter_ptr = std::unique_ptr<xeus_sqlite::interpreter>;
     interpreter_ptr interpreter = std::make_unique<xeus_sqlite::interpreter>();
 
+    std::string tuning_profile = extract_tuning_profile(argc, argv);
+    if (!tuning_profile.empty())
+    {
+        try
+        {
+            interpreter->set_tuning_profile(tuning_profile);
+        }
+        catch (const std::runtime_error& err)
+        {
+            std::cerr << err.what() << std::endl;
+            return 1;
+        }
+    }
+
     // Create kernel instance and start it
     // xeus::xkernel kernel(config, xeus::get_user_name(), std::move(interpreter));
     // kernel.start();
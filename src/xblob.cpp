@@ -0,0 +1,282 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "xeus-sqlite/xblob.hpp"
+
+namespace xeus_sqlite
+{
+    namespace
+    {
+        bool starts_with(std::string_view bytes, std::string_view signature)
+        {
+            return bytes.compare(0, signature.size(), signature) == 0;
+        }
+
+        /* A sequence cut by the end of head is accepted */
+        bool is_utf8_text(std::string_view head)
+        {
+            std::size_t i = 0;
+            while (i < head.size())
+            {
+                unsigned char c = static_cast<unsigned char>(head[i]);
+                std::size_t length = c < 0x80 ? 1
+                                   : (c >> 5) == 0x6 ? 2
+                                   : (c >> 4) == 0xE ? 3
+                                   : (c >> 3) == 0x1E ? 4 : 0;
+                if (length == 0 || c == 0)
+                {
+                    return false;
+                }
+                for (std::size_t j = 1; j < length; ++j)
+                {
+                    if (i + j == head.size())
+                    {
+                        return true;
+                    }
+                    if ((static_cast<unsigned char>(head[i + j]) & 0xC0) != 0x80)
+                    {
+                        return false;
+                    }
+                }
+                i += length;
+            }
+            return true;
+        }
+
+        /* Lines of 16 bytes: offset, hexadecimal and printable characters */
+        std::string hex_dump(std::string_view bytes)
+        {
+            std::string res;
+            char buffer[24];
+            for (std::size_t line = 0; line < bytes.size(); line += 16)
+            {
+                std::snprintf(buffer, sizeof(buffer), "%08zx ", line);
+                res += buffer;
+                std::string printable;
+                for (std::size_t i = line; i < line + 16; ++i)
+                {
+                    if (i < bytes.size())
+                    {
+                        unsigned char c = static_cast<unsigned char>(bytes[i]);
+                        std::snprintf(buffer, sizeof(buffer), " %02x", c);
+                        res += buffer;
+                        printable += c >= 0x20 && c < 0x7F ? static_cast<char>(c) : '.';
+                    }
+                    else
+                    {
+                        res += "   ";
+                    }
+                }
+                res += "  |" + printable + "|\n";
+            }
+            return res;
+        }
+    }
+
+    std::string detect_mime_type(std::string_view head)
+    {
+        if (starts_with(head, "\x89PNG\r\n\x1a\n"))
+        {
+            return "image/png";
+        }
+        if (starts_with(head, "\xFF\xD8\xFF"))
+        {
+            return "image/jpeg";
+        }
+        if (starts_with(head, "GIF87a") || starts_with(head, "GIF89a"))
+        {
+            return "image/gif";
+        }
+        if (starts_with(head, "RIFF") && head.size() >= 12 && head.substr(8, 4) == "WEBP")
+        {
+            return "image/webp";
+        }
+        if (starts_with(head, "%PDF-"))
+        {
+            return "application/pdf";
+        }
+        if (starts_with(head, "PK\x03\x04"))
+        {
+            return "application/zip";
+        }
+        if (starts_with(head, "\x1F\x8B"))
+        {
+            return "application/gzip";
+        }
+        if (starts_with(head, std::string_view("SQLite format 3\0", 16)))
+        {
+            return "application/vnd.sqlite3";
+        }
+        if (is_utf8_text(head))
+        {
+            return starts_with(head, "<svg") ? "image/svg+xml" : "text/plain";
+        }
+        return "application/octet-stream";
+    }
+
+    std::string base64_encode(std::string_view bytes)
+    {
+        static const char alphabet[] =
+            "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string res;
+        res.reserve((bytes.size() + 2) / 3 * 4);
+        std::size_t i = 0;
+        for (; i + 2 < bytes.size(); i += 3)
+        {
+            std::uint32_t triple = (static_cast<std::uint32_t>(static_cast<unsigned char>(bytes[i])) << 16)
+                                 | (static_cast<std::uint32_t>(static_cast<unsigned char>(bytes[i + 1])) << 8)
+                                 | static_cast<std::uint32_t>(static_cast<unsigned char>(bytes[i + 2]));
+            res += alphabet[(triple >> 18) & 0x3F];
+            res += alphabet[(triple >> 12) & 0x3F];
+            res += alphabet[(triple >> 6) & 0x3F];
+            res += alphabet[triple & 0x3F];
+        }
+        if (i < bytes.size())
+        {
+            std::uint32_t triple = static_cast<std::uint32_t>(static_cast<unsigned char>(bytes[i])) << 16;
+            if (i + 1 < bytes.size())
+            {
+                triple |= static_cast<std::uint32_t>(static_cast<unsigned char>(bytes[i + 1])) << 8;
+            }
+            res += alphabet[(triple >> 18) & 0x3F];
+            res += alphabet[(triple >> 12) & 0x3F];
+            res += i + 1 < bytes.size() ? alphabet[(triple >> 6) & 0x3F] : '=';
+            res += '=';
+        }
+        return res;
+    }
+
+    blob_reader::blob_reader(SQLite::Database& db, const std::string& table,
+                             const std::string& column, std::int64_t rowid)
+        : m_handle(db.getHandle())
+    {
+        std::string schema = "main";
+        std::string name = table;
+        std::size_t dot = table.find('.');
+        if (dot != std::string::npos)
+        {
+            schema = table.substr(0, dot);
+            name = table.substr(dot + 1);
+        }
+
+        int rc = sqlite3_blob_open(m_handle, schema.c_str(), name.c_str(), column.c_str(),
+                                   rowid, 0, &m_blob);
+        if (rc != SQLITE_OK)
+        {
+            sqlite3_blob_close(m_blob);
+            m_blob = nullptr;
+            throw SQLite::Exception(m_handle, rc);
+        }
+        m_size = static_cast<std::size_t>(sqlite3_blob_bytes(m_blob));
+    }
+
+    blob_reader::~blob_reader()
+    {
+        sqlite3_blob_close(m_blob);
+    }
+
+    std::size_t blob_reader::size() const noexcept
+    {
+        return m_size;
+    }
+
+    std::size_t blob_reader::read(char* buffer, std::size_t count, std::size_t offset)
+    {
+        if (offset >= m_size)
+        {
+            return 0;
+        }
+        count = std::min(count, m_size - offset);
+        int rc = sqlite3_blob_read(m_blob, buffer, static_cast<int>(count), static_cast<int>(offset));
+        if (rc != SQLITE_OK)
+        {
+            throw SQLite::Exception(m_handle, rc);
+        }
+        return count;
+    }
+
+    void blob_reader::stream(const sink_type& sink, std::size_t chunk_size)
+    {
+        std::vector<char> chunk(std::min(chunk_size, m_size));
+        for (std::size_t offset = 0; offset < m_size; )
+        {
+            std::size_t count = read(chunk.data(), chunk.size(), offset);
+            sink(std::string_view(chunk.data(), count));
+            offset += count;
+        }
+    }
+
+    std::size_t blob_reader::write_to(const std::string& path)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            throw std::runtime_error("Cannot open " + path + " for writing.");
+        }
+        stream([&file](std::string_view chunk)
+        {
+            file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        });
+        if (!file.flush())
+        {
+            throw std::runtime_error("Failed to write " + path + ".");
+        }
+        return m_size;
+    }
+
+    nl::json blob_reader::mime_bundle()
+    {
+        std::string head(std::min<std::size_t>(m_size, 256), '\0');
+        head.resize(read(&head[0], head.size(), 0));
+        std::string mime = detect_mime_type(head);
+        std::string summary = std::to_string(m_size) + " bytes, " + mime;
+
+        nl::json pub_data;
+        bool image = mime.rfind("image/", 0) == 0;
+        if (image || mime == "text/plain")
+        {
+            if (m_size > inline_limit)
+            {
+                throw std::runtime_error("The value holds " + summary + ", more than the "
+                                         + std::to_string(inline_limit) + " bytes displayed "
+                                         "inline. Pass a file to %BLOB to save it.");
+            }
+            /* Chunks are a multiple of 3 bytes long, so that they are
+               encoded one at a time */
+            bool binary = image && mime != "image/svg+xml";
+            std::string value;
+            value.reserve(binary ? (m_size + 2) / 3 * 4 : m_size);
+            stream([&value, binary](std::string_view chunk)
+            {
+                value += binary ? base64_encode(chunk) : std::string(chunk);
+            });
+            if (image)
+            {
+                pub_data[mime] = std::move(value);
+                pub_data["text/plain"] = summary;
+            }
+            else
+            {
+                pub_data["text/plain"] = std::move(value);
+            }
+        }
+        else
+        {
+            pub_data["text/plain"] = summary + "\n" + hex_dump(head)
+                                     + (m_size > head.size() ? "...\nPass a file to %BLOB to save the whole value.\n" : "");
+        }
+        return pub_data;
+    }
+}
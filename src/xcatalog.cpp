@@ -0,0 +1,732 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+
+#include "xeus-sqlite/xcatalog.hpp"
+
+namespace xeus_sqlite
+{
+    namespace
+    {
+        /* Sorted, so that keywords are found with a binary search */
+        constexpr std::array<std::string_view, 147> sql_keywords =
+        {
+            "ABORT",
+            "ACTION",
+            "ADD",
+            "AFTER",
+            "ALL",
+            "ALTER",
+            "ALWAYS",
+            "ANALYZE",
+            "AND",
+            "AS",
+            "ASC",
+            "ATTACH",
+            "AUTOINCREMENT",
+            "BEFORE",
+            "BEGIN",
+            "BETWEEN",
+            "BY",
+            "CASCADE",
+            "CASE",
+            "CAST",
+            "CHECK",
+            "COLLATE",
+            "COLUMN",
+            "COMMIT",
+            "CONFLICT",
+            "CONSTRAINT",
+            "CREATE",
+            "CROSS",
+            "CURRENT",
+            "CURRENT_DATE",
+            "CURRENT_TIME",
+            "CURRENT_TIMESTAMP",
+            "DATABASE",
+            "DEFAULT",
+            "DEFERRABLE",
+            "DEFERRED",
+            "DELETE",
+            "DESC",
+            "DETACH",
+            "DISTINCT",
+            "DO",
+            "DROP",
+            "EACH",
+            "ELSE",
+            "END",
+            "ESCAPE",
+            "EXCEPT",
+            "EXCLUDE",
+            "EXCLUSIVE",
+            "EXISTS",
+            "EXPLAIN",
+            "FAIL",
+            "FILTER",
+            "FIRST",
+            "FOLLOWING",
+            "FOR",
+            "FOREIGN",
+            "FROM",
+            "FULL",
+            "GENERATED",
+            "GLOB",
+            "GROUP",
+            "GROUPS",
+            "HAVING",
+            "IF",
+            "IGNORE",
+            "IMMEDIATE",
+            "IN",
+            "INDEX",
+            "INDEXED",
+            "INITIALLY",
+            "INNER",
+            "INSERT",
+            "INSTEAD",
+            "INTERSECT",
+            "INTO",
+            "IS",
+            "ISNULL",
+            "JOIN",
+            "KEY",
+            "LAST",
+            "LEFT",
+            "LIKE",
+            "LIMIT",
+            "MATCH",
+            "MATERIALIZED",
+            "NATURAL",
+            "NO",
+            "NOT",
+            "NOTHING",
+            "NOTNULL",
+            "NULL",
+            "NULLS",
+            "OF",
+            "OFFSET",
+            "ON",
+            "OR",
+            "ORDER",
+            "OTHERS",
+            "OUTER",
+            "OVER",
+            "PARTITION",
+            "PLAN",
+            "PRAGMA",
+            "PRECEDING",
+            "PRIMARY",
+            "QUERY",
+            "RAISE",
+            "RANGE",
+            "RECURSIVE",
+            "REFERENCES",
+            "REGEXP",
+            "REINDEX",
+            "RELEASE",
+            "RENAME",
+            "REPLACE",
+            "RESTRICT",
+            "RETURNING",
+            "RIGHT",
+            "ROLLBACK",
+            "ROW",
+            "ROWS",
+            "SAVEPOINT",
+            "SELECT",
+            "SET",
+            "TABLE",
+            "TEMP",
+            "TEMPORARY",
+            "THEN",
+            "TIES",
+            "TO",
+            "TRANSACTION",
+            "TRIGGER",
+            "UNBOUNDED",
+            "UNION",
+            "UNIQUE",
+            "UPDATE",
+            "USING",
+            "VACUUM",
+            "VALUES",
+            "VIEW",
+            "VIRTUAL",
+            "WHEN",
+            "WHERE",
+            "WINDOW",
+            "WITH",
+            "WITHOUT"
+        };
+
+        inline bool is_identifier(char c)
+        {
+            unsigned char uc = static_cast<unsigned char>(c);
+            return std::isalnum(uc) || c == '_' || uc >= 0x80;
+        }
+
+        std::string to_upper(std::string_view text)
+        {
+            std::string res(text);
+            for (char& c : res)
+            {
+                c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+            }
+            return res;
+        }
+
+        bool is_keyword(std::string_view upper)
+        {
+            return std::binary_search(sql_keywords.begin(), sql_keywords.end(), upper);
+        }
+
+        bool starts_with(std::string_view text, std::string_view prefix)
+        {
+            return text.compare(0, prefix.size(), prefix) == 0;
+        }
+
+        std::string quote(const std::string& text, char delimiter)
+        {
+            std::string res(1, delimiter);
+            for (char c : text)
+            {
+                if (c == delimiter)
+                {
+                    res += c;
+                }
+                res += c;
+            }
+            res += delimiter;
+            return res;
+        }
+
+        /* Names that aren't plain identifiers are completed quoted */
+        std::string completion_name(const std::string& name)
+        {
+            bool plain = !name.empty() && !std::isdigit(static_cast<unsigned char>(name[0])) &&
+                         std::all_of(name.begin(), name.end(), is_identifier);
+            return plain && !is_keyword(to_upper(name)) ? name : quote(name, '"');
+        }
+
+        struct sql_token
+        {
+            std::string text;
+            std::string upper;
+            std::size_t offset;
+            bool word;
+            bool quoted;
+        };
+
+        /* Splits code into words, quoted identifiers and punctuation,
+           string literals and comments are skipped */
+        std::vector<sql_token> tokenize(const std::string& code)
+        {
+            std::vector<sql_token> tokens;
+            std::size_t size = code.size();
+            std::size_t i = 0;
+            while (i < size)
+            {
+                char c = code[i];
+                if (std::isspace(static_cast<unsigned char>(c)))
+                {
+                    ++i;
+                }
+                else if (c == '-' && i + 1 < size && code[i + 1] == '-')
+                {
+                    i = std::min(code.find('\n', i), size);
+                }
+                else if (c == '/' && i + 1 < size && code[i + 1] == '*')
+                {
+                    std::size_t end = code.find("*/", i + 2);
+                    i = end == std::string::npos ? size : end + 2;
+                }
+                else if (c == '\'' || c == '"' || c == '`' || c == '[')
+                {
+                    char closing = c == '[' ? ']' : c;
+                    std::size_t end = code.find(closing, i + 1);
+                    end = end == std::string::npos ? size : end;
+                    if (c == '\'')
+                    {
+                        tokens.push_back({"'", "'", i, false, false});
+                    }
+                    else
+                    {
+                        std::string text = code.substr(i + 1, end - i - 1);
+                        tokens.push_back({text, to_upper(text), i, true, true});
+                    }
+                    i = end + 1;
+                }
+                else if (is_identifier(c))
+                {
+                    std::size_t start = i;
+                    while (i < size && is_identifier(code[i]))
+                    {
+                        ++i;
+                    }
+                    std::string text = code.substr(start, i - start);
+                    tokens.push_back({text, to_upper(text), start, true, false});
+                }
+                else
+                {
+                    tokens.push_back({std::string(1, c), std::string(1, c), i, false, false});
+                    ++i;
+                }
+            }
+            return tokens;
+        }
+
+        inline bool is_keyword_token(const sql_token& token, std::string_view keyword)
+        {
+            return token.word && !token.quoted && token.upper == keyword;
+        }
+
+        inline bool is_name_token(const sql_token& token)
+        {
+            return token.word && (token.quoted || !is_keyword(token.upper));
+        }
+
+        inline bool is_punctuation(const sql_token& token, char c)
+        {
+            return !token.word && token.text.size() == 1 && token.text[0] == c;
+        }
+
+        /* Tables the statement refers to, and the tables of their aliases */
+        struct table_references
+        {
+            std::vector<std::string> tables;
+            std::unordered_map<std::string, std::string> aliases;
+        };
+
+        table_references find_references(const std::vector<sql_token>& tokens,
+                                          std::size_t first, std::size_t last)
+        {
+            table_references res;
+            bool in_from = false;
+            for (std::size_t i = first; i < last; ++i)
+            {
+                const sql_token& token = tokens[i];
+                bool table_follows = false;
+                if (is_keyword_token(token, "FROM") || is_keyword_token(token, "JOIN"))
+                {
+                    in_from = true;
+                    table_follows = true;
+                }
+                else if (is_keyword_token(token, "UPDATE") || is_keyword_token(token, "INTO"))
+                {
+                    table_follows = true;
+                }
+                else if (is_punctuation(token, ','))
+                {
+                    table_follows = in_from;
+                }
+                else if (token.word && !token.quoted && token.upper != "AS" && is_keyword(token.upper))
+                {
+                    in_from = in_from && (token.upper == "LEFT" || token.upper == "RIGHT" ||
+                                          token.upper == "FULL" || token.upper == "INNER" ||
+                                          token.upper == "OUTER" || token.upper == "CROSS" ||
+                                          token.upper == "NATURAL");
+                }
+
+                std::size_t j = i + 1;
+                if (!table_follows || j >= last || !is_name_token(tokens[j]))
+                {
+                    continue;
+                }
+                std::string table = tokens[j].text;
+                if (j + 2 < last && is_punctuation(tokens[j + 1], '.') && is_name_token(tokens[j + 2]))
+                {
+                    table += "." + tokens[j + 2].text;
+                    j += 2;
+                }
+                res.tables.push_back(table);
+
+                std::size_t k = j + 1;
+                if (k < last && is_keyword_token(tokens[k], "AS"))
+                {
+                    ++k;
+                }
+                if (k < last && is_name_token(tokens[k]))
+                {
+                    res.aliases[tokens[k].upper] = table;
+                    i = k;
+                }
+                else
+                {
+                    i = j;
+                }
+            }
+            return res;
+        }
+
+        /* True if FROM or JOIN is the last clause keyword before tokens[end] */
+        bool in_from_clause(const std::vector<sql_token>& tokens, std::size_t first, std::size_t end)
+        {
+            for (std::size_t i = end; i > first; --i)
+            {
+                const sql_token& token = tokens[i - 1];
+                if (is_keyword_token(token, "FROM") || is_keyword_token(token, "JOIN"))
+                {
+                    return true;
+                }
+                if (token.word && !token.quoted && token.upper != "AS" && is_keyword(token.upper))
+                {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        /* Collects matches in order, without duplicates ignoring case */
+        class match_list
+        {
+        public:
+
+            bool full() const noexcept
+            {
+                return m_matches.size() >= catalog::max_matches;
+            }
+
+            void add(const std::string& name)
+            {
+                if (!full() && m_seen.insert(to_upper(name)).second)
+                {
+                    m_matches.push_back(name);
+                }
+            }
+
+            void add(const std::vector<std::string>& names)
+            {
+                for (const auto& name : names)
+                {
+                    add(name);
+                }
+            }
+
+            std::vector<std::string> release()
+            {
+                return std::move(m_matches);
+            }
+
+        private:
+
+            std::vector<std::string> m_matches;
+            std::unordered_set<std::string> m_seen;
+        };
+    }
+
+    catalog::catalog()
+    {
+        clear();
+    }
+
+    bool catalog::refresh(SQLite::Database& db)
+    {
+        /* Attached databases and their schema cookies, checked on every
+           completion, the index is only rebuilt when they change */
+        std::vector<std::string> schemas;
+        std::string signature;
+        SQLite::Statement database_list(db, "PRAGMA database_list");
+        while (database_list.executeStep())
+        {
+            schemas.push_back(database_list.getColumn(1).getString());
+        }
+        for (const auto& schema : schemas)
+        {
+            SQLite::Statement version(db, "PRAGMA " + quote(schema, '"') + ".schema_version");
+            version.executeStep();
+            signature += schema + '\x1f' + version.getColumn(0).getString() + '\x1e';
+        }
+
+        if (signature == m_signature)
+        {
+            return false;
+        }
+        rebuild(db, schemas);
+        m_signature = std::move(signature);
+        ++m_rebuilds;
+        return true;
+    }
+
+    void catalog::clear()
+    {
+        m_entries.clear();
+        m_columns.clear();
+        m_signature.clear();
+        for (std::string_view keyword : sql_keywords)
+        {
+            m_entries.push_back({std::string(keyword), std::string(keyword), "", kind::keyword});
+        }
+    }
+
+    std::vector<std::string> catalog::lookup(const std::string& prefix,
+                                             std::initializer_list<kind> kinds) const
+    {
+        return collect(prefix, kinds, "");
+    }
+
+    std::vector<std::string> catalog::columns(const std::string& table,
+                                              const std::string& prefix) const
+    {
+        std::vector<std::string> res;
+        auto found = m_columns.find(to_upper(table));
+        if (found == m_columns.end())
+        {
+            return res;
+        }
+        std::string key = to_upper(prefix);
+        for (const auto& column : found->second)
+        {
+            if (starts_with(to_upper(column), key))
+            {
+                res.push_back(completion_name(column));
+            }
+        }
+        return res;
+    }
+
+    catalog::completion catalog::complete(const std::string& code, std::size_t cursor) const
+    {
+        completion res;
+        std::size_t end = std::min(cursor, code.size());
+        std::size_t start = end;
+        while (start > 0 && is_identifier(code[start - 1]))
+        {
+            --start;
+        }
+        res.cursor_start = start;
+        std::string prefix = code.substr(start, end - start);
+
+        /* Only the statement holding the cursor is looked at */
+        std::vector<sql_token> tokens = tokenize(code);
+        std::size_t first = 0;
+        std::size_t last = tokens.size();
+        for (std::size_t i = 0; i < tokens.size(); ++i)
+        {
+            if (is_punctuation(tokens[i], ';'))
+            {
+                if (tokens[i].offset < start)
+                {
+                    first = i + 1;
+                }
+                else
+                {
+                    last = i;
+                    break;
+                }
+            }
+        }
+        std::size_t before = first;
+        while (before < last && tokens[before].offset < start)
+        {
+            ++before;
+        }
+        table_references references = find_references(tokens, first, last);
+
+        auto previous = [&](std::size_t n) -> const sql_token*
+        {
+            return before >= first + n ? &tokens[before - n] : nullptr;
+        };
+        const sql_token* p1 = previous(1);
+        const sql_token* p2 = previous(2);
+
+        match_list matches;
+        if (p1 != nullptr && is_punctuation(*p1, '.') && p1->offset + 1 == start &&
+            p2 != nullptr && p2->word)
+        {
+            /* alias.column, table.column, schema.table.column or schema.table */
+            std::string qualifier = p2->text;
+            const sql_token* p3 = previous(3);
+            const sql_token* p4 = previous(4);
+            if (p3 != nullptr && is_punctuation(*p3, '.') && p4 != nullptr && p4->word)
+            {
+                qualifier = p4->text + "." + qualifier;
+            }
+            auto alias = references.aliases.find(to_upper(qualifier));
+            matches.add(columns(alias != references.aliases.end() ? alias->second : qualifier, prefix));
+            matches.add(collect(prefix, {kind::table, kind::view}, to_upper(qualifier)));
+        }
+        else if (p1 != nullptr && (is_keyword_token(*p1, "INDEX") ||
+                                   (is_keyword_token(*p1, "BY") && p2 != nullptr &&
+                                    is_keyword_token(*p2, "INDEXED"))))
+        {
+            matches.add(collect(prefix, {kind::index}, ""));
+        }
+        else if (p1 != nullptr && (is_keyword_token(*p1, "FROM") || is_keyword_token(*p1, "JOIN") ||
+                                   is_keyword_token(*p1, "INTO") || is_keyword_token(*p1, "UPDATE") ||
+                                   is_keyword_token(*p1, "TABLE") || is_keyword_token(*p1, "EXISTS") ||
+                                   (is_punctuation(*p1, ',') && in_from_clause(tokens, first, before))))
+        {
+            matches.add(collect(prefix, {kind::table, kind::view, kind::schema}, ""));
+        }
+        else
+        {
+            for (const auto& table : references.tables)
+            {
+                matches.add(columns(table, prefix));
+            }
+            matches.add(collect(prefix, {kind::keyword, kind::function}, ""));
+            matches.add(collect(prefix, {kind::table, kind::view, kind::schema}, ""));
+            matches.add(collect(prefix, {kind::column}, ""));
+        }
+        res.matches = matches.release();
+        return res;
+    }
+
+    std::vector<std::string> catalog::collect(const std::string& prefix,
+                                              std::initializer_list<kind> kinds,
+                                              const std::string& owner) const
+    {
+        std::vector<std::string> res;
+        std::string key = to_upper(prefix);
+        auto it = std::lower_bound(m_entries.begin(), m_entries.end(), key,
+                                   [](const entry& lhs, const std::string& rhs) { return lhs.key < rhs; });
+        for (; it != m_entries.end() && starts_with(it->key, key) && res.size() < max_matches; ++it)
+        {
+            if (std::find(kinds.begin(), kinds.end(), it->type) == kinds.end() ||
+                (!owner.empty() && it->owner != owner))
+            {
+                continue;
+            }
+            bool verbatim = it->type == kind::keyword || it->type == kind::function;
+            res.push_back(verbatim ? it->name : completion_name(it->name));
+        }
+        return res;
+    }
+
+    void catalog::rebuild(SQLite::Database& db, const std::vector<std::string>& schemas)
+    {
+        clear();
+        for (const auto& schema : schemas)
+        {
+            std::string schema_key = to_upper(schema);
+            m_entries.push_back({schema_key, schema, "", kind::schema});
+
+            SQLite::Statement objects(db, "SELECT type, name FROM " + quote(schema, '"') + ".sqlite_master "
+                                          "WHERE type IN ('table', 'view', 'index') "
+                                          "AND name NOT LIKE 'sqlite\\_%' ESCAPE '\\'");
+            while (objects.executeStep())
+            {
+                std::string type = objects.getColumn(0).getString();
+                std::string name = objects.getColumn(1).getString();
+                kind object_kind = type == "table" ? kind::table : (type == "view" ? kind::view : kind::index);
+                m_entries.push_back({to_upper(name), name, schema_key, object_kind});
+            }
+            read_columns(db, schema);
+        }
+
+        try
+        {
+            SQLite::Statement functions(db, "SELECT DISTINCT name FROM pragma_function_list");
+            while (functions.executeStep())
+            {
+                std::string name = functions.getColumn(0).getString();
+                m_entries.push_back({to_upper(name), name, "", kind::function});
+            }
+        }
+        catch (const SQLite::Exception&)
+        {
+            /* pragma_function_list isn't available in every SQLite build */
+        }
+        sort_entries();
+    }
+
+    void catalog::read_columns(SQLite::Database& db, const std::string& schema)
+    {
+        std::string master = quote(schema, '"') + ".sqlite_master";
+        std::string schema_literal = quote(schema, '\'');
+        std::vector<std::pair<std::string, std::string>> table_columns;
+        try
+        {
+            SQLite::Statement query(db, "SELECT m.name, p.name FROM " + master + " m, "
+                                        "pragma_table_info(m.name, " + schema_literal + ") p "
+                                        "WHERE m.type IN ('table', 'view') ORDER BY m.name, p.cid");
+            while (query.executeStep())
+            {
+                table_columns.emplace_back(query.getColumn(0).getString(), query.getColumn(1).getString());
+            }
+        }
+        catch (const SQLite::Exception&)
+        {
+            /* A view on a dropped table, or a virtual table whose module
+               isn't loaded, fails the whole query: tables are then read one
+               by one and those failing are skipped */
+            table_columns.clear();
+            std::vector<std::string> tables;
+            SQLite::Statement list(db, "SELECT name FROM " + master + " WHERE type IN ('table', 'view')");
+            while (list.executeStep())
+            {
+                tables.push_back(list.getColumn(0).getString());
+            }
+            for (const auto& table : tables)
+            {
+                try
+                {
+                    SQLite::Statement query(db, "SELECT name FROM pragma_table_info(?, " + schema_literal + ")");
+                    query.bind(1, table);
+                    while (query.executeStep())
+                    {
+                        table_columns.emplace_back(table, query.getColumn(0).getString());
+                    }
+                }
+                catch (const SQLite::Exception&)
+                {
+                }
+            }
+        }
+
+        /* Unqualified names resolve to the first schema holding the table */
+        std::unordered_map<std::string, std::vector<std::string>> schema_columns;
+        for (auto& table_column : table_columns)
+        {
+            std::string& column = table_column.second;
+            std::string table_key = to_upper(table_column.first);
+            m_entries.push_back({to_upper(column), column, table_key, kind::column});
+            schema_columns[table_key].push_back(std::move(column));
+        }
+        std::string schema_key = to_upper(schema);
+        for (auto& table : schema_columns)
+        {
+            m_columns.emplace(table.first, table.second);
+            m_columns[schema_key + "." + table.first] = std::move(table.second);
+        }
+    }
+
+    void catalog::sort_entries()
+    {
+        std::sort(m_entries.begin(), m_entries.end(), [](const entry& lhs, const entry& rhs)
+        {
+            return lhs.key != rhs.key ? lhs.key < rhs.key : lhs.type < rhs.type;
+        });
+
+        /* The columns of a table are looked up in m_columns, the index only
+           needs one entry per column name */
+        auto last = std::unique(m_entries.begin(), m_entries.end(), [](const entry& lhs, const entry& rhs)
+        {
+            return lhs.type == kind::column && rhs.type == kind::column && lhs.name == rhs.name;
+        });
+        m_entries.erase(last, m_entries.end());
+    }
+
+    std::size_t catalog::size() const noexcept
+    {
+        return m_entries.size();
+    }
+
+    std::size_t catalog::rebuilds() const noexcept
+    {
+        return m_rebuilds;
+    }
+}
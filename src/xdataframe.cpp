@@ -0,0 +1,365 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <charconv>
+#include <cstdio>
+#include <stdexcept>
+
+#include "xeus-sqlite/xdataframe.hpp"
+
+namespace xeus_sqlite
+{
+    namespace
+    {
+        constexpr std::size_t bits_per_word = 64;
+
+        std::string integer_text(std::int64_t value)
+        {
+            char buffer[24];
+            auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            return std::string(buffer, res.ptr);
+        }
+
+        /* Same output as the "%.15g" format used by SQLite */
+        std::string real_text(double value)
+        {
+            char buffer[32];
+            int size = std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+            return std::string(buffer, static_cast<std::size_t>(size));
+        }
+    }
+
+    /*****************************
+     * dataframe_column implementation
+     *****************************/
+
+    dataframe_column::dataframe_column(std::string name)
+        : m_name(std::move(name))
+    {
+    }
+
+    const std::string& dataframe_column::name() const noexcept
+    {
+        return m_name;
+    }
+
+    column_kind dataframe_column::kind() const noexcept
+    {
+        return m_kind;
+    }
+
+    std::size_t dataframe_column::size() const noexcept
+    {
+        return m_size;
+    }
+
+    void dataframe_column::reserve(std::size_t rows)
+    {
+        m_validity.reserve((rows + bits_per_word - 1) / bits_per_word);
+        switch (m_kind)
+        {
+            case column_kind::integer:
+                m_integers.reserve(rows);
+                break;
+            case column_kind::real:
+                m_reals.reserve(rows);
+                break;
+            default:
+                m_codes.reserve(rows);
+                break;
+        }
+    }
+
+    void dataframe_column::push_null()
+    {
+        switch (m_kind)
+        {
+            case column_kind::integer:
+                m_integers.push_back(0);
+                break;
+            case column_kind::real:
+                m_reals.push_back(0.);
+                break;
+            default:
+                m_codes.push_back(0);
+                break;
+        }
+        push_valid(false);
+    }
+
+    void dataframe_column::push_integer(std::int64_t value)
+    {
+        switch (m_kind)
+        {
+            case column_kind::integer:
+                m_integers.push_back(value);
+                break;
+            case column_kind::real:
+                m_reals.push_back(static_cast<double>(value));
+                break;
+            default:
+                m_codes.push_back(code(integer_text(value)));
+                break;
+        }
+        push_valid(true);
+    }
+
+    void dataframe_column::push_real(double value)
+    {
+        if (m_kind == column_kind::integer)
+        {
+            promote_to_real();
+        }
+        if (m_kind == column_kind::real)
+        {
+            m_reals.push_back(value);
+        }
+        else
+        {
+            m_codes.push_back(code(real_text(value)));
+        }
+        push_valid(true);
+    }
+
+    void dataframe_column::push_text(std::string_view value)
+    {
+        if (m_kind != column_kind::text)
+        {
+            promote_to_text();
+        }
+        m_codes.push_back(code(value));
+        push_valid(true);
+    }
+
+    bool dataframe_column::is_null(std::size_t row) const noexcept
+    {
+        return (m_validity[row / bits_per_word] >> (row % bits_per_word) & 1u) == 0;
+    }
+
+    std::size_t dataframe_column::null_count() const noexcept
+    {
+        return m_null_count;
+    }
+
+    std::int64_t dataframe_column::integer(std::size_t row) const noexcept
+    {
+        return m_integers[row];
+    }
+
+    double dataframe_column::real(std::size_t row) const noexcept
+    {
+        return m_kind == column_kind::integer ? static_cast<double>(m_integers[row]) : m_reals[row];
+    }
+
+    const std::string& dataframe_column::text(std::size_t row) const noexcept
+    {
+        return m_dictionary[m_codes[row]];
+    }
+
+    const std::vector<std::string>& dataframe_column::dictionary() const noexcept
+    {
+        return m_dictionary;
+    }
+
+    double dataframe_column::number(std::size_t row, double fallback) const noexcept
+    {
+        if (m_kind == column_kind::text || is_null(row))
+        {
+            return fallback;
+        }
+        return real(row);
+    }
+
+    nl::json dataframe_column::to_json(std::size_t row) const
+    {
+        if (is_null(row))
+        {
+            return nullptr;
+        }
+        switch (m_kind)
+        {
+            case column_kind::integer:
+                return m_integers[row];
+            case column_kind::real:
+                return m_reals[row];
+            default:
+                return text(row);
+        }
+    }
+
+    void dataframe_column::push_valid(bool valid)
+    {
+        if (m_size % bits_per_word == 0)
+        {
+            m_validity.push_back(0);
+        }
+        if (valid)
+        {
+            m_validity.back() |= std::uint64_t(1) << (m_size % bits_per_word);
+        }
+        else
+        {
+            ++m_null_count;
+        }
+        ++m_size;
+    }
+
+    void dataframe_column::promote_to_real()
+    {
+        m_reals.reserve(m_integers.capacity());
+        for (std::int64_t value : m_integers)
+        {
+            m_reals.push_back(static_cast<double>(value));
+        }
+        m_integers = std::vector<std::int64_t>();
+        m_kind = column_kind::real;
+    }
+
+    void dataframe_column::promote_to_text()
+    {
+        m_codes.reserve(m_kind == column_kind::integer ? m_integers.capacity() : m_reals.capacity());
+        for (std::size_t row = 0; row < m_size; ++row)
+        {
+            if (is_null(row))
+            {
+                m_codes.push_back(0);
+            }
+            else
+            {
+                m_codes.push_back(code(m_kind == column_kind::integer ? integer_text(m_integers[row])
+                                                                      : real_text(m_reals[row])));
+            }
+        }
+        m_integers = std::vector<std::int64_t>();
+        m_reals = std::vector<double>();
+        m_kind = column_kind::text;
+    }
+
+    std::uint32_t dataframe_column::code(std::string_view value)
+    {
+        std::string key(value);
+        auto found = m_lookup.find(key);
+        if (found != m_lookup.end())
+        {
+            return found->second;
+        }
+        if (m_dictionary.size() == std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::runtime_error("Too many distinct texts in column " + m_name + ".");
+        }
+        std::uint32_t res = static_cast<std::uint32_t>(m_dictionary.size());
+        m_dictionary.push_back(key);
+        m_lookup.emplace(std::move(key), res);
+        return res;
+    }
+
+    /**********************
+     * dataframe implementation
+     **********************/
+
+    void dataframe::reset(SQLite::Statement& query)
+    {
+        m_columns.clear();
+        m_rows = 0;
+        int column_count = query.getColumnCount();
+        m_columns.reserve(static_cast<std::size_t>(column_count));
+        for (int col = 0; col < column_count; ++col)
+        {
+            m_columns.emplace_back(query.getColumnName(col));
+        }
+    }
+
+    void dataframe::append_row(SQLite::Statement& query)
+    {
+        for (std::size_t col = 0; col < m_columns.size(); ++col)
+        {
+            SQLite::Column cell = query.getColumn(static_cast<int>(col));
+            dataframe_column& column = m_columns[col];
+            switch (cell.getType())
+            {
+                case SQLite::INTEGER:
+                    column.push_integer(cell.getInt64());
+                    break;
+                case SQLite::FLOAT:
+                    column.push_real(cell.getDouble());
+                    break;
+                case SQLite::TEXT:
+                {
+                    const char* text = cell.getText();
+                    column.push_text(std::string_view(text, static_cast<std::size_t>(cell.getBytes())));
+                    break;
+                }
+                default:
+                    column.push_null();
+                    break;
+            }
+        }
+        ++m_rows;
+    }
+
+    std::size_t dataframe::fill(SQLite::Statement& query, std::size_t max_rows)
+    {
+        reset(query);
+        while (m_rows < max_rows && query.executeStep())
+        {
+            append_row(query);
+        }
+        return m_rows;
+    }
+
+    std::size_t dataframe::rows() const noexcept
+    {
+        return m_rows;
+    }
+
+    std::size_t dataframe::columns() const noexcept
+    {
+        return m_columns.size();
+    }
+
+    const dataframe_column& dataframe::column(std::size_t index) const
+    {
+        return m_columns.at(index);
+    }
+
+    nl::json dataframe::to_values() const
+    {
+        nl::json values = nl::json::array();
+        auto& records = values.get_ref<nl::json::array_t&>();
+        records.reserve(m_rows);
+        for (std::size_t row = 0; row < m_rows; ++row)
+        {
+            records.push_back(record(row));
+        }
+        return values;
+    }
+
+    nl::json dataframe::to_values(const std::vector<std::size_t>& rows) const
+    {
+        nl::json values = nl::json::array();
+        auto& records = values.get_ref<nl::json::array_t&>();
+        records.reserve(rows.size());
+        for (std::size_t row : rows)
+        {
+            records.push_back(record(row));
+        }
+        return values;
+    }
+
+    nl::json dataframe::record(std::size_t row) const
+    {
+        nl::json res = nl::json::object();
+        auto& fields = res.get_ref<nl::json::object_t&>();
+        for (const dataframe_column& column : m_columns)
+        {
+            fields.emplace(column.name(), column.to_json(row));
+        }
+        return res;
+    }
+}
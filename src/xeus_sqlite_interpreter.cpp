@@ -7,20 +7,29 @@
 * The full license is in the file LICENSE, distributed with this software. *
 ****************************************************************************/
 
+#include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <memory>
 #include <sstream>
 #include <stack>
+#include <thread>
 #include <vector>
 #include <tuple>
 
 #include "xvega-bindings/xvega_bindings.hpp"
+#include "xeus/xguid.hpp"
 #include "xeus/xinterpreter.hpp"
-#include "tabulate/table.hpp"
 
+#include "xeus-sqlite/xblob.hpp"
 #include "xeus-sqlite/xeus_sqlite_interpreter.hpp"
+#include "xeus-sqlite/xfunctions.hpp"
+#include "xeus-sqlite/xinterrupt.hpp"
+#include "xeus-sqlite/xsnapshot.hpp"
+#include "xeus-sqlite/xtune.hpp"
 
 #include <SQLiteCpp/VariadicBind.h>
 #include <SQLiteCpp/SQLiteCpp.h>
@@ -39,13 +48,60 @@ namespace xeus_lite
 namespace xeus_sqlite
 {
 
-    inline bool startswith(const std::string& str, const std::string& cmp)
+    /* Value of an <on | off> argument, throws usage for anything else */
+    static bool parse_switch(const std::string& value, const std::string& usage)
     {
-      return str.compare(0, cmp.length(), cmp) == 0;
+        if (xv_bindings::case_insentive_equals(value, "ON"))
+        {
+            return true;
+        }
+        if (xv_bindings::case_insentive_equals(value, "OFF"))
+        {
+            return false;
+        }
+        throw std::runtime_error(usage);
+    }
+
+    /* True if code holds another statement after its first semicolon,
+       quoted strings, identifiers and comments are skipped */
+    static bool has_several_statements(const std::string& code)
+    {
+        std::string normalized = statement_cache::normalize(code);
+        char closing = 0;
+        for (char c : normalized)
+        {
+            if (closing != 0)
+            {
+                closing = c == closing ? 0 : closing;
+            }
+            else if (c == '\'' || c == '"' || c == '`')
+            {
+                closing = c;
+            }
+            else if (c == '[')
+            {
+                closing = ']';
+            }
+            else if (c == ';')
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* True if the magic starting at first is name */
+    static bool is_magic_cell(const std::string& code, std::size_t first, const std::string& name)
+    {
+        std::size_t end = code.find_first_of(" \t\r\n", first);
+        return xv_bindings::case_insentive_equals(code.substr(first + 1, end - first - 1), name);
     }
-    inline static bool is_identifier(char c)
+
+    /* False for in memory databases, including %LOAD <path> memory */
+    static bool is_file_database(SQLite::Database& db)
     {
-        return std::isalpha(c) || std::isdigit(c) || c == '_';
+        const char* filename = sqlite3_db_filename(db.getHandle(), "main");
+        return filename != nullptr && filename[0] != '\0';
     }
 
     interpreter::interpreter()
@@ -53,6 +109,11 @@ namespace xeus_sqlite
         xeus::register_interpreter(this);
     }
 
+    interpreter::~interpreter()
+    {
+        release_statements();
+    }
+
     void interpreter::load_db(const std::vector<std::string> tokenized_input)
     {
         /*
@@ -60,43 +121,118 @@ namespace xeus_sqlite
             to read and write mode.
         */
 
-        if (tokenized_input.back().find("rw") != std::string::npos)
+        const std::string& path = tokenized_input[1];
+        int flags = 0;
+        if (tokenized_input.size() > 2
+            && xv_bindings::case_insentive_equals(tokenized_input[2], "MEMORY"))
         {
-            m_bd_is_loaded = true;
-            m_db = std::make_unique<SQLite::Database>(m_db_path,
-                        SQLite::OPEN_READWRITE);
+            return load_db_in_memory(path);
+        }
+        else if (tokenized_input.back().find("rw") != std::string::npos)
+        {
+            flags = SQLite::OPEN_READWRITE;
         }
         else if (tokenized_input.back().find("r") != std::string::npos)
         {
-            m_bd_is_loaded = true;
-            m_db = std::make_unique<SQLite::Database>(m_db_path,
-                        SQLite::OPEN_READONLY);
+            flags = SQLite::OPEN_READONLY;
         }
         /* Opening as read and write because mode is unspecified */
         else if (tokenized_input.size() < 4)
         {
-            m_bd_is_loaded = true;
-            m_db = std::make_unique<SQLite::Database>(m_db_path,
-                        SQLite::OPEN_READWRITE);
+            flags = SQLite::OPEN_READWRITE;
         }
         else
         {
             throw std::runtime_error("Wasn't able to load the database correctly.");
         }
+        use_db(std::make_unique<SQLite::Database>(path, flags), path);
     }
 
-    void interpreter::create_db(const std::vector<std::string> tokenized_input)
+    void interpreter::use_db(std::unique_ptr<SQLite::Database> db, const std::string& path)
     {
+        /* The new connection is opened first, the current one stays loaded
+           and registered if that fails */
+        release_statements();
+        m_db = std::move(db);
+        m_db_path = path;
         m_bd_is_loaded = true;
-        m_db_path = tokenized_input[1];
+        register_connection(m_db->getHandle());
+        register_functions(*m_db);
+        apply_tuning();
+    }
+
+    void interpreter::load_db_in_memory(const std::string& path)
+    {
+#ifdef XSQL_EMSCRIPTEN_WASM_BUILD
+        throw std::runtime_error("%LOAD <path> memory isn't available in this build.");
+#else
+        /* Serialized, the snapshots are taken from another thread */
+        auto db = std::make_unique<SQLite::Database>(":memory:",
+                      SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLITE_OPEN_FULLMUTEX);
+        db->backup(path.c_str(), SQLite::Database::Load);
+
+        use_db(std::move(db), path);
+        m_snapshotter = std::make_unique<snapshotter>(*m_db, m_db_path);
+#endif
+    }
+
+    void interpreter::set_tuning_profile(const std::string& name)
+    {
+        m_tuning_profile = find_tuning_profile(name).name;
+    }
+
+    void interpreter::apply_tuning()
+    {
+        if (!m_tuning_profile.empty())
+        {
+            display_data(apply_tuning_profile(*m_db, find_tuning_profile(m_tuning_profile)),
+                         nl::json::object(),
+                         nl::json::object());
+        }
+    }
+
+    nl::json interpreter::tune(const std::vector<std::string>& tokenized_input)
+    {
+        if (tokenized_input.size() < 2)
+        {
+            if (!m_bd_is_loaded)
+            {
+                throw std::runtime_error("Usage: %TUNE <profile | off>, the current settings "
+                                         "are shown once a database is loaded.");
+            }
+            return tuning_report(*m_db);
+        }
+
+        nl::json pub_data;
+        if (xv_bindings::case_insentive_equals(tokenized_input[1], "OFF"))
+        {
+            m_tuning_profile.clear();
+            pub_data["text/plain"] = "No profile is applied to the databases loaded next, "
+                                     "the settings of the current one are kept.";
+            return pub_data;
+        }
+
+        set_tuning_profile(tokenized_input[1]);
+        if (m_bd_is_loaded)
+        {
+            return apply_tuning_profile(*m_db, find_tuning_profile(m_tuning_profile));
+        }
+        pub_data["text/plain"] = "Profile " + m_tuning_profile + " is applied to the databases loaded next.";
+        return pub_data;
+    }
+
+    void interpreter::create_db(const std::vector<std::string> tokenized_input)
+    {
+        const std::string& path = tokenized_input[1];
 
         /* Creates the file */
-        std::ofstream(m_db_path.c_str()).close();
+        std::ofstream(path.c_str()).close();
 
         /* Creates the database */
-        m_db = std::make_unique<SQLite::Database>(m_db_path,
-                                                    SQLite::OPEN_READWRITE |
-                                                    SQLite::OPEN_CREATE);
+        use_db(std::make_unique<SQLite::Database>(path,
+                                                  SQLite::OPEN_READWRITE |
+                                                  SQLite::OPEN_CREATE),
+               path);
     }
 
     void interpreter::delete_db()
@@ -175,17 +311,32 @@ namespace xeus_sqlite
         return pub_data;
     }
 
-    void interpreter::backup(std::string backup_type)
+    void interpreter::backup(const std::vector<std::string>& tokenized_input)
     {
-        if (backup_type.size() > 1 && (int)backup_type[0] <= 1)
+        if (tokenized_input.size() < 2 || (tokenized_input[1] != "0" && tokenized_input[1] != "1"))
         {
-            throw std::runtime_error("This is not a valid backup type.");
+            throw std::runtime_error("Usage: %BACKUP <0 | 1> [path], 0 saves to and 1 loads from the file.");
         }
-        else
+        std::string path = tokenized_input.size() > 2 ? tokenized_input[2] : m_db_path;
+        m_db->backup(path.c_str(), tokenized_input[1] == "0" ? SQLite::Database::Save
+                                                             : SQLite::Database::Load);
+        /* Loading may replace the schema */
+        m_statement_cache.clear();
+    }
+
+    nl::json interpreter::snapshot()
+    {
+        if (m_snapshotter == nullptr)
         {
-            m_backup_db->SQLite::Database::backup(m_db_path.c_str(),
-                (SQLite::Database::BackupType)backup_type[0]);
+            throw std::runtime_error("%SNAPSHOT needs a database loaded with %LOAD <path> memory.");
         }
+        snapshot_stats stats = m_snapshotter->flush();
+        nl::json pub_data;
+        pub_data["text/plain"] = std::to_string(stats.pages) + " pages written to "
+                                 + m_snapshotter->path() + " in "
+                                 + std::to_string(stats.elapsed_ms) + " ms, snapshot "
+                                 + std::to_string(stats.snapshots) + " of the session.";
+        return pub_data;
     }
 
     void interpreter::parse_SQLite_magic(int execution_counter,
@@ -194,8 +345,7 @@ namespace xeus_sqlite
     {
         if (xv_bindings::case_insentive_equals(tokenized_input[0], "LOAD"))
         {
-            m_db_path = tokenized_input[1];
-            std::ifstream path_is_valid(m_db_path);
+            std::ifstream path_is_valid(tokenized_input[1]);
             if (!path_is_valid.is_open())
             {
                 throw std::runtime_error("The path doesn't exist.");
@@ -209,6 +359,56 @@ namespace xeus_sqlite
         {
             return create_db(tokenized_input);
         }
+        else if (xv_bindings::case_insentive_equals(tokenized_input[0], "PAGE"))
+        {
+            return set_page_size(tokenized_input);
+        }
+        else if (xv_bindings::case_insentive_equals(tokenized_input[0], "DISPLAY"))
+        {
+            return set_display(tokenized_input);
+        }
+        else if (xv_bindings::case_insentive_equals(tokenized_input[0], "PARAMS"))
+        {
+            return publish_execution_result(execution_counter,
+                                            parameters(tokenized_input),
+                                            nl::json::object());
+        }
+        else if (xv_bindings::case_insentive_equals(tokenized_input[0], "PROGRESS"))
+        {
+            const std::string usage = "Usage: %PROGRESS <on | off>.";
+            if (tokenized_input.size() < 2)
+            {
+                throw std::runtime_error(usage);
+            }
+            m_progress = parse_switch(tokenized_input[1], usage);
+            return;
+        }
+        else if (xv_bindings::case_insentive_equals(tokenized_input[0], "ARROW"))
+        {
+            return set_arrow(tokenized_input);
+        }
+        else if (xv_bindings::case_insentive_equals(tokenized_input[0], "XVEGA_BUDGET"))
+        {
+            return set_xvega_budget(tokenized_input);
+        }
+        else if (xv_bindings::case_insentive_equals(tokenized_input[0], "RESULT_CACHE"))
+        {
+            return set_result_cache(tokenized_input);
+        }
+        else if (xv_bindings::case_insentive_equals(tokenized_input[0], "TRANSACTION"))
+        {
+            return set_cell_transaction(tokenized_input);
+        }
+        else if (xv_bindings::case_insentive_equals(tokenized_input[0], "PROFILE"))
+        {
+            return set_profile(tokenized_input);
+        }
+        else if (xv_bindings::case_insentive_equals(tokenized_input[0], "TUNE"))
+        {
+            return publish_execution_result(execution_counter,
+                                            tune(tokenized_input),
+                                            nl::json::object());
+        }
         #ifdef XSQL_EMSCRIPTEN_WASM_BUILD
         else if (xv_bindings::case_insentive_equals(tokenized_input[0], "FETCH"))
         {   
@@ -264,7 +464,47 @@ namespace xeus_sqlite
             }
             else if (xv_bindings::case_insentive_equals(tokenized_input[0], "BACKUP"))
             {
-                backup(tokenized_input[1]);
+                backup(tokenized_input);
+            }
+            else if (xv_bindings::case_insentive_equals(tokenized_input[0], "SNAPSHOT"))
+            {
+                publish_execution_result(execution_counter,
+                    snapshot(),
+                    nl::json::object());
+            }
+            else if (xv_bindings::case_insentive_equals(tokenized_input[0], "NEXT"))
+            {
+                next_page();
+            }
+            else if (xv_bindings::case_insentive_equals(tokenized_input[0], "IMPORT"))
+            {
+                publish_execution_result(execution_counter,
+                    import_file(tokenized_input),
+                    nl::json::object());
+            }
+            else if (xv_bindings::case_insentive_equals(tokenized_input[0], "EXPORT"))
+            {
+                publish_execution_result(execution_counter,
+                    export_query(tokenized_input),
+                    nl::json::object());
+            }
+            else if (xv_bindings::case_insentive_equals(tokenized_input[0], "EXPLAIN"))
+            {
+                publish_execution_result(execution_counter,
+                    explain(tokenized_input),
+                    nl::json::object());
+            }
+            else if (xv_bindings::case_insentive_equals(tokenized_input[0], "CACHE_STATS"))
+            {
+                publish_execution_result(execution_counter,
+                    cache_stats(),
+                    nl::json::object());
+            }
+            else if (xv_bindings::case_insentive_equals(tokenized_input[0], "BLOB"))
+            {
+                publish_execution_result(execution_counter,
+                    read_blob(tokenized_input),
+                    nl::json::object());
             }
         }
         else
@@ -275,372 +515,1134 @@ namespace xeus_sqlite
 
     void interpreter::configure_impl()
     {
+        /* Pages of the virtual tables, see %DISPLAY */
+        comm_manager().register_comm_target(table_store::comm_target,
+            [this](xeus::xcomm&& comm, const xeus::xmessage& request)
+            {
+                const nl::json& data = request.content()["data"];
+                open_table_comm(std::move(comm), data.value("id", ""));
+            });
     }
 
-    void interpreter::process_SQLite_input(int execution_counter,
-                                        std::unique_ptr<SQLite::Database> &m_db,
-                                        const std::string& code,
-                                        xv::df_type& xv_sqlite_df)
+    void interpreter::open_table_comm(xeus::xcomm&& comm, const std::string& table_id)
     {
-        if (m_db == nullptr)
+        /* Comms can't be dropped by their own close handler */
+        for (const xeus::xguid& id : m_closed_table_comms)
         {
-            throw SQLite::Exception("Please load a database to perform operations");
+            m_table_comms.erase(id);
         }
-        SQLite::Statement query(*m_db, code);
-        nl::json pub_data;
+        m_closed_table_comms.clear();
 
-        /* Builds text/plain output */
-        tabulate::Table plain_table;
-
-        /* Builds text/html output */
-        std::stringstream html_table("");
-
-        /* The error handling on SQLite commands are being taken care of by SQLiteCpp*/
-        if (query.getColumnCount() != 0)
+        xeus::xguid comm_id = comm.id();
+        xeus::xcomm& table_comm = m_table_comms.emplace(comm_id, std::move(comm)).first->second;
+        table_comm.on_message([this, &table_comm, table_id](const xeus::xmessage& message)
         {
-            tabulate::Table::Row_t col_names;
-
-            /* Builds text/html output */
-            html_table << "<table>\n<tr>\n";
-
-            /* Iterates through cols name and build table's title row */
-            for (int col = 0; col < query.getColumnCount(); col++) {
-                std::string name = query.getColumnName(col);
-
-                /* Builds text/plain output */
-                col_names.push_back(name);
-
-                /* Builds text/html output */
-                html_table << "<th>" << name << "</th>\n";
-
-                /* Build application/vnd.vegalite.v3+json output */
-                xv_sqlite_df[name] = { "name" };
-            }
-            /* Builds text/plain output */
-            plain_table.add_row(col_names);
-
-            /* Builds text/html output */
-            html_table << "</tr>\n";
-
-            /* Iterates through cols' rows and builds different kinds of
-               outputs
-            */
-            while (query.executeStep())
+            const nl::json& data = message.content()["data"];
+            if (data.value("format", "") == "arrow")
             {
-                /* Builds text/html output */
-                html_table << "<tr>\n";
-
-                tabulate::Table::Row_t row;
-
-                for (int col = 0; col < query.getColumnCount(); col++) {
-                    std::string col_name;
-                    col_name = query.getColumnName(col);
-                    std::string cell = query.getColumn(col);
-
-                    /* Builds text/plain output */
-                    row.push_back(cell);
-
-                    /* Builds text/html output */
-                    html_table << "<td>" << cell << "</td>\n";
-
-                    /* Build application/vnd.vegalite.v3+json output */
-                    xv_sqlite_df[col_name].push_back(cell);
+                nl::json res;
+                res["id"] = table_id;
+                auto stream = m_tables.stream(table_id);
+                if (stream == nullptr)
+                {
+                    res["error"] = "The result was dropped, run the cell again.";
+                    return table_comm.send(nl::json::object(), std::move(res), xeus::buffer_sequence());
                 }
-                /* Builds text/html output */
-                html_table << "</tr>\n";
-
-                /* Builds text/plain output */
-                plain_table.add_row(row);
+                return table_comm.send(nl::json::object(), std::move(res), *stream);
             }
-            /* Builds text/html output */
-            html_table << "</table>";
-
-            pub_data["text/plain"] = plain_table.str();
-            pub_data["text/html"] = html_table.str();
+            table_comm.send(nl::json::object(),
+                            m_tables.page(table_id,
+                                          data.value("offset", std::size_t(0)),
+                                          data.value("count", std::size_t(100))),
+                            xeus::buffer_sequence());
+        });
+        table_comm.on_close([this, comm_id](const xeus::xmessage&)
+        {
+            m_closed_table_comms.push_back(comm_id);
+        });
+    }
 
-            publish_execution_result(execution_counter,
-                                     std::move(pub_data),
-                                     nl::json::object());
+    void interpreter::release_statements()
+    {
+        /* Writes the last changes of an in memory database. The connection
+           is closed next, which would roll an open transaction back anyway */
+        if (m_snapshotter != nullptr && sqlite3_get_autocommit(m_db->getHandle()) == 0)
+        {
+            m_db->exec("ROLLBACK");
         }
-        else
+        m_snapshotter.reset();
+        close_cursor();
+        m_statement_cache.clear();
+        m_result_cache.clear();
+        m_catalog.clear();
+        m_workers.reset();
+        m_read_pool.reset();
+        if (m_db != nullptr)
         {
-            query.exec();
+            unregister_connection(m_db->getHandle());
         }
     }
 
-   void interpreter::execute_request_impl(send_reply_callback cb,
-                                  int execution_counter,
-                                  const std::string& code,
-                                  xeus::execute_request_config /*config*/,
-                                  nl::json /*user_expressions*/)
+    nl::json interpreter::cache_stats() const
     {
-        std::vector<std::string> traceback;
-        nl::json jresult;
-        std::string sanitized_code = xv_bindings::sanitize_string(code);
-        std::vector<std::string> tokenized_input = xv_bindings::tokenizer(sanitized_code);
+        nl::json pub_data;
+        pub_data["text/plain"] =
+            "Statement cache hits: "      + std::to_string(m_statement_cache.hits())          + "\n" +
+            "Statement cache misses: "    + std::to_string(m_statement_cache.misses())        + "\n" +
+            "Statement cache evictions: " + std::to_string(m_statement_cache.evictions())     + "\n" +
+            "Schema invalidations: "      + std::to_string(m_statement_cache.invalidations()) + "\n" +
+            "Cached statements: "         + std::to_string(m_statement_cache.size()) + "/"
+                                          + std::to_string(m_statement_cache.capacity())      + "\n" +
+            "Result cache hits: "         + std::to_string(m_result_cache.hits())             + "\n" +
+            "Result cache misses: "       + std::to_string(m_result_cache.misses())           + "\n" +
+            "Result cache evictions: "    + std::to_string(m_result_cache.evictions())        + "\n" +
+            "Cached results: "            + std::to_string(m_result_cache.size()) + ", "
+                                          + std::to_string(m_result_cache.bytes()) + "/"
+                                          + std::to_string(m_result_cache.capacity()) + " bytes\n";
+        return pub_data;
+    }
 
-        /* This structure is only used when xvega code is run */
-        //TODO: but it ends up being used in process_SQLite_input, that's why
-        //it's initialized here. Not the best approach, this should be
-        //compartimentilized under xvega domain.
-        xv::df_type xv_sqlite_df;
+    void interpreter::set_result_cache(const std::vector<std::string>& tokenized_input)
+    {
+        if (tokenized_input.size() < 2)
+        {
+            throw std::runtime_error("Usage: %RESULT_CACHE <megabytes | off>.");
+        }
+        std::size_t megabytes = 0;
+        if (!xv_bindings::case_insentive_equals(tokenized_input[1], "OFF"))
+        {
+            megabytes = std::stoul(tokenized_input[1]);
+        }
+        m_result_cache.set_capacity(megabytes << 20);
+    }
 
-        try
+    void interpreter::set_display(const std::vector<std::string>& tokenized_input)
+    {
+        const std::string usage = "Usage: %DISPLAY <rows | off> [columns] [bytes], %DISPLAY VIRTUAL <on | off> "
+                                  "or %DISPLAY MIME <plain | html | all>.";
+        if (tokenized_input.size() < 2)
         {
-            /* Runs magic */
-            if(xv_bindings::is_magic(tokenized_input))
+            throw std::runtime_error(usage);
+        }
+        if (xv_bindings::case_insentive_equals(tokenized_input[1], "VIRTUAL"))
+        {
+            if (tokenized_input.size() < 3)
             {
-                /* Removes "%" symbol */
-                tokenized_input[0].erase(0, 1);
-
-                /* Runs SQLite magic */
-                parse_SQLite_magic(execution_counter, tokenized_input);
-
-                /* Runs xvega magic and SQLite code */
-                if(xv_bindings::is_xvega(tokenized_input))
-                {
-                    /* Removes XVEGA_PLOT command */
-                    tokenized_input.erase(tokenized_input.begin());
-
-                    nl::json chart;
-                    std::vector<std::string> xvega_input, sqlite_input;
-
-                    std::tie(xvega_input, sqlite_input) = 
-                        xv_sqlite::split_xv_sqlite_input(tokenized_input);
-
-                    /* Stringfies SQLite code again */
-                    std::stringstream stringfied_sqlite_input;
-                    for (size_t i = 0; i < sqlite_input.size(); i++) {
-                        stringfied_sqlite_input << " " << sqlite_input[i];
-                    }
-
-                    process_SQLite_input(execution_counter,
-                                         m_db,
-                                         stringfied_sqlite_input.str(),
-                                         xv_sqlite_df);
-
-                    chart = xv_bindings::process_xvega_input(xvega_input,
-                                                           xv_sqlite_df);
-
-                    publish_execution_result(execution_counter,
-                                             std::move(chart),
-                                             nl::json::object());
-                }
+                throw std::runtime_error(usage);
+            }
+            m_virtual_tables = parse_switch(tokenized_input[2], usage);
+        }
+        else if (xv_bindings::case_insentive_equals(tokenized_input[1], "MIME"))
+        {
+            if (tokenized_input.size() < 3)
+            {
+                throw std::runtime_error(usage);
+            }
+            const std::string& mimes = tokenized_input[2];
+            if (xv_bindings::case_insentive_equals(mimes, "PLAIN"))
+            {
+                m_mimes = {true, false};
+            }
+            else if (xv_bindings::case_insentive_equals(mimes, "HTML"))
+            {
+                m_mimes = {false, true};
+            }
+            else if (xv_bindings::case_insentive_equals(mimes, "ALL"))
+            {
+                m_mimes = {true, true};
             }
-            /* Runs SQLite code */
             else
             {
-                process_SQLite_input(execution_counter, m_db, code, xv_sqlite_df);
+                throw std::runtime_error(usage);
             }
-            jresult["status"] = "ok";
-            jresult["payload"] = nl::json::array();
-            jresult["user_expressions"] = nl::json::object();
         }
-        catch (const std::exception& err)
+        else if (xv_bindings::case_insentive_equals(tokenized_input[1], "OFF"))
         {
-            jresult["status"] = "error";
-            jresult["ename"] = "Error";
-            jresult["evalue"] = err.what();
-            traceback.push_back((std::string)jresult["ename"] + ": " + (std::string)err.what());
-            publish_execution_error(jresult["ename"], jresult["evalue"], traceback);
-            traceback.clear();
+            m_display_budget = display_budget();
         }
-        cb(jresult);
+        else
+        {
+            m_display_budget.rows = std::stoul(tokenized_input[1]);
+            if (tokenized_input.size() > 2)
+            {
+                m_display_budget.columns = std::stoul(tokenized_input[2]);
+            }
+            if (tokenized_input.size() > 3)
+            {
+                m_display_budget.bytes = std::stoul(tokenized_input[3]);
+            }
+        }
+        /* The cached bundles were rendered within the previous settings */
+        m_result_cache.clear();
     }
 
-    nl::json interpreter::complete_request_impl(const std::string& raw_code,
-                                                int cursor_pos)
+    nl::json interpreter::result_bundle(result_table&& result)
     {
-        static const std::array<std::string,147> keywords =  
-        {
-            "ABORT",
-            "ACTION",
-            "ADD",
-            "AFTER",
-            "ALL",
-            "ALTER",
-            "ALWAYS",
-            "ANALYZE",
-            "AND",
-            "AS",
-            "ASC",
-            "ATTACH",
-            "AUTOINCREMENT",
-            "BEFORE",
-            "BEGIN",
-            "BETWEEN",
-            "BY",
-            "CASCADE",
-            "CASE",
-            "CAST",
-            "CHECK",
-            "COLLATE",
-            "COLUMN",
-            "COMMIT",
-            "CONFLICT",
-            "CONSTRAINT",
-            "CREATE",
-            "CROSS",
-            "CURRENT",
-            "CURRENT_DATE",
-            "CURRENT_TIME",
-            "CURRENT_TIMESTAMP",
-            "DATABASE",
-            "DEFAULT",
-            "DEFERRABLE",
-            "DEFERRED",
-            "DELETE",
-            "DESC",
-            "DETACH",
-            "DISTINCT",
-            "DO",
-            "DROP",
-            "EACH",
-            "ELSE",
-            "END",
-            "ESCAPE",
-            "EXCEPT",
-            "EXCLUDE",
-            "EXCLUSIVE",
-            "EXISTS",
-            "EXPLAIN",
-            "FAIL",
-            "FILTER",
-            "FIRST",
-            "FOLLOWING",
-            "FOR",
-            "FOREIGN",
-            "FROM",
-            "FULL",
-            "GENERATED",
-            "GLOB",
-            "GROUP",
-            "GROUPS",
-            "HAVING",
-            "IF",
-            "IGNORE",
-            "IMMEDIATE",
-            "IN",
-            "INDEX",
-            "INDEXED",
-            "INITIALLY",
-            "INNER",
-            "INSERT",
-            "INSTEAD",
-            "INTERSECT",
-            "INTO",
-            "IS",
-            "ISNULL",
-            "JOIN",
-            "KEY",
-            "LAST",
-            "LEFT",
-            "LIKE",
-            "LIMIT",
-            "MATCH",
-            "MATERIALIZED",
-            "NATURAL",
-            "NO",
-            "NOT",
-            "NOTHING",
-            "NOTNULL",
-            "NULL",
-            "NULLS",
-            "OF",
-            "OFFSET",
-            "ON",
-            "OR",
-            "ORDER",
-            "OTHERS",
-            "OUTER",
-            "OVER",
-            "PARTITION",
-            "PLAN",
-            "PRAGMA",
-            "PRECEDING",
-            "PRIMARY",
-            "QUERY",
-            "RAISE",
-            "RANGE",
-            "RECURSIVE",
-            "REFERENCES",
-            "REGEXP",
-            "REINDEX",
-            "RELEASE",
-            "RENAME",
-            "REPLACE",
-            "RESTRICT",
-            "RETURNING",
-            "RIGHT",
-            "ROLLBACK",
-            "ROW",
-            "ROWS",
-            "SAVEPOINT",
-            "SELECT",
-            "SET",
-            "TABLE",
-            "TEMP",
-            "TEMPORARY",
-            "THEN",
-            "TIES",
-            "TO",
-            "TRANSACTION",
-            "TRIGGER",
-            "UNBOUNDED",
-            "UNION",
-            "UNIQUE",
-            "UPDATE",
-            "USING",
-            "VACUUM",
-            "VALUES",
-            "VIEW",
-            "VIRTUAL",
-            "WHEN",
-            "WHERE",
-            "WINDOW",
-            "WITH",
-            "WITHOUT",
-        };
-
-        nl::json result;
-
-
-        nl::json matches = nl::json::array();
-
-        // first we get  a substring from string[0:curser_pos+1]std
-        // and discard the right side of the curser pos
-        const auto code = raw_code.substr(0, cursor_pos);
+        if (!m_virtual_tables || !result.exceeds(m_display_budget))
+        {
+            return result.mime_bundle(m_display_budget, m_mimes);
+        }
+        auto table = std::make_shared<const result_table>(std::move(result));
+        nl::json pub_data = table->mime_bundle(m_display_budget, m_mimes);
+        std::size_t page_rows = m_display_budget.rows == 0 ? 100 : m_display_budget.rows;
+        pub_data[table_store::mime_type] = m_tables.add(std::move(table), page_rows);
+        return pub_data;
+    }
 
+    void interpreter::run_with_progress(SQLite::Statement& query,
+                                        const result_table* result,
+                                        const std::function<void()>& run)
+    {
+        if (!m_progress)
+        {
+            return run();
+        }
 
-        // keyword matches
-        // ............................
+        std::string display_id;
+        auto publish = [this, &display_id](const query_progress& progress)
         {
-            auto pos = -1;
-            for(int i=code.size()-1; i>=0; --i)
-            {   
-                if(!is_identifier(code[i]))
-                {
-                    pos = i;
-                    break;
-                }
+            nl::json transient;
+            if (display_id.empty())
+            {
+                display_id = xeus::new_xguid();
+                transient["display_id"] = display_id;
+                display_data(progress.mime_bundle(), nl::json::object(), std::move(transient));
+            }
+            else
+            {
+                transient["display_id"] = display_id;
+                update_display_data(progress.mime_bundle(), nl::json::object(), std::move(transient));
             }
-            result["cursor_start"] =  pos == -1 ? 0 : pos +1;
-            auto to_match = pos == -1 ? code : code.substr(pos+1, code.size() -(pos+1));
+        };
 
-            // check for kw matches
-            for(auto kw : keywords)
+        progress_reporter reporter(*m_db, query.getPreparedStatement(),
+                                   result, publish);
+        try
+        {
+            run();
+        }
+        catch (...)
+        {
+            if (!display_id.empty())
             {
-                if(startswith(kw, to_match))
-                {
-                    matches.push_back(kw);
-                }
+                query_progress stopped = reporter.snapshot();
+                stopped.stopped = true;
+                publish(stopped);
             }
+            throw;
         }
+        /* Statements too short to be reported display nothing */
+        if (!display_id.empty())
+        {
+            query_progress done = reporter.snapshot();
+            done.done = true;
+            publish(done);
+        }
+    }
+
+    void interpreter::set_arrow(const std::vector<std::string>& tokenized_input)
+    {
+        if (tokenized_input.size() < 2)
+        {
+            throw std::runtime_error("Usage: %ARROW <on [rows per batch] | off>.");
+        }
+        m_arrow_batch_rows = 0;
+        if (xv_bindings::case_insentive_equals(tokenized_input[1], "ON"))
+        {
+            m_arrow_batch_rows = tokenized_input.size() > 2 ? std::stoul(tokenized_input[2]) : 65536;
+        }
+    }
+
+    std::shared_ptr<SQLite::Statement> interpreter::prepare_statement(const std::string& code)
+    {
+        if (m_db == nullptr)
+        {
+            throw SQLite::Exception("Please load a database to perform operations");
+        }
+        std::shared_ptr<SQLite::Statement> query = m_statement_cache.acquire(*m_db, code);
+        /* The values are bound, the SQL text and its plan stay the same */
+        if (query->getBindParameterCount() != 0)
+        {
+            m_parameters.bind(*query);
+        }
+        return query;
+    }
+
+    void interpreter::set_parameter(const std::string& code)
+    {
+        /* Drops %SET, the value is sliced from code to keep its whitespace */
+        std::size_t name_first = code.find_first_not_of(" \t\r\n", code.find('%') + std::strlen("%SET"));
+        std::size_t name_last = code.find_first_of(" \t\r\n", name_first);
+        std::size_t value_first = code.find_first_not_of(" \t\r\n", name_last);
+        if (name_first == std::string::npos || value_first == std::string::npos)
+        {
+            throw std::runtime_error("Usage: %SET <name> <value>.");
+        }
+        std::string literal = code.substr(value_first, code.find_last_not_of(" \t\r\n") + 1 - value_first);
+        /* :name, $name and @name all read name */
+        std::string name = code.substr(name_first, name_last - name_first);
+        if (name.size() > 1 && (name[0] == ':' || name[0] == '$' || name[0] == '@' || name[0] == '?'))
+        {
+            name.erase(0, 1);
+        }
+        m_parameters.set(name, parameter_value::parse(literal));
+    }
+
+    nl::json interpreter::parameters(const std::vector<std::string>& tokenized_input)
+    {
+        if (tokenized_input.size() > 1)
+        {
+            if (xv_bindings::case_insentive_equals(tokenized_input[1], "CLEAR"))
+            {
+                m_parameters.clear();
+            }
+            else if (xv_bindings::case_insentive_equals(tokenized_input[1], "UNSET")
+                     && tokenized_input.size() > 2)
+            {
+                for (std::size_t i = 2; i < tokenized_input.size(); ++i)
+                {
+                    if (!m_parameters.erase(tokenized_input[i]))
+                    {
+                        throw std::runtime_error("No parameter named " + tokenized_input[i] + ".");
+                    }
+                }
+            }
+            else
+            {
+                throw std::runtime_error("Usage: %PARAMS [clear | unset <names>].");
+            }
+        }
+        return m_parameters.mime_bundle();
+    }
+
+    nl::json interpreter::evaluate_user_expressions(const nl::json& user_expressions)
+    {
+        nl::json res = nl::json::object();
+        for (const auto& item : user_expressions.items())
+        {
+            nl::json& reply = res[item.key()];
+            try
+            {
+                if (!item.value().is_string())
+                {
+                    throw std::runtime_error("User expressions must be strings.");
+                }
+                /* Not cached, user expressions are sent with every request */
+                if (m_db == nullptr)
+                {
+                    throw SQLite::Exception("Please load a database to perform operations");
+                }
+                SQLite::Statement query(*m_db, "SELECT " + item.value().get<std::string>());
+                if (query.getBindParameterCount() != 0)
+                {
+                    m_parameters.bind(query);
+                }
+                result_table result;
+                result.fill(query);
+                reply["status"] = "ok";
+                reply["data"] = result_bundle(std::move(result));
+                reply["metadata"] = nl::json::object();
+            }
+            catch (const std::exception& err)
+            {
+                reply["status"] = "error";
+                reply["ename"] = is_interrupt(err) ? "KeyboardInterrupt" : "Error";
+                reply["evalue"] = err.what();
+                reply["traceback"] = nl::json::array({std::string(reply["ename"]) + ": " + err.what()});
+            }
+        }
+        return res;
+    }
+
+    void interpreter::set_page_size(const std::vector<std::string>& tokenized_input)
+    {
+        if (tokenized_input.size() < 2)
+        {
+            throw std::runtime_error("Usage: %PAGE <rows per page | off>.");
+        }
+        if (xv_bindings::case_insentive_equals(tokenized_input[1], "OFF"))
+        {
+            m_page_size = 0;
+        }
+        else
+        {
+            m_page_size = std::stoul(tokenized_input[1]);
+        }
+        if (m_page_size == 0)
+        {
+            close_cursor();
+        }
+    }
+
+    void interpreter::open_cursor(std::shared_ptr<SQLite::Statement> query)
+    {
+        close_cursor();
+        m_cursor.query = std::move(query);
+        m_cursor.display_id = xeus::new_xguid();
+
+        nl::json transient;
+        transient["display_id"] = m_cursor.display_id;
+        display_data(fetch_page(), nl::json::object(), std::move(transient));
+    }
+
+    void interpreter::next_page()
+    {
+        if (m_cursor.query == nullptr)
+        {
+            throw std::runtime_error("There is no paged result left to fetch.");
+        }
+
+        nl::json transient;
+        transient["display_id"] = m_cursor.display_id;
+        update_display_data(fetch_page(), nl::json::object(), std::move(transient));
+    }
+
+    void interpreter::close_cursor()
+    {
+        /* The statement cache still holds the statement, it is reset to end
+           its read transaction */
+        if (m_cursor.query != nullptr)
+        {
+            m_cursor.query->tryReset();
+        }
+        m_cursor.query.reset();
+        m_cursor.rows_read = 0;
+    }
+
+    nl::json interpreter::fetch_page()
+    {
+        result_table page;
+        std::size_t first_row = m_cursor.rows_read + 1;
+        std::size_t rows = page.fill(*m_cursor.query, m_page_size);
+        m_cursor.rows_read += rows;
+
+        std::string footer;
+        if (rows < m_page_size)
+        {
+            /* Releases the statement and its read transaction */
+            m_cursor.query->tryReset();
+            m_cursor.query.reset();
+            footer = rows == 0 ? "No more rows."
+                               : "Rows " + std::to_string(first_row) + " to "
+                                 + std::to_string(m_cursor.rows_read) + ", end of the result.";
+        }
+        else
+        {
+            footer = "Rows " + std::to_string(first_row) + " to "
+                     + std::to_string(m_cursor.rows_read) + ", run %NEXT to fetch the next page.";
+        }
+
+        nl::json pub_data = page.mime_bundle(m_display_budget, m_mimes);
+        if (m_mimes.plain)
+        {
+            pub_data["text/plain"] = pub_data["text/plain"].get<std::string>() + "\n" + footer;
+        }
+        if (m_mimes.html)
+        {
+            pub_data["text/html"] = pub_data["text/html"].get<std::string>() + "\n<p>" + footer + "</p>";
+        }
+        return pub_data;
+    }
+
+    void interpreter::plot_SQLite_input(int execution_counter,
+                                        const std::vector<std::string>& xvega_input,
+                                        const std::string& code)
+    {
+        std::shared_ptr<SQLite::Statement> query = prepare_statement(code);
+
+        /* The error handling on SQLite commands are being taken care of by SQLiteCpp*/
+        xv_sqlite::chart_encoding encoding = xv_sqlite::parse_encoding(xvega_input);
+        xv_sqlite::chart_reduction reduction;
+        nl::json values = nl::json::array();
+        if (query->getColumnCount() == 0)
+        {
+            query->exec();
+        }
+        else
+        {
+            reduction = xv_sqlite::plan_reduction(*m_db, encoding, code, m_xvega_budget);
+            if (reduction.query != code)
+            {
+                query = prepare_statement(reduction.query);
+            }
+            values = xv_sqlite::chart_values(*query, reduction, m_xvega_budget);
+        }
+
+        /* Only the column names are read by the bindings */
+        xv::df_type xv_sqlite_df;
+        for (int col = 0; col < query->getColumnCount(); ++col)
+        {
+            xv_sqlite_df[query->getColumnName(col)];
+        }
+        nl::json chart = xv_bindings::process_xvega_input(xvega_input, xv_sqlite_df);
+
+        nl::json metadata;
+        metadata["xvega_reduction"] = xv_sqlite::reduction_name(reduction.kind);
+        metadata["xvega_points"] = values.size();
+
+        /* Numeric columns are plotted on quantitative axes */
+        xv_sqlite::set_chart_values(chart, std::move(values));
+        xv_sqlite::rewrite_encoding(chart, encoding, reduction);
+
+        publish_execution_result(execution_counter,
+                                 std::move(chart),
+                                 std::move(metadata));
+    }
+
+    void interpreter::set_xvega_budget(const std::vector<std::string>& tokenized_input)
+    {
+        if (tokenized_input.size() < 2)
+        {
+            throw std::runtime_error("Usage: %XVEGA_BUDGET <points | off>.");
+        }
+        m_xvega_budget = xv_bindings::case_insentive_equals(tokenized_input[1], "OFF")
+                         ? 0 : std::stoul(tokenized_input[1]);
+    }
+
+    void interpreter::set_cell_transaction(const std::vector<std::string>& tokenized_input)
+    {
+        const std::string usage = "Usage: %TRANSACTION <on | off>.";
+        if (tokenized_input.size() < 2)
+        {
+            throw std::runtime_error(usage);
+        }
+        m_cell_transaction = parse_switch(tokenized_input[1], usage);
+    }
+
+    nl::json interpreter::import_file(const std::vector<std::string>& tokenized_input)
+    {
+        if (tokenized_input.size() < 3)
+        {
+            throw std::runtime_error("Usage: %IMPORT <file> <table> [csv | tsv | jsonl] [fast].");
+        }
+
+        import_options options;
+        options.format = import_format_from(tokenized_input[1]);
+        for (std::size_t i = 3; i < tokenized_input.size(); ++i)
+        {
+            if (xv_bindings::case_insentive_equals(tokenized_input[i], "FAST"))
+            {
+                options.relax_durability = true;
+            }
+            else
+            {
+                options.format = import_format_from(tokenized_input[i]);
+            }
+        }
+
+        /* A cursor left open would hold a read transaction on the table */
+        close_cursor();
+        auto progress = [this](std::size_t rows, std::size_t bytes_read, std::size_t total)
+        {
+            std::size_t percent = total == 0 ? 100 : bytes_read * 100 / total;
+            publish_stream("stdout", std::to_string(rows) + " rows imported ("
+                                     + std::to_string(percent) + "%)\n");
+        };
+        import_summary summary = xeus_sqlite::import_file(*m_db, tokenized_input[1],
+                                                          tokenized_input[2], options, progress);
+
+        double rate = summary.seconds > 0. ? summary.rows / summary.seconds : 0.;
+        std::string columns;
+        for (std::size_t i = 0; i < summary.columns.size(); ++i)
+        {
+            columns += (i == 0 ? "" : ", ") + summary.columns[i] + " " + summary.types[i];
+        }
+
+        nl::json pub_data;
+        pub_data["text/plain"] =
+            "Imported " + std::to_string(summary.rows) + " rows into " + tokenized_input[2]
+            + " in " + std::to_string(summary.seconds) + " s ("
+            + std::to_string(static_cast<std::size_t>(rate)) + " rows/s)\n"
+            + (summary.created_table ? "Created table with columns: " : "Columns: ") + columns + "\n";
+        return pub_data;
+    }
+
+    nl::json interpreter::export_query(const std::vector<std::string>& tokenized_input)
+    {
+        std::vector<std::string> export_input, sqlite_input;
+        std::tie(export_input, sqlite_input) =
+            xv_sqlite::split_xv_sqlite_input(tokenized_input);
+        if (export_input.size() < 3 || export_input.size() > 4 || sqlite_input.empty())
+        {
+            throw std::runtime_error("Usage: %EXPORT <arrow | csv> <path> [rows per batch] <> SELECT ...");
+        }
+
+        export_format format = export_format_from(export_input[1]);
+        std::size_t batch_rows = export_input.size() == 4 ? std::stoul(export_input[3]) : 65536;
+        if (batch_rows == 0)
+        {
+            throw std::runtime_error("The number of rows per batch must be positive.");
+        }
+
+        std::string code;
+        for (const std::string& token : sqlite_input)
+        {
+            code += " " + token;
+        }
+        std::shared_ptr<SQLite::Statement> query = prepare_statement(code);
+        if (query->getColumnCount() == 0)
+        {
+            throw std::runtime_error("%EXPORT needs a query returning rows.");
+        }
+
+        export_summary summary;
+        try
+        {
+            summary = xeus_sqlite::export_query(*query, export_input[2], format, batch_rows);
+        }
+        catch (...)
+        {
+            query->tryReset();
+            throw;
+        }
+        query->tryReset();
+
+        nl::json pub_data;
+        pub_data["text/plain"] =
+            "Exported " + std::to_string(summary.rows) + " rows in "
+            + std::to_string(summary.batches) + " batches to " + export_input[2]
+            + " (" + std::to_string(summary.bytes) + " bytes) in "
+            + std::to_string(summary.seconds) + " s\n"
+            + (summary.coerced == 0 ? ""
+               : std::to_string(summary.coerced) + " values didn't match the type of their column "
+                 "and were converted or written as null\n");
+        return pub_data;
+    }
+
+    nl::json interpreter::read_blob(const std::vector<std::string>& tokenized_input)
+    {
+        if (tokenized_input.size() < 4 || tokenized_input.size() > 5)
+        {
+            throw std::runtime_error("Usage: %BLOB <table> <column> <rowid> [file]");
+        }
+
+        blob_reader blob(*m_db, tokenized_input[1], tokenized_input[2],
+                         std::stoll(tokenized_input[3]));
+        if (tokenized_input.size() == 4)
+        {
+            return blob.mime_bundle();
+        }
+
+        std::size_t bytes = blob.write_to(tokenized_input[4]);
+        nl::json pub_data;
+        pub_data["text/plain"] = "Wrote " + std::to_string(bytes) + " bytes to " + tokenized_input[4];
+        return pub_data;
+    }
+
+    void interpreter::set_profile(const std::vector<std::string>& tokenized_input)
+    {
+        const std::string usage = "Usage: %PROFILE <on | off>.";
+        if (tokenized_input.size() < 2)
+        {
+            throw std::runtime_error(usage);
+        }
+        m_profile = parse_switch(tokenized_input[1], usage);
+    }
+
+    nl::json interpreter::explain(const std::vector<std::string>& tokenized_input)
+    {
+        bool bytecode = tokenized_input.size() > 1
+                        && xv_bindings::case_insentive_equals(tokenized_input[1], "BYTECODE");
+        std::string code;
+        for (std::size_t i = bytecode ? 2 : 1; i < tokenized_input.size(); ++i)
+        {
+            code += " " + tokenized_input[i];
+        }
+        if (code.empty())
+        {
+            throw std::runtime_error("Usage: %EXPLAIN [bytecode] <query>.");
+        }
+        return bytecode ? explain_bytecode(*m_db, code) : explain_query_plan(*m_db, code);
+    }
+
+    void interpreter::process_SQLite_batch(int execution_counter,
+                                           const std::string& code)
+    {
+        if (m_db == nullptr)
+        {
+            throw SQLite::Exception("Please load a database to perform operations");
+        }
+
+        struct statement_report
+        {
+            std::string sql;
+            int changes;
+            double elapsed_ms;
+        };
+        std::vector<statement_report> reports;
+
+        result_table result;
+        bool has_result = false;
 
+        sqlite3* handle = m_db->getHandle();
+        bool transaction = m_cell_transaction && sqlite3_get_autocommit(handle) != 0;
+        if (transaction)
+        {
+            m_db->exec("BEGIN");
+        }
+
+        const char* tail = code.c_str();
+        const char* end = tail + code.size();
+        try
+        {
+            while (tail < end)
+            {
+                auto start = std::chrono::steady_clock::now();
+                int total_changes = sqlite3_total_changes(handle);
+
+                sqlite3_stmt* statement = nullptr;
+                const char* next = nullptr;
+                int rc = sqlite3_prepare_v2(handle, tail, static_cast<int>(end - tail),
+                                            &statement, &next);
+                if (rc != SQLITE_OK)
+                {
+                    throw SQLite::Exception(handle, rc);
+                }
+                /* Only whitespace or comments were left */
+                if (statement == nullptr)
+                {
+                    break;
+                }
+
+                std::string sql(tail, next);
+                tail = next;
+
+                if (sqlite3_column_count(statement) != 0)
+                {
+                    /* Statements returning rows go through the statement
+                       cache and the result table */
+                    sqlite3_finalize(statement);
+                    std::shared_ptr<SQLite::Statement> query = prepare_statement(sql);
+                    result.fill(*query);
+                    has_result = true;
+                }
+                else
+                {
+                    try
+                    {
+                        m_parameters.bind(statement);
+                    }
+                    catch (...)
+                    {
+                        sqlite3_finalize(statement);
+                        throw;
+                    }
+                    while ((rc = sqlite3_step(statement)) == SQLITE_ROW)
+                    {
+                    }
+                    sqlite3_finalize(statement);
+                    if (rc != SQLITE_DONE)
+                    {
+                        throw SQLite::Exception(handle, rc);
+                    }
+                }
+
+                std::chrono::duration<double, std::milli> elapsed =
+                    std::chrono::steady_clock::now() - start;
+                reports.push_back({statement_cache::normalize(sql),
+                                   sqlite3_total_changes(handle) - total_changes,
+                                   elapsed.count()});
+            }
+            if (transaction)
+            {
+                m_db->exec("COMMIT");
+            }
+        }
+        catch (const std::exception& err)
+        {
+            std::string message = "Statement " + std::to_string(reports.size() + 1)
+                                  + " of the cell failed: " + err.what();
+            if (transaction)
+            {
+                m_db->tryExec("ROLLBACK");
+                message += ". The whole cell was rolled back.";
+            }
+            if (is_interrupt(err))
+            {
+                throw SQLite::Exception(message, SQLITE_INTERRUPT);
+            }
+            throw std::runtime_error(message);
+        }
+
+        /* Reports at most the first and last statements of large cells */
+        const std::size_t max_reported = 50;
+        int total_changes = 0;
+        double total_ms = 0.;
+        std::string plain = "#\tRows affected\tTime (ms)\tStatement\n";
+        std::string html = "<table>\n<tr>\n<th>#</th>\n<th>Rows affected</th>\n"
+                           "<th>Time (ms)</th>\n<th>Statement</th>\n</tr>\n";
+        for (std::size_t i = 0; i < reports.size(); ++i)
+        {
+            const statement_report& report = reports[i];
+            total_changes += report.changes;
+            total_ms += report.elapsed_ms;
+
+            if (reports.size() > max_reported && i == max_reported / 2)
+            {
+                std::string skipped = std::to_string(reports.size() - max_reported)
+                                      + " statements omitted";
+                plain += "...\t" + skipped + "\n";
+                html += "<tr>\n<td colspan=\"4\">" + skipped + "</td>\n</tr>\n";
+            }
+            if (reports.size() > max_reported && i >= max_reported / 2
+                && i < reports.size() - max_reported / 2)
+            {
+                continue;
+            }
+
+            std::string sql = report.sql.size() > 80 ? report.sql.substr(0, 77) + "..." : report.sql;
+            std::string index = std::to_string(i + 1);
+            std::string changes = std::to_string(report.changes);
+            std::string elapsed = std::to_string(report.elapsed_ms);
+            plain += index + "\t" + changes + "\t" + elapsed + "\t" + sql + "\n";
+            html += "<tr>\n<td>" + index + "</td>\n<td>" + changes + "</td>\n<td>"
+                    + elapsed + "</td>\n<td>";
+            append_escaped(sql, html);
+            html += "</td>\n</tr>\n";
+        }
+        std::string summary = std::to_string(reports.size()) + " statements, "
+                              + std::to_string(total_changes) + " rows affected in "
+                              + std::to_string(total_ms) + " ms"
+                              + (transaction ? " (single transaction)." : ".");
+        plain += summary;
+        html += "</table>\n<p>" + summary + "</p>";
+
+        nl::json report_data;
+        report_data["text/plain"] = std::move(plain);
+        report_data["text/html"] = std::move(html);
+        display_data(std::move(report_data), nl::json::object(), nl::json::object());
+
+        if (has_result)
+        {
+            publish_execution_result(execution_counter,
+                                     result_bundle(std::move(result)),
+                                     nl::json::object());
+        }
+    }
+
+    void interpreter::process_SQLite_parallel(int execution_counter,
+                                              const std::string& code)
+    {
+        /* Drops %PARALLEL and the number of threads, if given */
+        std::size_t position = code.find_first_not_of(" \t", code.find('%') + std::strlen("%PARALLEL"));
+        std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+        if (position != std::string::npos && std::isdigit(static_cast<unsigned char>(code[position])))
+        {
+            std::size_t end = code.find_first_not_of("0123456789", position);
+            threads = std::stoul(code.substr(position, end - position));
+            position = end;
+        }
+        if (threads == 0)
+        {
+            throw std::runtime_error("The number of threads must be positive.");
+        }
+        /* Every connection of the pool takes a slot of the interrupt
+           registry, the slots of the current pool are given back first */
+        std::size_t free_slots = free_connection_slots() + (m_read_pool != nullptr ? m_read_pool->size() : 0);
+        if (free_slots == 0)
+        {
+            throw std::runtime_error("Too many connections are open at once for %PARALLEL.");
+        }
+        threads = std::min(threads, free_slots);
+        std::string sql = position == std::string::npos ? "" : code.substr(position);
+
+        sqlite3* handle = m_db->getHandle();
+        bool read_only = sqlite3_db_readonly(handle, "main") == 1;
+        if (!is_file_database(*m_db)
+            || !(read_only || m_db->execAndGet("PRAGMA journal_mode").getString() == "wal"))
+        {
+            throw std::runtime_error("%PARALLEL needs a database file loaded read only or in WAL mode, "
+                                     "see PRAGMA journal_mode = WAL.");
+        }
+
+        if (m_read_pool == nullptr || m_read_pool->size() != threads)
+        {
+            m_workers.reset();
+            m_read_pool.reset();
+            m_read_pool = std::make_unique<connection_pool>(m_db_path, threads);
+            for (std::size_t i = 0; i < threads; ++i)
+            {
+                register_functions(m_read_pool->at(i));
+            }
+            m_workers = std::make_unique<work_stealing_pool>(threads);
+        }
+
+        std::vector<std::string> statements = split_read_statements(m_read_pool->at(0), sql);
+        if (statements.empty())
+        {
+            throw std::runtime_error("Usage: %PARALLEL [threads] followed by SELECT statements.");
+        }
+
+        /* The last result is the one of the cell */
+        parallel_summary summary = parallel_query(*m_read_pool, *m_workers, statements,
+            [this, execution_counter, &statements](std::size_t index, result_table& result)
+            {
+                if (index + 1 == statements.size())
+                {
+                    publish_execution_result(execution_counter,
+                                             result_bundle(std::move(result)),
+                                             nl::json::object());
+                }
+                else
+                {
+                    display_data(result_bundle(std::move(result)), nl::json::object(), nl::json::object());
+                }
+            });
+
+        std::string report = std::to_string(summary.statements) + " statements on "
+                             + std::to_string(threads) + (threads == 1 ? " thread in " : " threads in ")
+                             + std::to_string(summary.elapsed_ms) + " ms, "
+                             + std::to_string(summary.query_ms) + " ms of query time.";
+        nl::json report_data;
+        report_data["text/plain"] = report;
+        report_data["text/html"] = "<p>" + report + "</p>";
+        display_data(std::move(report_data), nl::json::object(), nl::json::object());
+    }
+
+    void interpreter::process_SQLite_input(int execution_counter,
+                                           const std::string& code,
+                                           bool use_cache)
+    {
+        if (m_profile)
+        {
+            return profile_SQLite_input(execution_counter, code);
+        }
+
+        std::shared_ptr<SQLite::Statement> query = prepare_statement(code);
+
+        if (query->getColumnCount() == 0)
+        {
+            run_with_progress(*query, nullptr, [&query]() { query->exec(); });
+        }
+        /* Streams the rows one page at a time */
+        else if (m_page_size != 0)
+        {
+            open_cursor(std::move(query));
+        }
+        else
+        {
+            /* Reads of an open transaction may be rolled back, they aren't
+               cached */
+            sqlite3* handle = m_db->getHandle();
+            bool cached = use_cache && m_result_cache.enabled()
+                          && sqlite3_get_autocommit(handle) != 0
+                          && result_cache::is_cacheable(query->getPreparedStatement());
+            database_version version;
+            /* Results of the same statement differ by the values bound */
+            std::string cache_key = cached && query->getBindParameterCount() != 0
+                                    ? query->getExpandedSQL()
+                                    : query->getQuery();
+            if (cached)
+            {
+                version = database_version::read(*m_db);
+                if (const nl::json* pub_data = m_result_cache.find(cache_key, version))
+                {
+                    nl::json metadata;
+                    metadata["cached"] = true;
+                    return publish_execution_result(execution_counter, *pub_data, std::move(metadata));
+                }
+            }
+
+            /* The Arrow stream is read in the same pass as the result */
+            result_table result;
+            nl::json arrow_entry;
+            run_with_progress(*query, &result, [&]()
+            {
+                if (m_arrow_batch_rows != 0)
+                {
+                    auto messages = std::make_shared<table_store::stream_type>();
+                    export_summary summary = stream_query(*query, result, *messages, m_arrow_batch_rows);
+                    arrow_entry = m_tables.add_stream(std::move(messages), summary.rows);
+                }
+                else
+                {
+                    result.fill(*query);
+                }
+            });
+            nl::json pub_data = result_bundle(std::move(result));
+            if (!arrow_entry.is_null())
+            {
+                pub_data[table_store::arrow_mime_type] = std::move(arrow_entry);
+            }
+            /* The virtual table or the stream may be dropped before the
+               result is reused */
+            if (cached && !pub_data.contains(table_store::mime_type)
+                && !pub_data.contains(table_store::arrow_mime_type))
+            {
+                m_result_cache.insert(cache_key, version, pub_data);
+            }
+            publish_execution_result(execution_counter,
+                                     std::move(pub_data),
+                                     nl::json::object());
+        }
+    }
+
+    void interpreter::profile_SQLite_input(int execution_counter,
+                                           const std::string& code)
+    {
+        using clock = std::chrono::steady_clock;
+        using milliseconds = std::chrono::duration<double, std::milli>;
+        statement_profile profile;
+
+        auto start = clock::now();
+        std::size_t misses = m_statement_cache.misses();
+        std::shared_ptr<SQLite::Statement> query = prepare_statement(code);
+        profile.prepare_ms = milliseconds(clock::now() - start).count();
+        profile.cached = m_statement_cache.misses() == misses;
+
+        sqlite3_stmt* statement = query->getPreparedStatement();
+        reset_statement_counters(statement);
+
+        result_table result;
+        start = clock::now();
+        bool has_rows = query->getColumnCount() != 0;
+        if (has_rows)
+        {
+            profile.rows = result.fill(*query);
+        }
+        else
+        {
+            profile.rows = static_cast<std::size_t>(query->exec());
+        }
+        profile.step_ms = milliseconds(clock::now() - start).count();
+        profile.read_counters(statement);
+
+        nl::json metadata;
+        if (has_rows)
+        {
+            start = clock::now();
+            nl::json pub_data = result_bundle(std::move(result));
+            profile.render_ms = milliseconds(clock::now() - start).count();
+            for (const auto& item : pub_data.items())
+            {
+                profile.bytes_published += item.value().is_string()
+                                           ? item.value().get_ref<const std::string&>().size()
+                                           : item.value().dump().size();
+            }
+            metadata["profile"] = profile.to_json();
+            publish_execution_result(execution_counter, std::move(pub_data), metadata);
+        }
+        else
+        {
+            metadata["profile"] = profile.to_json();
+        }
+        display_data(profile.mime_bundle(), std::move(metadata), nl::json::object());
+    }
+
+   void interpreter::execute_request_impl(send_reply_callback cb,
+                                  int execution_counter,
+                                  const std::string& code,
+                                  xeus::execute_request_config /*config*/,
+                                  nl::json user_expressions)
+    {
+        std::vector<std::string> traceback;
+        nl::json jresult;
+        std::string sanitized_code = xv_bindings::sanitize_string(code);
+        std::vector<std::string> tokenized_input = xv_bindings::tokenizer(sanitized_code);
+
+        try
+        {
+            /* Runs magic */
+            if(xv_bindings::is_magic(tokenized_input))
+            {
+                /* Removes "%" symbol */
+                tokenized_input[0].erase(0, 1);
+
+                /* Runs SQLite magic */
+                parse_SQLite_magic(execution_counter, tokenized_input);
+
+                /* Runs xvega magic and SQLite code */
+                if(xv_bindings::is_xvega(tokenized_input))
+                {
+                    /* Removes XVEGA_PLOT command */
+                    tokenized_input.erase(tokenized_input.begin());
+
+                    std::vector<std::string> xvega_input, sqlite_input;
+
+                    std::tie(xvega_input, sqlite_input) = 
+                        xv_sqlite::split_xv_sqlite_input(tokenized_input);
+
+                    /* Stringfies SQLite code again */
+                    std::stringstream stringfied_sqlite_input;
+                    for (size_t i = 0; i < sqlite_input.size(); i++) {
+                        stringfied_sqlite_input << " " << sqlite_input[i];
+                    }
+
+                    plot_SQLite_input(execution_counter,
+                                      xvega_input,
+                                      stringfied_sqlite_input.str());
+                }
+                /* Read from code, the sanitized input joins its lines */
+                else if (is_magic_cell(code, code.find_first_not_of(" \t\r\n"), "PARALLEL"))
+                {
+                    process_SQLite_parallel(execution_counter, code);
+                }
+                else if (is_magic_cell(code, code.find_first_not_of(" \t\r\n"), "SET"))
+                {
+                    set_parameter(code);
+                }
+                else if (is_magic_cell(code, code.find_first_not_of(" \t\r\n"), "NOCACHE"))
+                {
+                    std::string sql = code.substr(code.find('%') + std::strlen("%NOCACHE"));
+                    if (has_several_statements(sql))
+                    {
+                        process_SQLite_batch(execution_counter, sql);
+                    }
+                    else
+                    {
+                        process_SQLite_input(execution_counter, sql, false);
+                    }
+                }
+            }
+            /* Runs every statement of the cell */
+            else if (has_several_statements(code))
+            {
+                process_SQLite_batch(execution_counter, code);
+            }
+            /* Runs SQLite code */
+            else
+            {
+                process_SQLite_input(execution_counter, code);
+            }
+            jresult["status"] = "ok";
+            jresult["payload"] = nl::json::array();
+            jresult["user_expressions"] = evaluate_user_expressions(user_expressions);
+        }
+        catch (const std::exception& err)
+        {
+            jresult["status"] = "error";
+            jresult["ename"] = is_interrupt(err) ? "KeyboardInterrupt" : "Error";
+            jresult["evalue"] = err.what();
+            traceback.push_back((std::string)jresult["ename"] + ": " + (std::string)err.what());
+            publish_execution_error(jresult["ename"], jresult["evalue"], traceback);
+            traceback.clear();
+        }
+        cb(jresult);
+    }
+
+    nl::json interpreter::complete_request_impl(const std::string& raw_code,
+                                                int cursor_pos)
+    {
+        /* Tables and columns are only known once a database is loaded */
+        if (m_bd_is_loaded)
+        {
+            try
+            {
+                m_catalog.refresh(*m_db);
+            }
+            catch (const SQLite::Exception&)
+            {
+                /* e.g. the database is locked, the previous catalog is used */
+            }
+        }
+        catalog::completion completion = m_catalog.complete(raw_code,
+                                                                 static_cast<std::size_t>(std::max(cursor_pos, 0)));
+
+        nl::json result;
         result["status"] = "ok";
+        result["cursor_start"] = completion.cursor_start;
         result["cursor_end"] = cursor_pos;
-        result["matches"] =matches;
-
+        result["matches"] = completion.matches;
         return result;
     };
 
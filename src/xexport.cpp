@@ -0,0 +1,787 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "xeus-sqlite/xexport.hpp"
+
+namespace xeus_sqlite
+{
+    namespace
+    {
+        /* Minimal flatbuffers builder, enough for the Arrow IPC metadata.
+           Like the reference implementation, the buffer is filled from the
+           back, objects are referred to by their distance to the end of the
+           buffer and children are created before their parents. */
+        class flatbuffer_builder
+        {
+        public:
+
+            using offset = std::uint32_t;
+
+            flatbuffer_builder()
+                : m_buffer(256)
+                , m_head(m_buffer.size())
+            {
+            }
+
+            offset size() const noexcept
+            {
+                return static_cast<offset>(m_buffer.size() - m_head);
+            }
+
+            /* Pads so that size() + extra is a multiple of alignment */
+            void align(std::size_t alignment, std::size_t extra = 0)
+            {
+                while ((size() + extra) % alignment != 0)
+                {
+                    prepend_bytes("\0", 1);
+                }
+            }
+
+            template <class T>
+            void push(T value)
+            {
+                align(sizeof(T));
+                prepend_bytes(&value, sizeof(T));
+            }
+
+            void push_offset(offset target)
+            {
+                align(sizeof(offset));
+                push<offset>(size() + sizeof(offset) - target);
+            }
+
+            offset create_string(std::string_view str)
+            {
+                align(sizeof(offset), str.size() + 1);
+                prepend_bytes("\0", 1);
+                prepend_bytes(str.data(), str.size());
+                push<std::uint32_t>(static_cast<std::uint32_t>(str.size()));
+                return size();
+            }
+
+            offset create_struct_vector(const void* data, std::size_t count, std::size_t struct_size)
+            {
+                align(sizeof(offset), count * struct_size);
+                align(8, count * struct_size);
+                prepend_bytes(data, count * struct_size);
+                push<std::uint32_t>(static_cast<std::uint32_t>(count));
+                return size();
+            }
+
+            offset create_offset_vector(const std::vector<offset>& offsets)
+            {
+                align(sizeof(offset), offsets.size() * sizeof(offset));
+                for (auto it = offsets.rbegin(); it != offsets.rend(); ++it)
+                {
+                    push_offset(*it);
+                }
+                push<std::uint32_t>(static_cast<std::uint32_t>(offsets.size()));
+                return size();
+            }
+
+            void start_table()
+            {
+                m_fields.clear();
+                m_table_start = size();
+            }
+
+            template <class T>
+            void add_scalar(std::uint16_t id, T value)
+            {
+                push(value);
+                m_fields.emplace_back(id, size());
+            }
+
+            void add_offset(std::uint16_t id, offset target)
+            {
+                push_offset(target);
+                m_fields.emplace_back(id, size());
+            }
+
+            offset end_table()
+            {
+                push<std::int32_t>(0);
+                offset table = size();
+
+                std::uint16_t slots = 0;
+                for (const auto& field : m_fields)
+                {
+                    slots = std::max<std::uint16_t>(slots, static_cast<std::uint16_t>(field.first + 1));
+                }
+                std::vector<std::uint16_t> vtable(slots + 2u, 0);
+                vtable[0] = static_cast<std::uint16_t>(vtable.size() * sizeof(std::uint16_t));
+                vtable[1] = static_cast<std::uint16_t>(table - m_table_start);
+                for (const auto& field : m_fields)
+                {
+                    vtable[field.first + 2u] = static_cast<std::uint16_t>(table - field.second);
+                }
+                for (auto it = vtable.rbegin(); it != vtable.rend(); ++it)
+                {
+                    push(*it);
+                }
+
+                std::int32_t vtable_distance = static_cast<std::int32_t>(size() - table);
+                std::memcpy(&m_buffer[m_buffer.size() - table], &vtable_distance, sizeof(vtable_distance));
+                return table;
+            }
+
+            std::string finish(offset root)
+            {
+                align(8, sizeof(offset));
+                push_offset(root);
+                return std::string(m_buffer.begin() + static_cast<std::ptrdiff_t>(m_head), m_buffer.end());
+            }
+
+        private:
+
+            void prepend_bytes(const void* data, std::size_t count)
+            {
+                if (count > m_head)
+                {
+                    std::size_t used = size();
+                    std::size_t capacity = std::max(m_buffer.size() * 2, used + count);
+                    std::vector<char> grown(capacity);
+                    std::copy(m_buffer.begin() + static_cast<std::ptrdiff_t>(m_head), m_buffer.end(),
+                              grown.end() - static_cast<std::ptrdiff_t>(used));
+                    m_buffer.swap(grown);
+                    m_head = m_buffer.size() - used;
+                }
+                m_head -= count;
+                std::memcpy(&m_buffer[m_head], data, count);
+            }
+
+            std::vector<char> m_buffer;
+            std::size_t m_head;
+            offset m_table_start = 0;
+            std::vector<std::pair<std::uint16_t, offset>> m_fields;
+        };
+
+        /* Values of the Arrow format enums and unions, see Schema.fbs and
+           Message.fbs in the Arrow repository */
+        constexpr std::int16_t arrow_metadata_v5 = 4;
+        constexpr std::uint8_t arrow_header_schema = 1;
+        constexpr std::uint8_t arrow_header_record_batch = 3;
+        constexpr std::uint8_t arrow_type_int = 2;
+        constexpr std::uint8_t arrow_type_floating_point = 3;
+        constexpr std::uint8_t arrow_type_binary = 4;
+        constexpr std::uint8_t arrow_type_utf8 = 5;
+        constexpr std::int16_t arrow_precision_double = 2;
+
+        struct arrow_field_node
+        {
+            std::int64_t length;
+            std::int64_t null_count;
+        };
+
+        struct arrow_buffer
+        {
+            std::int64_t offset;
+            std::int64_t length;
+        };
+
+        std::string arrow_message(flatbuffer_builder& builder, std::uint8_t header_type,
+                                  flatbuffer_builder::offset header, std::int64_t body_length)
+        {
+            builder.start_table();
+            builder.add_scalar<std::int64_t>(3, body_length);
+            builder.add_offset(2, header);
+            builder.add_scalar<std::int16_t>(0, arrow_metadata_v5);
+            builder.add_scalar<std::uint8_t>(1, header_type);
+            return builder.finish(builder.end_table());
+        }
+
+        void pad_to_8(std::string& body)
+        {
+            body.append((8 - body.size() % 8) % 8, '\0');
+        }
+
+        template <class T>
+        void append_value(std::string& body, T value)
+        {
+            body.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        std::string format_integer(std::int64_t value)
+        {
+            char buffer[24];
+            auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            return std::string(buffer, res.ptr);
+        }
+
+        std::string format_real(double value)
+        {
+            char buffer[32];
+#if defined(__cpp_lib_to_chars)
+            auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            return std::string(buffer, res.ptr);
+#else
+            int size = std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+            return std::string(buffer, static_cast<std::size_t>(size));
+#endif
+        }
+
+        export_type affinity_type(const std::string& declared)
+        {
+            /* Column affinity rules of https://www.sqlite.org/datatype3.html */
+            std::string type = declared;
+            std::transform(type.begin(), type.end(), type.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+            if (type.find("INT") != std::string::npos)
+            {
+                return export_type::int64;
+            }
+            else if (type.find("CHAR") != std::string::npos
+                     || type.find("CLOB") != std::string::npos
+                     || type.find("TEXT") != std::string::npos)
+            {
+                return export_type::utf8;
+            }
+            else if (type.find("REAL") != std::string::npos
+                     || type.find("FLOA") != std::string::npos
+                     || type.find("DOUB") != std::string::npos)
+            {
+                return export_type::float64;
+            }
+            throw std::invalid_argument("No affinity fixes the type of " + declared);
+        }
+
+        export_type value_type(const result_column& column)
+        {
+            bool has_real = false;
+            bool has_integer = false;
+            bool has_blob = false;
+            for (std::size_t row = 0; row < column.size(); ++row)
+            {
+                switch (column.type(row))
+                {
+                    case cell_type::text:
+                        return export_type::utf8;
+                    case cell_type::blob:
+                        has_blob = true;
+                        break;
+                    case cell_type::real:
+                        has_real = true;
+                        break;
+                    case cell_type::integer:
+                        has_integer = true;
+                        break;
+                    default:
+                        break;
+                }
+            }
+            return has_blob ? export_type::binary
+                 : has_real ? export_type::float64
+                 : has_integer ? export_type::int64 : export_type::utf8;
+        }
+    }
+
+    export_format export_format_from(const std::string& name)
+    {
+        std::string lower = name;
+        std::transform(lower.begin(), lower.end(), lower.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (lower == "csv")
+        {
+            return export_format::csv;
+        }
+        else if (lower == "arrow" || lower == "ipc" || lower == "arrows")
+        {
+            return export_format::arrow;
+        }
+        else if (lower == "parquet")
+        {
+            throw std::runtime_error("Parquet export is not available in this build, use arrow or csv.");
+        }
+        throw std::runtime_error("Unknown export format " + name + ", use arrow or csv.");
+    }
+
+    std::size_t batch_writer::coerced() const noexcept
+    {
+        return m_coerced;
+    }
+
+    /***************************
+     * csv_writer implementation
+     ***************************/
+
+    csv_writer::csv_writer(std::ostream& out)
+        : m_out(out)
+    {
+    }
+
+    void csv_writer::write_schema(const std::vector<std::string>& names,
+                                  const std::vector<export_type>&)
+    {
+        m_line.clear();
+        for (std::size_t col = 0; col < names.size(); ++col)
+        {
+            if (col != 0)
+            {
+                m_line += ',';
+            }
+            write_field(names[col]);
+        }
+        m_line += '\n';
+        m_out.write(m_line.data(), static_cast<std::streamsize>(m_line.size()));
+    }
+
+    void csv_writer::write_batch(const result_table& batch)
+    {
+        for (std::size_t row = 0; row < batch.rows(); ++row)
+        {
+            m_line.clear();
+            for (std::size_t col = 0; col < batch.columns(); ++col)
+            {
+                if (col != 0)
+                {
+                    m_line += ',';
+                }
+                const result_column& column = batch.column(col);
+                switch (column.type(row))
+                {
+                    case cell_type::integer:
+                        m_line += format_integer(column.integer(row));
+                        break;
+                    case cell_type::real:
+                        m_line += format_real(column.real(row));
+                        break;
+                    case cell_type::text:
+                    case cell_type::blob:
+                        write_field(column.bytes(row));
+                        break;
+                    default:
+                        break;
+                }
+            }
+            m_line += '\n';
+            m_out.write(m_line.data(), static_cast<std::streamsize>(m_line.size()));
+        }
+    }
+
+    void csv_writer::finish()
+    {
+        m_out.flush();
+    }
+
+    void csv_writer::write_field(std::string_view field)
+    {
+        if (field.find_first_of(",\"\r\n") == std::string_view::npos)
+        {
+            m_line += field;
+            return;
+        }
+        m_line += '"';
+        for (char c : field)
+        {
+            if (c == '"')
+            {
+                m_line += '"';
+            }
+            m_line += c;
+        }
+        m_line += '"';
+    }
+
+    /************************************
+     * arrow_stream_writer implementation
+     ************************************/
+
+    arrow_stream_writer::arrow_stream_writer(std::ostream& out)
+        : p_out(&out)
+    {
+    }
+
+    arrow_stream_writer::arrow_stream_writer(message_buffers& messages)
+        : p_messages(&messages)
+    {
+    }
+
+    void arrow_stream_writer::write_schema(const std::vector<std::string>& names,
+                                           const std::vector<export_type>& types)
+    {
+        m_types = types;
+        flatbuffer_builder builder;
+
+        std::vector<flatbuffer_builder::offset> fields;
+        for (std::size_t col = 0; col < names.size(); ++col)
+        {
+            flatbuffer_builder::offset name = builder.create_string(names[col]);
+            flatbuffer_builder::offset children = builder.create_offset_vector({});
+
+            std::uint8_t type_type = arrow_type_utf8;
+            builder.start_table();
+            switch (types[col])
+            {
+                case export_type::int64:
+                    type_type = arrow_type_int;
+                    builder.add_scalar<std::int32_t>(0, 64);
+                    builder.add_scalar<std::uint8_t>(1, 1);
+                    break;
+                case export_type::float64:
+                    type_type = arrow_type_floating_point;
+                    builder.add_scalar<std::int16_t>(0, arrow_precision_double);
+                    break;
+                case export_type::binary:
+                    type_type = arrow_type_binary;
+                    break;
+                default:
+                    break;
+            }
+            flatbuffer_builder::offset type = builder.end_table();
+
+            builder.start_table();
+            builder.add_offset(0, name);
+            builder.add_offset(3, type);
+            builder.add_offset(5, children);
+            builder.add_scalar<std::uint8_t>(1, 1);
+            builder.add_scalar<std::uint8_t>(2, type_type);
+            fields.push_back(builder.end_table());
+        }
+        flatbuffer_builder::offset field_vector = builder.create_offset_vector(fields);
+
+        builder.start_table();
+        builder.add_offset(1, field_vector);
+        builder.add_scalar<std::int16_t>(0, 0);
+        flatbuffer_builder::offset schema = builder.end_table();
+
+        write_message(arrow_message(builder, arrow_header_schema, schema, 0), std::string());
+    }
+
+    void arrow_stream_writer::write_batch(const result_table& batch)
+    {
+        const std::size_t rows = batch.rows();
+        std::vector<arrow_field_node> nodes;
+        std::vector<arrow_buffer> buffers;
+        m_body.clear();
+
+        auto add_buffer = [this, &buffers](std::size_t start)
+        {
+            buffers.push_back({static_cast<std::int64_t>(start),
+                               static_cast<std::int64_t>(m_body.size() - start)});
+            pad_to_8(m_body);
+        };
+
+        for (std::size_t col = 0; col < batch.columns(); ++col)
+        {
+            const result_column& column = batch.column(col);
+            const export_type type = m_types[col];
+
+            /* Validity bitmap, omitted when the batch holds no null */
+            std::size_t validity_start = m_body.size();
+            m_body.append((rows + 7) / 8, '\0');
+            std::int64_t null_count = 0;
+
+            /* Values are checked against the column type before the
+               bitmap is final, cells that don't fit are written as null */
+            auto is_valid = [&](std::size_t row)
+            {
+                cell_type cell = column.type(row);
+                switch (type)
+                {
+                    case export_type::int64:
+                    case export_type::float64:
+                        return cell == cell_type::integer || cell == cell_type::real;
+                    default:
+                        return cell != cell_type::null;
+                }
+            };
+            for (std::size_t row = 0; row < rows; ++row)
+            {
+                if (is_valid(row))
+                {
+                    m_body[validity_start + row / 8] |= static_cast<char>(1 << (row % 8));
+                }
+                else
+                {
+                    ++null_count;
+                    m_coerced += column.type(row) != cell_type::null;
+                }
+            }
+            if (null_count == 0)
+            {
+                m_body.resize(validity_start);
+            }
+            add_buffer(validity_start);
+            nodes.push_back({static_cast<std::int64_t>(rows), null_count});
+
+            std::size_t values_start = m_body.size();
+            if (type == export_type::int64)
+            {
+                for (std::size_t row = 0; row < rows; ++row)
+                {
+                    cell_type cell = column.type(row);
+                    std::int64_t value = cell == cell_type::integer ? column.integer(row)
+                                       : cell == cell_type::real ? static_cast<std::int64_t>(column.real(row)) : 0;
+                    m_coerced += cell == cell_type::real;
+                    append_value(m_body, value);
+                }
+                add_buffer(values_start);
+            }
+            else if (type == export_type::float64)
+            {
+                for (std::size_t row = 0; row < rows; ++row)
+                {
+                    cell_type cell = column.type(row);
+                    double value = cell == cell_type::real ? column.real(row)
+                                 : cell == cell_type::integer ? static_cast<double>(column.integer(row)) : 0.;
+                    append_value(m_body, value);
+                }
+                add_buffer(values_start);
+            }
+            else
+            {
+                /* Offsets first, the data buffer is appended after them */
+                std::string data;
+                for (std::size_t row = 0; row < rows; ++row)
+                {
+                    append_value(m_body, static_cast<std::int32_t>(data.size()));
+                    cell_type cell = column.type(row);
+                    if (cell == cell_type::text || cell == cell_type::blob)
+                    {
+                        data += column.bytes(row);
+                        m_coerced += cell == cell_type::blob && type == export_type::utf8;
+                    }
+                    else if (cell != cell_type::null)
+                    {
+                        data += column.to_string(row);
+                    }
+                    if (data.size() > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()))
+                    {
+                        throw std::runtime_error("Column " + column.name()
+                                                 + " holds more than 2GB in a single batch.");
+                    }
+                }
+                append_value(m_body, static_cast<std::int32_t>(data.size()));
+                add_buffer(values_start);
+
+                std::size_t data_start = m_body.size();
+                m_body += data;
+                add_buffer(data_start);
+            }
+        }
+
+        flatbuffer_builder builder;
+        flatbuffer_builder::offset node_vector =
+            builder.create_struct_vector(nodes.data(), nodes.size(), sizeof(arrow_field_node));
+        flatbuffer_builder::offset buffer_vector =
+            builder.create_struct_vector(buffers.data(), buffers.size(), sizeof(arrow_buffer));
+
+        builder.start_table();
+        builder.add_scalar<std::int64_t>(0, static_cast<std::int64_t>(rows));
+        builder.add_offset(1, node_vector);
+        builder.add_offset(2, buffer_vector);
+        flatbuffer_builder::offset record_batch = builder.end_table();
+
+        write_message(arrow_message(builder, arrow_header_record_batch, record_batch,
+                                    static_cast<std::int64_t>(m_body.size())),
+                      m_body);
+    }
+
+    void arrow_stream_writer::finish()
+    {
+        const std::uint32_t end_of_stream[2] = {0xFFFFFFFFu, 0u};
+        const char* bytes = reinterpret_cast<const char*>(end_of_stream);
+        if (p_messages != nullptr)
+        {
+            p_messages->emplace_back(bytes, bytes + sizeof(end_of_stream));
+            return;
+        }
+        p_out->write(bytes, sizeof(end_of_stream));
+        p_out->flush();
+    }
+
+    void arrow_stream_writer::write_message(const std::string& metadata, const std::string& body)
+    {
+        /* Continuation marker and metadata size, the metadata is padded so
+           that the body starts on an 8 bytes boundary */
+        std::size_t padding = (8 - metadata.size() % 8) % 8;
+        const std::uint32_t continuation = 0xFFFFFFFFu;
+        const std::int32_t metadata_size = static_cast<std::int32_t>(metadata.size() + padding);
+        if (p_messages != nullptr)
+        {
+            std::vector<char>& message = p_messages->emplace_back();
+            message.reserve(8 + metadata.size() + padding + body.size());
+            message.insert(message.end(), reinterpret_cast<const char*>(&continuation),
+                           reinterpret_cast<const char*>(&continuation) + sizeof(continuation));
+            message.insert(message.end(), reinterpret_cast<const char*>(&metadata_size),
+                           reinterpret_cast<const char*>(&metadata_size) + sizeof(metadata_size));
+            message.insert(message.end(), metadata.begin(), metadata.end());
+            message.insert(message.end(), padding, '\0');
+            message.insert(message.end(), body.begin(), body.end());
+            return;
+        }
+        p_out->write(reinterpret_cast<const char*>(&continuation), sizeof(continuation));
+        p_out->write(reinterpret_cast<const char*>(&metadata_size), sizeof(metadata_size));
+        p_out->write(metadata.data(), static_cast<std::streamsize>(metadata.size()));
+        p_out->write("\0\0\0\0\0\0\0", static_cast<std::streamsize>(padding));
+        p_out->write(body.data(), static_cast<std::streamsize>(body.size()));
+    }
+
+    /*************************
+     * export implementation
+     *************************/
+
+    std::vector<export_type> export_types(SQLite::Statement& query,
+                                          const result_table& first_batch)
+    {
+        std::vector<export_type> types;
+        for (std::size_t col = 0; col < first_batch.columns(); ++col)
+        {
+            try
+            {
+                types.push_back(affinity_type(query.getColumnDeclaredType(static_cast<int>(col))));
+            }
+            catch (const std::exception&)
+            {
+                /* Expressions have no declared type, and NUMERIC or BLOB
+                   affinities don't tell what values are stored */
+                types.push_back(value_type(first_batch.column(col)));
+            }
+        }
+        return types;
+    }
+
+    export_summary export_query(SQLite::Statement& query,
+                                const std::string& path,
+                                export_format format,
+                                std::size_t batch_rows)
+    {
+        auto start = std::chrono::steady_clock::now();
+        export_summary summary;
+
+        std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+        {
+            throw std::runtime_error("Cannot write " + path + ".");
+        }
+
+        std::unique_ptr<batch_writer> writer;
+        if (format == export_format::arrow)
+        {
+            writer = std::make_unique<arrow_stream_writer>(out);
+        }
+        else
+        {
+            writer = std::make_unique<csv_writer>(out);
+        }
+
+        try
+        {
+            result_table batch(result_table::no_value_limit);
+            batch.fill(query, batch_rows);
+
+            std::vector<std::string> names;
+            for (std::size_t col = 0; col < batch.columns(); ++col)
+            {
+                names.push_back(batch.column(col).name());
+            }
+            writer->write_schema(names, export_types(query, batch));
+
+            while (batch.rows() != 0)
+            {
+                writer->write_batch(batch);
+                summary.rows += batch.rows();
+                ++summary.batches;
+                if (batch.rows() < batch_rows)
+                {
+                    break;
+                }
+                batch.fill(query, batch_rows);
+            }
+            writer->finish();
+            if (!out)
+            {
+                throw std::runtime_error("Failed to write " + path + ".");
+            }
+        }
+        catch (...)
+        {
+            out.close();
+            std::remove(path.c_str());
+            throw;
+        }
+
+        summary.bytes = static_cast<std::size_t>(out.tellp());
+        summary.coerced = writer->coerced();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        summary.seconds = elapsed.count();
+        return summary;
+    }
+
+    export_summary stream_query(SQLite::Statement& query,
+                                result_table& result,
+                                message_buffers& messages,
+                                std::size_t batch_rows)
+    {
+        auto start = std::chrono::steady_clock::now();
+        export_summary summary;
+        arrow_stream_writer writer(messages);
+        batch_rows = std::max<std::size_t>(1, batch_rows);
+
+        /* The schema is written with the first batch, whose values fix the
+           types of the columns without declared type */
+        result_table batch(result_table::no_value_limit);
+        result.reset(query);
+        batch.reset(query);
+        bool has_schema = false;
+        auto write_batch = [&]()
+        {
+            if (!has_schema)
+            {
+                std::vector<std::string> names;
+                for (std::size_t col = 0; col < batch.columns(); ++col)
+                {
+                    names.push_back(batch.column(col).name());
+                }
+                writer.write_schema(names, export_types(query, batch));
+                has_schema = true;
+            }
+            if (batch.rows() != 0)
+            {
+                writer.write_batch(batch);
+                summary.rows += batch.rows();
+                ++summary.batches;
+            }
+            batch.reset(query);
+        };
+
+        while (query.executeStep())
+        {
+            result.append_row(query);
+            batch.append_row(query);
+            if (batch.rows() == batch_rows)
+            {
+                write_batch();
+            }
+        }
+        write_batch();
+        writer.finish();
+
+        for (const std::vector<char>& message : messages)
+        {
+            summary.bytes += message.size();
+        }
+        summary.coerced = writer.coerced();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        summary.seconds = elapsed.count();
+        return summary;
+    }
+}
@@ -0,0 +1,604 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "xeus-sqlite/xfunctions.hpp"
+
+namespace nl = nlohmann;
+
+namespace xeus_sqlite
+{
+    namespace
+    {
+#ifdef SQLITE_INNOCUOUS
+        constexpr int function_flags = SQLITE_UTF8 | SQLITE_DETERMINISTIC | SQLITE_INNOCUOUS;
+#else
+        constexpr int function_flags = SQLITE_UTF8 | SQLITE_DETERMINISTIC;
+#endif
+
+        bool is_null(sqlite3_value* value)
+        {
+            return sqlite3_value_type(value) == SQLITE_NULL;
+        }
+
+        /* Adapts an accumulator to the callbacks of sqlite3_create_window_function.
+           The aggregate context only holds a pointer to the accumulator, which
+           is allocated by the first row and deleted by xFinal */
+        template <class A>
+        struct aggregate
+        {
+            static A* state(sqlite3_context* context, bool create)
+            {
+                A** slot = static_cast<A**>(sqlite3_aggregate_context(context, create ? sizeof(A*) : 0));
+                if (slot == nullptr)
+                {
+                    return nullptr;
+                }
+                if (*slot == nullptr && create)
+                {
+                    *slot = new A();
+                }
+                return *slot;
+            }
+
+            static void step(sqlite3_context* context, int argc, sqlite3_value** argv)
+            {
+                try
+                {
+                    A* accumulator = state(context, true);
+                    if (accumulator == nullptr)
+                    {
+                        return sqlite3_result_error_nomem(context);
+                    }
+                    accumulator->step(argc, argv);
+                }
+                catch (const std::bad_alloc&)
+                {
+                    sqlite3_result_error_nomem(context);
+                }
+                catch (const std::exception& err)
+                {
+                    sqlite3_result_error(context, err.what(), -1);
+                }
+            }
+
+            static void inverse(sqlite3_context* context, int argc, sqlite3_value** argv)
+            {
+                A* accumulator = state(context, false);
+                if (accumulator != nullptr)
+                {
+                    accumulator->inverse(argc, argv);
+                }
+            }
+
+            static void value(sqlite3_context* context)
+            {
+                try
+                {
+                    A* accumulator = state(context, false);
+                    if (accumulator != nullptr)
+                    {
+                        accumulator->result(context);
+                    }
+                    else
+                    {
+                        A().result(context);
+                    }
+                }
+                catch (const std::bad_alloc&)
+                {
+                    sqlite3_result_error_nomem(context);
+                }
+            }
+
+            static void final(sqlite3_context* context)
+            {
+                value(context);
+                A** slot = static_cast<A**>(sqlite3_aggregate_context(context, 0));
+                if (slot != nullptr)
+                {
+                    delete *slot;
+                    *slot = nullptr;
+                }
+            }
+        };
+
+        template <class A>
+        void create_window_function(sqlite3* handle, const char* name, int arguments)
+        {
+            int rc = sqlite3_create_window_function(handle, name, arguments, function_flags, nullptr,
+                                                    &aggregate<A>::step, &aggregate<A>::final,
+                                                    &aggregate<A>::value, &aggregate<A>::inverse,
+                                                    nullptr);
+            if (rc != SQLITE_OK)
+            {
+                throw SQLite::Exception(handle, rc);
+            }
+        }
+
+        template <class A>
+        void create_aggregate_function(sqlite3* handle, const char* name, int arguments)
+        {
+            int rc = sqlite3_create_function_v2(handle, name, arguments, function_flags, nullptr,
+                                                nullptr, &aggregate<A>::step, &aggregate<A>::final,
+                                                nullptr);
+            if (rc != SQLITE_OK)
+            {
+                throw SQLite::Exception(handle, rc);
+            }
+        }
+
+        /* Values of the frame in a contiguous buffer. Order statistics are
+           selected in place with nth_element, the order of the values
+           doesn't matter to the rows removed from the frame */
+        class sample
+        {
+        public:
+
+            void add(sqlite3_value* value)
+            {
+                if (!is_null(value))
+                {
+                    m_values.push_back(sqlite3_value_double(value));
+                }
+            }
+
+            void remove(sqlite3_value* value)
+            {
+                if (is_null(value))
+                {
+                    return;
+                }
+                auto it = std::find(m_values.begin(), m_values.end(), sqlite3_value_double(value));
+                if (it != m_values.end())
+                {
+                    *it = m_values.back();
+                    m_values.pop_back();
+                }
+            }
+
+            bool empty() const noexcept
+            {
+                return m_values.empty();
+            }
+
+            /* Linear interpolation between the closest ranks */
+            double percentile(double fraction)
+            {
+                double position = fraction * static_cast<double>(m_values.size() - 1);
+                std::size_t rank = static_cast<std::size_t>(position);
+                auto nth = m_values.begin() + static_cast<std::ptrdiff_t>(rank);
+                std::nth_element(m_values.begin(), nth, m_values.end());
+                double low = *nth;
+                if (position == static_cast<double>(rank))
+                {
+                    return low;
+                }
+                double high = *std::min_element(nth + 1, m_values.end());
+                return low + (position - static_cast<double>(rank)) * (high - low);
+            }
+
+            const std::vector<double>& values() const noexcept
+            {
+                return m_values;
+            }
+
+        private:
+
+            std::vector<double> m_values;
+        };
+
+        struct median_function
+        {
+            sample values;
+
+            void step(int, sqlite3_value** argv)
+            {
+                values.add(argv[0]);
+            }
+
+            void inverse(int, sqlite3_value** argv)
+            {
+                values.remove(argv[0]);
+            }
+
+            void result(sqlite3_context* context)
+            {
+                if (values.empty())
+                {
+                    return sqlite3_result_null(context);
+                }
+                sqlite3_result_double(context, values.percentile(0.5));
+            }
+        };
+
+        struct percentile_function
+        {
+            sample values;
+            double fraction = -1.;
+
+            void step(int, sqlite3_value** argv)
+            {
+                double requested = sqlite3_value_double(argv[1]);
+                if (is_null(argv[1]) || requested < 0. || requested > 1.)
+                {
+                    throw std::runtime_error("The percentile must be between 0 and 1.");
+                }
+                if (fraction >= 0. && requested != fraction)
+                {
+                    throw std::runtime_error("The percentile must be the same for all rows.");
+                }
+                fraction = requested;
+                values.add(argv[0]);
+            }
+
+            void inverse(int, sqlite3_value** argv)
+            {
+                values.remove(argv[0]);
+            }
+
+            void result(sqlite3_context* context)
+            {
+                if (values.empty())
+                {
+                    return sqlite3_result_null(context);
+                }
+                sqlite3_result_double(context, values.percentile(fraction));
+            }
+        };
+
+        /* Welford's running mean and sum of squared deviations, which stay
+           accurate on large values, updated backwards for rows leaving a
+           window frame */
+        struct moments
+        {
+            std::int64_t count = 0;
+            double mean = 0.;
+            double m2 = 0.;
+
+            void step(int, sqlite3_value** argv)
+            {
+                if (is_null(argv[0]))
+                {
+                    return;
+                }
+                double x = sqlite3_value_double(argv[0]);
+                ++count;
+                double delta = x - mean;
+                mean += delta / static_cast<double>(count);
+                m2 += delta * (x - mean);
+            }
+
+            void inverse(int, sqlite3_value** argv)
+            {
+                if (is_null(argv[0]) || count == 0)
+                {
+                    return;
+                }
+                if (--count == 0)
+                {
+                    mean = m2 = 0.;
+                    return;
+                }
+                double x = sqlite3_value_double(argv[0]);
+                double delta = x - mean;
+                mean -= delta / static_cast<double>(count);
+                m2 -= delta * (x - mean);
+            }
+
+            /* Of the sample, m2 can get slightly negative through removals */
+            double variance() const
+            {
+                return std::max(m2, 0.) / static_cast<double>(count - 1);
+            }
+        };
+
+        struct var_function : moments
+        {
+            void result(sqlite3_context* context)
+            {
+                if (count < 2)
+                {
+                    return sqlite3_result_null(context);
+                }
+                sqlite3_result_double(context, variance());
+            }
+        };
+
+        struct stddev_function : moments
+        {
+            void result(sqlite3_context* context)
+            {
+                if (count < 2)
+                {
+                    return sqlite3_result_null(context);
+                }
+                sqlite3_result_double(context, std::sqrt(variance()));
+            }
+        };
+
+        struct corr_function
+        {
+            std::int64_t count = 0;
+            double mean_x = 0.;
+            double mean_y = 0.;
+            double m2_x = 0.;
+            double m2_y = 0.;
+            double comoment = 0.;
+
+            void step(int, sqlite3_value** argv)
+            {
+                if (is_null(argv[0]) || is_null(argv[1]))
+                {
+                    return;
+                }
+                double y = sqlite3_value_double(argv[0]);
+                double x = sqlite3_value_double(argv[1]);
+                ++count;
+                double n = static_cast<double>(count);
+                double delta_x = x - mean_x;
+                double delta_y = y - mean_y;
+                mean_x += delta_x / n;
+                mean_y += delta_y / n;
+                m2_x += delta_x * (x - mean_x);
+                m2_y += delta_y * (y - mean_y);
+                comoment += delta_x * (y - mean_y);
+            }
+
+            void inverse(int, sqlite3_value** argv)
+            {
+                if (is_null(argv[0]) || is_null(argv[1]) || count == 0)
+                {
+                    return;
+                }
+                if (--count == 0)
+                {
+                    *this = corr_function();
+                    return;
+                }
+                double y = sqlite3_value_double(argv[0]);
+                double x = sqlite3_value_double(argv[1]);
+                double n = static_cast<double>(count);
+                double delta_x = x - mean_x;
+                double delta_y = y - mean_y;
+                mean_x -= delta_x / n;
+                mean_y -= delta_y / n;
+                m2_x -= delta_x * (x - mean_x);
+                m2_y -= delta_y * (y - mean_y);
+                comoment -= (x - mean_x) * delta_y;
+            }
+
+            void result(sqlite3_context* context)
+            {
+                double denominator = std::sqrt(m2_x * m2_y);
+                if (count < 2 || !(denominator > 0.))
+                {
+                    return sqlite3_result_null(context);
+                }
+                sqlite3_result_double(context, std::max(-1., std::min(1., comoment / denominator)));
+            }
+        };
+
+        struct histogram_function
+        {
+            static constexpr std::int64_t max_bins = 100000;
+
+            sample values;
+            std::int64_t bins = 0;
+
+            void step(int, sqlite3_value** argv)
+            {
+                std::int64_t requested = sqlite3_value_int64(argv[1]);
+                if (requested < 1 || requested > max_bins)
+                {
+                    throw std::runtime_error("The number of bins must be between 1 and "
+                                             + std::to_string(max_bins) + ".");
+                }
+                if (bins != 0 && requested != bins)
+                {
+                    throw std::runtime_error("The number of bins must be the same for all rows.");
+                }
+                bins = requested;
+                values.add(argv[0]);
+            }
+
+            void inverse(int, sqlite3_value** argv)
+            {
+                values.remove(argv[0]);
+            }
+
+            void result(sqlite3_context* context)
+            {
+                if (values.empty())
+                {
+                    return sqlite3_result_null(context);
+                }
+
+                /* Branch free loops over the contiguous values, which the
+                   compiler vectorizes */
+                const std::vector<double>& data = values.values();
+                double low = data.front();
+                double high = data.front();
+                for (double x : data)
+                {
+                    low = std::min(low, x);
+                    high = std::max(high, x);
+                }
+                std::size_t bin_count = static_cast<std::size_t>(bins);
+                double width = (high - low) / static_cast<double>(bin_count);
+                double scale = width > 0. ? 1. / width : 0.;
+                std::vector<std::int64_t> counts(bin_count, 0);
+                for (double x : data)
+                {
+                    std::size_t bin = static_cast<std::size_t>((x - low) * scale);
+                    ++counts[std::min(bin, bin_count - 1)];
+                }
+
+                nl::json res = nl::json::array();
+                for (std::size_t i = 0; i < bin_count; ++i)
+                {
+                    res.push_back({{"lo", low + width * static_cast<double>(i)},
+                                   {"hi", i + 1 == bin_count ? high : low + width * static_cast<double>(i + 1)},
+                                   {"count", counts[i]}});
+                }
+                std::string text = res.dump();
+                sqlite3_result_text(context, text.c_str(), static_cast<int>(text.size()), SQLITE_TRANSIENT);
+            }
+        };
+
+        /* Finalizer of splitmix64 */
+        std::uint64_t mix(std::uint64_t x)
+        {
+            x ^= x >> 30;
+            x *= 0xbf58476d1ce4e5b9ULL;
+            x ^= x >> 27;
+            x *= 0x94d049bb133111ebULL;
+            x ^= x >> 31;
+            return x;
+        }
+
+        std::uint64_t hash_bytes(const unsigned char* bytes, std::size_t size, std::uint64_t seed)
+        {
+            std::uint64_t h = seed ^ (size * 0x9e3779b97f4a7c15ULL);
+            std::size_t i = 0;
+            for (; i + 8 <= size; i += 8)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, bytes + i, 8);
+                h = (h ^ mix(word)) * 0x9e3779b97f4a7c15ULL;
+            }
+            std::uint64_t tail = 0;
+            if (i < size)
+            {
+                std::memcpy(&tail, bytes + i, size - i);
+            }
+            return mix(h ^ tail);
+        }
+
+        /* Equal integers and reals hash the same, as count(DISTINCT) treats
+           them as the same value. Text and blobs never equal numbers */
+        std::uint64_t hash_value(sqlite3_value* value)
+        {
+            switch (sqlite3_value_type(value))
+            {
+                case SQLITE_INTEGER:
+                    return mix(static_cast<std::uint64_t>(sqlite3_value_int64(value)));
+                case SQLITE_FLOAT:
+                {
+                    double x = sqlite3_value_double(value);
+                    if (x >= -9.2e18 && x <= 9.2e18 && x == std::floor(x))
+                    {
+                        return mix(static_cast<std::uint64_t>(static_cast<std::int64_t>(x)));
+                    }
+                    std::uint64_t bits;
+                    std::memcpy(&bits, &x, sizeof(bits));
+                    return mix(bits ^ 0x5851f42d4c957f2dULL);
+                }
+                case SQLITE_TEXT:
+                    return hash_bytes(sqlite3_value_text(value),
+                                      static_cast<std::size_t>(sqlite3_value_bytes(value)),
+                                      0x2545f4914f6cdd1dULL);
+                default:
+                    return hash_bytes(static_cast<const unsigned char*>(sqlite3_value_blob(value)),
+                                      static_cast<std::size_t>(sqlite3_value_bytes(value)),
+                                      0x14057b7ef767814fULL);
+            }
+        }
+
+        int leading_zeros(std::uint64_t x)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return x == 0 ? 64 : __builtin_clzll(x);
+#else
+            int count = 0;
+            for (std::uint64_t bit = 1ULL << 63; bit != 0 && (x & bit) == 0; bit >>= 1)
+            {
+                ++count;
+            }
+            return count;
+#endif
+        }
+
+        /* HyperLogLog: the first bits of the hash select a register, which
+           keeps the longest run of leading zeros seen in the other bits */
+        struct approx_count_distinct_function
+        {
+            static constexpr int precision = 14;
+            static constexpr std::size_t register_count = std::size_t(1) << precision;
+
+            std::array<std::uint8_t, register_count> registers = {};
+
+            void step(int, sqlite3_value** argv)
+            {
+                if (is_null(argv[0]))
+                {
+                    return;
+                }
+                std::uint64_t hash = hash_value(argv[0]);
+                std::size_t index = static_cast<std::size_t>(hash >> (64 - precision));
+                std::uint64_t rest = hash << precision;
+                std::uint8_t rank = static_cast<std::uint8_t>(
+                    rest == 0 ? 64 - precision + 1 : leading_zeros(rest) + 1);
+                registers[index] = std::max(registers[index], rank);
+            }
+
+            void result(sqlite3_context* context)
+            {
+                static const std::array<double, 66> inverse_powers = []()
+                {
+                    std::array<double, 66> res;
+                    for (std::size_t i = 0; i < res.size(); ++i)
+                    {
+                        res[i] = std::ldexp(1., -static_cast<int>(i));
+                    }
+                    return res;
+                }();
+
+                double m = static_cast<double>(register_count);
+                double sum = 0.;
+                std::size_t zeros = 0;
+                for (std::uint8_t rank : registers)
+                {
+                    sum += inverse_powers[rank];
+                    zeros += rank == 0;
+                }
+                double estimate = 0.7213 / (1. + 1.079 / m) * m * m / sum;
+                /* Linear counting is more accurate on small cardinalities */
+                if (estimate <= 2.5 * m && zeros != 0)
+                {
+                    estimate = m * std::log(m / static_cast<double>(zeros));
+                }
+                sqlite3_result_int64(context, std::llround(estimate));
+            }
+        };
+    }
+
+    void register_functions(SQLite::Database& db)
+    {
+        sqlite3* handle = db.getHandle();
+        create_window_function<median_function>(handle, "median", 1);
+        create_window_function<percentile_function>(handle, "percentile_cont", 2);
+        create_window_function<stddev_function>(handle, "stddev", 1);
+        create_window_function<var_function>(handle, "var", 1);
+        create_window_function<corr_function>(handle, "corr", 2);
+        create_window_function<histogram_function>(handle, "histogram", 2);
+        create_aggregate_function<approx_count_distinct_function>(handle, "approx_count_distinct", 1);
+    }
+}
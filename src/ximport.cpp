@@ -0,0 +1,811 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include <intrin.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "nlohmann/json.hpp"
+
+#include "xeus-sqlite/ximport.hpp"
+
+namespace nl = nlohmann;
+
+namespace xeus_sqlite
+{
+    namespace
+    {
+        constexpr std::uint64_t ones = 0x0101010101010101ULL;
+        constexpr std::uint64_t highs = 0x8080808080808080ULL;
+
+        /* Flags the bytes of word equal to the byte broadcast in pattern,
+           the lowest flag always marks the first match */
+        inline std::uint64_t match_byte(std::uint64_t word, std::uint64_t pattern) noexcept
+        {
+            std::uint64_t x = word ^ pattern;
+            return (x - ones) & ~x & highs;
+        }
+
+        inline std::size_t first_flagged_byte(std::uint64_t mask) noexcept
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            return static_cast<std::size_t>(__builtin_ctzll(mask)) / 8;
+#elif defined(_MSC_VER) && defined(_WIN64)
+            unsigned long index;
+            _BitScanForward64(&index, mask);
+            return static_cast<std::size_t>(index) / 8;
+#else
+            std::size_t index = 0;
+            while ((mask & 0x80) == 0)
+            {
+                mask >>= 8;
+                ++index;
+            }
+            return index;
+#endif
+        }
+
+        bool parse_integer(std::string_view field, std::int64_t& value) noexcept
+        {
+            const char* last = field.data() + field.size();
+            auto res = std::from_chars(field.data(), last, value);
+            return res.ec == std::errc() && res.ptr == last;
+        }
+
+        bool parse_real(std::string_view field, double& value) noexcept
+        {
+#if defined(__cpp_lib_to_chars)
+            const char* last = field.data() + field.size();
+            auto res = std::from_chars(field.data(), last, value);
+            return res.ec == std::errc() && res.ptr == last;
+#else
+            /* strtod needs a null terminated copy, long fields are text */
+            char buffer[64];
+            if (field.empty() || field.size() >= sizeof(buffer))
+            {
+                return false;
+            }
+            std::memcpy(buffer, field.data(), field.size());
+            buffer[field.size()] = '\0';
+            char* end = nullptr;
+            value = std::strtod(buffer, &end);
+            return end == buffer + field.size();
+#endif
+        }
+
+        std::string quote_identifier(const std::string& name)
+        {
+            std::string res = "\"";
+            for (char c : name)
+            {
+                res += c;
+                if (c == '"')
+                {
+                    res += '"';
+                }
+            }
+            return res + "\"";
+        }
+
+        void check(sqlite3* handle, int rc)
+        {
+            if (rc != SQLITE_OK)
+            {
+                throw SQLite::Exception(handle, rc);
+            }
+        }
+
+        using statement_ptr = std::unique_ptr<sqlite3_stmt, int (*)(sqlite3_stmt*)>;
+
+        /* Relaxes the durability of the connection for the import and
+           restores it afterwards */
+        class durability_guard
+        {
+        public:
+
+            durability_guard(SQLite::Database& db, bool relax)
+                : m_db(db)
+                , m_relaxed(relax)
+            {
+                if (m_relaxed)
+                {
+                    m_synchronous = m_db.execAndGet("PRAGMA synchronous").getInt();
+                    m_journal_mode = m_db.execAndGet("PRAGMA journal_mode").getString();
+                    m_db.tryExec("PRAGMA synchronous = OFF");
+                    m_db.tryExec("PRAGMA journal_mode = MEMORY");
+                }
+            }
+
+            ~durability_guard()
+            {
+                if (m_relaxed)
+                {
+                    m_db.tryExec(("PRAGMA journal_mode = " + m_journal_mode).c_str());
+                    m_db.tryExec(("PRAGMA synchronous = " + std::to_string(m_synchronous)).c_str());
+                }
+            }
+
+        private:
+
+            SQLite::Database& m_db;
+            bool m_relaxed;
+            int m_synchronous = 2;
+            std::string m_journal_mode;
+        };
+
+        /* Commits every batch, unless the import runs in a transaction
+           opened by the user */
+        class batch_transaction
+        {
+        public:
+
+            explicit batch_transaction(SQLite::Database& db)
+                : m_db(db)
+                , m_owned(sqlite3_get_autocommit(db.getHandle()) != 0)
+            {
+                begin();
+            }
+
+            ~batch_transaction()
+            {
+                if (m_owned && m_open)
+                {
+                    m_db.tryExec("ROLLBACK");
+                }
+            }
+
+            void commit()
+            {
+                if (m_owned && m_open)
+                {
+                    m_db.exec("COMMIT");
+                    m_open = false;
+                }
+            }
+
+            void next_batch()
+            {
+                commit();
+                begin();
+            }
+
+        private:
+
+            void begin()
+            {
+                if (m_owned)
+                {
+                    m_db.exec("BEGIN");
+                    m_open = true;
+                }
+            }
+
+            SQLite::Database& m_db;
+            bool m_owned;
+            bool m_open = false;
+        };
+
+        enum class column_kind
+        {
+            integer,
+            real,
+            text
+        };
+
+        column_kind kind_of(const std::string& type) noexcept
+        {
+            return type == "INTEGER" ? column_kind::integer
+                 : type == "REAL" ? column_kind::real : column_kind::text;
+        }
+
+        void bind_field(sqlite3_stmt* statement, int index,
+                        std::string_view field, column_kind kind)
+        {
+            if (kind != column_kind::text)
+            {
+                std::int64_t integer;
+                double real;
+                if (field.empty())
+                {
+                    sqlite3_bind_null(statement, index);
+                    return;
+                }
+                else if (kind == column_kind::integer && parse_integer(field, integer))
+                {
+                    sqlite3_bind_int64(statement, index, integer);
+                    return;
+                }
+                else if (parse_real(field, real))
+                {
+                    sqlite3_bind_double(statement, index, real);
+                    return;
+                }
+            }
+            sqlite3_bind_text(statement, index, field.data(),
+                              static_cast<int>(field.size()), SQLITE_STATIC);
+        }
+
+        void bind_json(sqlite3_stmt* statement, int index, const nl::json& value)
+        {
+            switch (value.type())
+            {
+                case nl::json::value_t::number_integer:
+                case nl::json::value_t::number_unsigned:
+                    sqlite3_bind_int64(statement, index, value.get<std::int64_t>());
+                    break;
+                case nl::json::value_t::number_float:
+                    sqlite3_bind_double(statement, index, value.get<double>());
+                    break;
+                case nl::json::value_t::boolean:
+                    sqlite3_bind_int(statement, index, value.get<bool>() ? 1 : 0);
+                    break;
+                case nl::json::value_t::string:
+                {
+                    const std::string& text = value.get_ref<const std::string&>();
+                    sqlite3_bind_text(statement, index, text.data(),
+                                      static_cast<int>(text.size()), SQLITE_TRANSIENT);
+                    break;
+                }
+                case nl::json::value_t::null:
+                case nl::json::value_t::discarded:
+                    sqlite3_bind_null(statement, index);
+                    break;
+                default:
+                {
+                    std::string text = value.dump();
+                    sqlite3_bind_text(statement, index, text.data(),
+                                      static_cast<int>(text.size()), SQLITE_TRANSIENT);
+                    break;
+                }
+            }
+        }
+
+        std::string json_column_type(const std::vector<nl::json>& sample, const std::string& key)
+        {
+            std::string type;
+            for (const nl::json& record : sample)
+            {
+                auto found = record.find(key);
+                if (found == record.end() || found->is_null())
+                {
+                    continue;
+                }
+                std::string value_type = found->is_number_integer() || found->is_boolean() ? "INTEGER"
+                                       : found->is_number_float() ? "REAL" : "TEXT";
+                if (type.empty() || (type == "INTEGER" && value_type == "REAL"))
+                {
+                    type = value_type;
+                }
+                else if (type != value_type && !(type == "REAL" && value_type == "INTEGER"))
+                {
+                    return "TEXT";
+                }
+            }
+            return type.empty() ? "TEXT" : type;
+        }
+
+        bool is_blank(const std::vector<std::string_view>& fields) noexcept
+        {
+            return fields.size() == 1 && fields[0].empty();
+        }
+    }
+
+    /****************************
+     * mapped_file implementation
+     ****************************/
+
+    mapped_file::mapped_file(const std::string& path)
+    {
+#if !defined(_WIN32)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Cannot open " + path + ".");
+        }
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            void* data = ::mmap(nullptr, static_cast<std::size_t>(info.st_size),
+                                PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                m_data = static_cast<const char*>(data);
+                m_size = static_cast<std::size_t>(info.st_size);
+                m_mapped = true;
+#if defined(MADV_SEQUENTIAL)
+                ::madvise(data, m_size, MADV_SEQUENTIAL);
+#endif
+            }
+        }
+        ::close(fd);
+        if (m_mapped)
+        {
+            return;
+        }
+#endif
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Cannot open " + path + ".");
+        }
+        std::stringstream content;
+        content << file.rdbuf();
+        m_buffer = content.str();
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+    }
+
+    mapped_file::~mapped_file()
+    {
+#if !defined(_WIN32)
+        if (m_mapped)
+        {
+            ::munmap(const_cast<char*>(m_data), m_size);
+        }
+#endif
+    }
+
+    const char* mapped_file::data() const noexcept
+    {
+        return m_data;
+    }
+
+    std::size_t mapped_file::size() const noexcept
+    {
+        return m_size;
+    }
+
+    /**********************************
+     * delimited_scanner implementation
+     **********************************/
+
+    delimited_scanner::delimited_scanner(const char* data, std::size_t size, char delimiter)
+        : m_begin(data)
+        , m_end(data + size)
+        , m_it(data)
+        , m_delimiter(delimiter)
+        , m_delimiter_pattern(ones * static_cast<unsigned char>(delimiter))
+    {
+    }
+
+    const char* delimited_scanner::find_field_end(const char* it) const noexcept
+    {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ || defined(_WIN32)
+        while (m_end - it >= 8)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, it, sizeof(word));
+            std::uint64_t mask = match_byte(word, m_delimiter_pattern)
+                               | match_byte(word, ones * '\n')
+                               | match_byte(word, ones * '\r');
+            if (mask != 0)
+            {
+                return it + first_flagged_byte(mask);
+            }
+            it += 8;
+        }
+#endif
+        while (it < m_end && *it != m_delimiter && *it != '\n' && *it != '\r')
+        {
+            ++it;
+        }
+        return it;
+    }
+
+    bool delimited_scanner::next_record(std::vector<std::string_view>& fields)
+    {
+        fields.clear();
+        if (m_it >= m_end)
+        {
+            return false;
+        }
+
+        std::size_t unescaped_count = 0;
+        while (true)
+        {
+            if (m_it < m_end && *m_it == '"')
+            {
+                const char* start = ++m_it;
+                bool escaped = false;
+                const char* quote = nullptr;
+                while (true)
+                {
+                    quote = static_cast<const char*>(
+                        std::memchr(m_it, '"', static_cast<std::size_t>(m_end - m_it)));
+                    if (quote == nullptr)
+                    {
+                        throw std::runtime_error("Unterminated quoted field at line "
+                                                 + std::to_string(m_line) + ".");
+                    }
+                    if (quote + 1 < m_end && quote[1] == '"')
+                    {
+                        escaped = true;
+                        m_it = quote + 2;
+                        continue;
+                    }
+                    break;
+                }
+                m_line += static_cast<std::size_t>(std::count(start, quote, '\n'));
+                m_it = quote + 1;
+
+                if (escaped)
+                {
+                    if (unescaped_count == m_unescaped.size())
+                    {
+                        m_unescaped.emplace_back();
+                    }
+                    std::string& buffer = m_unescaped[unescaped_count++];
+                    buffer.clear();
+                    for (const char* c = start; c < quote; ++c)
+                    {
+                        buffer += *c;
+                        if (*c == '"')
+                        {
+                            ++c;
+                        }
+                    }
+                    fields.emplace_back(buffer);
+                }
+                else
+                {
+                    fields.emplace_back(start, static_cast<std::size_t>(quote - start));
+                }
+
+                if (m_it < m_end && *m_it != m_delimiter && *m_it != '\n' && *m_it != '\r')
+                {
+                    throw std::runtime_error("Unexpected character after a quoted field at line "
+                                             + std::to_string(m_line) + ".");
+                }
+            }
+            else
+            {
+                const char* end = find_field_end(m_it);
+                fields.emplace_back(m_it, static_cast<std::size_t>(end - m_it));
+                m_it = end;
+            }
+
+            if (m_it >= m_end)
+            {
+                return true;
+            }
+            if (*m_it == m_delimiter)
+            {
+                ++m_it;
+                continue;
+            }
+            if (*m_it == '\r' && m_it + 1 < m_end && m_it[1] == '\n')
+            {
+                ++m_it;
+            }
+            ++m_it;
+            ++m_line;
+            return true;
+        }
+    }
+
+    std::size_t delimited_scanner::position() const noexcept
+    {
+        return static_cast<std::size_t>(m_it - m_begin);
+    }
+
+    std::size_t delimited_scanner::line() const noexcept
+    {
+        return m_line;
+    }
+
+    /*************************
+     * import implementation
+     *************************/
+
+    import_format import_format_from(const std::string& name)
+    {
+        std::string lower = name;
+        std::transform(lower.begin(), lower.end(), lower.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        auto ends_with = [&lower](const std::string& suffix)
+        {
+            return lower.size() >= suffix.size()
+                && lower.compare(lower.size() - suffix.size(), suffix.size(), suffix) == 0;
+        };
+
+        if (ends_with("tsv") || ends_with(".tab"))
+        {
+            return import_format::tsv;
+        }
+        else if (ends_with("jsonl") || ends_with("ndjson") || ends_with("json"))
+        {
+            return import_format::jsonl;
+        }
+        return import_format::csv;
+    }
+
+    std::string infer_column_type(const std::vector<std::string_view>& sample)
+    {
+        bool integer = true;
+        bool real = true;
+        bool empty = true;
+        for (std::string_view field : sample)
+        {
+            if (field.empty())
+            {
+                continue;
+            }
+            empty = false;
+            std::int64_t integer_value;
+            double real_value;
+            integer = integer && parse_integer(field, integer_value);
+            real = real && (integer || parse_real(field, real_value));
+            if (!real)
+            {
+                return "TEXT";
+            }
+        }
+        return empty ? "TEXT" : integer ? "INTEGER" : "REAL";
+    }
+
+    import_summary import_file(SQLite::Database& db,
+                               const std::string& path,
+                               const std::string& table,
+                               const import_options& options,
+                               const import_progress& progress)
+    {
+        auto start = std::chrono::steady_clock::now();
+        import_summary summary;
+
+        mapped_file file(path);
+        const char* data = file.data();
+        std::size_t size = file.size();
+        /* Skips the UTF-8 byte order mark */
+        if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+        {
+            data += 3;
+            size -= 3;
+        }
+        summary.bytes = file.size();
+
+        char delimiter = options.format == import_format::tsv ? '\t' : ',';
+        delimited_scanner scanner(data, size, delimiter);
+        std::vector<std::string_view> fields;
+
+        /* Header and sample rows, used to infer the column types */
+        std::vector<std::vector<std::string>> sample;
+        std::vector<nl::json> json_sample;
+        const char* json_it = data;
+        const char* json_end = data + size;
+        auto next_json_line = [&json_it, json_end](std::string_view& line)
+        {
+            while (json_it < json_end)
+            {
+                const char* end = static_cast<const char*>(
+                    std::memchr(json_it, '\n', static_cast<std::size_t>(json_end - json_it)));
+                end = end == nullptr ? json_end : end;
+                line = std::string_view(json_it, static_cast<std::size_t>(end - json_it));
+                json_it = end == json_end ? end : end + 1;
+                if (line.find_first_not_of(" \t\r") != std::string_view::npos)
+                {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        if (options.format == import_format::jsonl)
+        {
+            std::string_view line;
+            while (json_sample.size() < options.sample_size && next_json_line(line))
+            {
+                json_sample.push_back(nl::json::parse(line.begin(), line.end()));
+                if (!json_sample.back().is_object())
+                {
+                    throw std::runtime_error("JSON lines must hold one object per line.");
+                }
+                for (const auto& item : json_sample.back().items())
+                {
+                    if (std::find(summary.columns.begin(), summary.columns.end(), item.key())
+                        == summary.columns.end())
+                    {
+                        summary.columns.push_back(item.key());
+                    }
+                }
+            }
+            for (const std::string& column : summary.columns)
+            {
+                summary.types.push_back(json_column_type(json_sample, column));
+            }
+        }
+        else
+        {
+            if (!scanner.next_record(fields))
+            {
+                throw std::runtime_error("The file " + path + " is empty.");
+            }
+            for (std::size_t i = 0; i < fields.size(); ++i)
+            {
+                std::string name(fields[i]);
+                summary.columns.push_back(name.empty() ? "column_" + std::to_string(i + 1) : name);
+            }
+            while (sample.size() < options.sample_size && scanner.next_record(fields))
+            {
+                if (!is_blank(fields))
+                {
+                    sample.emplace_back(fields.begin(), fields.end());
+                }
+            }
+            std::vector<std::string_view> column_sample;
+            for (std::size_t col = 0; col < summary.columns.size(); ++col)
+            {
+                column_sample.clear();
+                for (const auto& row : sample)
+                {
+                    if (col < row.size())
+                    {
+                        column_sample.emplace_back(row[col]);
+                    }
+                }
+                summary.types.push_back(infer_column_type(column_sample));
+            }
+        }
+
+        if (summary.columns.empty())
+        {
+            throw std::runtime_error("No column found in " + path + ".");
+        }
+
+        std::string column_list;
+        std::string definitions;
+        std::string parameters;
+        for (std::size_t col = 0; col < summary.columns.size(); ++col)
+        {
+            std::string separator = col == 0 ? "" : ", ";
+            column_list += separator + quote_identifier(summary.columns[col]);
+            definitions += separator + quote_identifier(summary.columns[col]) + " " + summary.types[col];
+            parameters += separator + "?";
+        }
+
+        if (!db.tableExists(table))
+        {
+            db.exec("CREATE TABLE " + quote_identifier(table) + " (" + definitions + ")");
+            summary.created_table = true;
+        }
+
+        durability_guard durability(db, options.relax_durability);
+        batch_transaction transaction(db);
+
+        sqlite3* handle = db.getHandle();
+        std::string insert = "INSERT INTO " + quote_identifier(table)
+                             + " (" + column_list + ") VALUES (" + parameters + ")";
+        sqlite3_stmt* raw_statement = nullptr;
+        check(handle, sqlite3_prepare_v2(handle, insert.c_str(), static_cast<int>(insert.size()),
+                                         &raw_statement, nullptr));
+        statement_ptr statement(raw_statement, sqlite3_finalize);
+
+        const int column_count = static_cast<int>(summary.columns.size());
+        std::vector<column_kind> kinds;
+        std::transform(summary.types.begin(), summary.types.end(),
+                       std::back_inserter(kinds), kind_of);
+        auto insert_row = [&](std::size_t line)
+        {
+            int rc = sqlite3_step(statement.get());
+            sqlite3_reset(statement.get());
+            if (rc != SQLITE_DONE)
+            {
+                throw SQLite::Exception("Failed to import line " + std::to_string(line)
+                                        + ": " + sqlite3_errmsg(handle), rc);
+            }
+            if (++summary.rows % options.batch_size == 0)
+            {
+                transaction.next_batch();
+                if (progress)
+                {
+                    std::size_t position = options.format == import_format::jsonl
+                        ? static_cast<std::size_t>(json_it - data) : scanner.position();
+                    progress(summary.rows, position, size);
+                }
+            }
+        };
+        auto bind_fields = [&](const auto& row, std::size_t line)
+        {
+            if (row.size() > summary.columns.size())
+            {
+                throw std::runtime_error("Line " + std::to_string(line) + " has "
+                                         + std::to_string(row.size()) + " fields, expected "
+                                         + std::to_string(summary.columns.size()) + ".");
+            }
+            for (int col = 0; col < column_count; ++col)
+            {
+                std::size_t index = static_cast<std::size_t>(col);
+                if (index < row.size())
+                {
+                    bind_field(statement.get(), col + 1, std::string_view(row[index]), kinds[index]);
+                }
+                else
+                {
+                    sqlite3_bind_null(statement.get(), col + 1);
+                }
+            }
+        };
+        auto bind_record = [&](const nl::json& record)
+        {
+            for (int col = 0; col < column_count; ++col)
+            {
+                auto found = record.find(summary.columns[static_cast<std::size_t>(col)]);
+                if (found == record.end())
+                {
+                    sqlite3_bind_null(statement.get(), col + 1);
+                }
+                else
+                {
+                    bind_json(statement.get(), col + 1, *found);
+                }
+            }
+        };
+
+        if (options.format == import_format::jsonl)
+        {
+            std::size_t line = 0;
+            for (const nl::json& record : json_sample)
+            {
+                bind_record(record);
+                insert_row(++line);
+            }
+            std::string_view text;
+            while (next_json_line(text))
+            {
+                nl::json record = nl::json::parse(text.begin(), text.end());
+                bind_record(record);
+                insert_row(++line);
+            }
+        }
+        else
+        {
+            std::size_t line = 1;
+            for (const auto& row : sample)
+            {
+                bind_fields(row, ++line);
+                insert_row(line);
+            }
+            while (scanner.next_record(fields))
+            {
+                if (is_blank(fields))
+                {
+                    continue;
+                }
+                bind_fields(fields, scanner.line() - 1);
+                insert_row(scanner.line() - 1);
+            }
+        }
+
+        transaction.commit();
+        if (progress)
+        {
+            progress(summary.rows, size, size);
+        }
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        summary.seconds = elapsed.count();
+        return summary;
+    }
+}
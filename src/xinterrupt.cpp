@@ -0,0 +1,105 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <array>
+#include <atomic>
+#include <stdexcept>
+
+#include "xeus-sqlite/xinterrupt.hpp"
+
+namespace xeus_sqlite
+{
+    namespace
+    {
+        /* A fixed array of atomic slots rather than a container, a signal
+           handler may neither lock nor allocate */
+        using connection_slots = std::array<std::atomic<sqlite3*>, max_registered_connections>;
+
+        connection_slots& registered_connections() noexcept
+        {
+            static connection_slots slots{};
+            return slots;
+        }
+    }
+
+    void register_connection(sqlite3* handle)
+    {
+        for (auto& slot : registered_connections())
+        {
+            sqlite3* expected = nullptr;
+            if (slot.compare_exchange_strong(expected, handle))
+            {
+                return;
+            }
+        }
+        throw std::runtime_error("Too many connections are open at once.");
+    }
+
+    void unregister_connection(sqlite3* handle) noexcept
+    {
+        for (auto& slot : registered_connections())
+        {
+            sqlite3* expected = handle;
+            if (slot.compare_exchange_strong(expected, nullptr))
+            {
+                return;
+            }
+        }
+    }
+
+    std::size_t free_connection_slots() noexcept
+    {
+        std::size_t res = 0;
+        for (auto& slot : registered_connections())
+        {
+            if (slot.load() == nullptr)
+            {
+                ++res;
+            }
+        }
+        return res;
+    }
+
+    connection_registration::connection_registration(sqlite3* handle)
+        : p_handle(handle)
+    {
+        register_connection(p_handle);
+    }
+
+    connection_registration::~connection_registration()
+    {
+        if (p_handle != nullptr)
+        {
+            unregister_connection(p_handle);
+        }
+    }
+
+    connection_registration::connection_registration(connection_registration&& rhs) noexcept
+        : p_handle(rhs.p_handle)
+    {
+        rhs.p_handle = nullptr;
+    }
+
+    void interrupt_connections() noexcept
+    {
+        for (auto& slot : registered_connections())
+        {
+            if (sqlite3* handle = slot.load())
+            {
+                sqlite3_interrupt(handle);
+            }
+        }
+    }
+
+    bool is_interrupt(const std::exception& err) noexcept
+    {
+        const auto* sqlite_error = dynamic_cast<const SQLite::Exception*>(&err);
+        return sqlite_error != nullptr && sqlite_error->getErrorCode() == SQLITE_INTERRUPT;
+    }
+}
@@ -0,0 +1,296 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <chrono>
+#include <exception>
+#include <future>
+#include <stdexcept>
+#include <utility>
+
+#include "xeus-sqlite/xinterrupt.hpp"
+#include "xeus-sqlite/xparallel.hpp"
+
+namespace xeus_sqlite
+{
+    work_stealing_pool::work_stealing_pool(std::size_t workers)
+        : m_next_queue(0)
+    {
+        if (workers == 0)
+        {
+            throw std::runtime_error("The number of threads must be positive.");
+        }
+        for (std::size_t i = 0; i < workers; ++i)
+        {
+            m_queues.push_back(std::make_unique<worker_queue>());
+        }
+        for (std::size_t i = 0; i < workers; ++i)
+        {
+            m_threads.emplace_back(&work_stealing_pool::run, this, i);
+        }
+    }
+
+    work_stealing_pool::~work_stealing_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_task_available.notify_all();
+        for (std::thread& thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    std::size_t work_stealing_pool::size() const noexcept
+    {
+        return m_queues.size();
+    }
+
+    void work_stealing_pool::submit(task_type task)
+    {
+        worker_queue& queue = *m_queues[m_next_queue++ % m_queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_unclaimed;
+        }
+        m_task_available.notify_one();
+    }
+
+    bool work_stealing_pool::pop(std::size_t worker, task_type& task)
+    {
+        {
+            worker_queue& own = *m_queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                task = std::move(own.tasks.front());
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+        for (std::size_t i = 1; i < m_queues.size(); ++i)
+        {
+            worker_queue& other = *m_queues[(worker + i) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(other.mutex);
+            if (!other.tasks.empty())
+            {
+                task = std::move(other.tasks.back());
+                other.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work_stealing_pool::run(std::size_t worker)
+    {
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_task_available.wait(lock, [this]() { return m_stop || m_unclaimed != 0; });
+                if (m_unclaimed == 0)
+                {
+                    return;
+                }
+                --m_unclaimed;
+            }
+
+            /* Tasks are queued before they are counted, so a claimed task
+               is in one of the queues even if others are popping */
+            task_type task;
+            while (!pop(worker, task))
+            {
+                std::this_thread::yield();
+            }
+            try
+            {
+                task(worker);
+            }
+            catch (...)
+            {
+                /* Tasks report their own errors */
+            }
+        }
+    }
+
+    connection_pool::connection_pool(const std::string& path, std::size_t size)
+    {
+        m_connections.reserve(size);
+        m_registrations.reserve(size);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            m_connections.push_back(std::make_unique<SQLite::Database>(path, SQLite::OPEN_READONLY));
+            m_registrations.emplace_back(m_connections.back()->getHandle());
+        }
+    }
+
+    connection_pool::~connection_pool()
+    {
+        m_registrations.clear();
+    }
+
+    std::size_t connection_pool::size() const noexcept
+    {
+        return m_connections.size();
+    }
+
+    SQLite::Database& connection_pool::at(std::size_t index)
+    {
+        return *m_connections.at(index);
+    }
+
+    void connection_pool::interrupt()
+    {
+        for (auto& connection : m_connections)
+        {
+            sqlite3_interrupt(connection->getHandle());
+        }
+    }
+
+    std::vector<std::string> split_read_statements(SQLite::Database& db, const std::string& code)
+    {
+        std::vector<std::string> statements;
+        sqlite3* handle = db.getHandle();
+        const char* tail = code.c_str();
+        const char* end = tail + code.size();
+        while (tail < end)
+        {
+            sqlite3_stmt* statement = nullptr;
+            const char* next = nullptr;
+            int rc = sqlite3_prepare_v2(handle, tail, static_cast<int>(end - tail), &statement, &next);
+            if (rc != SQLITE_OK)
+            {
+                throw SQLite::Exception(handle, rc);
+            }
+            /* Only whitespace or comments were left */
+            if (statement == nullptr)
+            {
+                break;
+            }
+            bool is_query = sqlite3_stmt_readonly(statement) != 0 && sqlite3_column_count(statement) != 0;
+            sqlite3_finalize(statement);
+            if (!is_query)
+            {
+                throw std::runtime_error("Statement " + std::to_string(statements.size() + 1)
+                                         + " doesn't only read rows, %PARALLEL runs queries only.");
+            }
+            statements.emplace_back(tail, next);
+            tail = next;
+        }
+        return statements;
+    }
+
+    parallel_summary parallel_query(connection_pool& connections,
+                                    work_stealing_pool& workers,
+                                    const std::vector<std::string>& statements,
+                                    const std::function<void(std::size_t, result_table&)>& sink)
+    {
+        using clock = std::chrono::steady_clock;
+        using milliseconds = std::chrono::duration<double, std::milli>;
+
+        if (connections.size() < workers.size())
+        {
+            throw std::runtime_error("Every worker needs a connection of its own.");
+        }
+
+        struct slot
+        {
+            result_table result;
+            std::exception_ptr error;
+            double elapsed_ms = 0.;
+            std::promise<void> done;
+        };
+        std::vector<slot> slots(statements.size());
+        std::atomic<bool> cancelled(false);
+
+        auto start = clock::now();
+        for (std::size_t i = 0; i < statements.size(); ++i)
+        {
+            workers.submit([&, i](std::size_t worker)
+            {
+                slot& current = slots[i];
+                try
+                {
+                    if (cancelled)
+                    {
+                        throw SQLite::Exception("Cancelled after an error.", SQLITE_INTERRUPT);
+                    }
+                    auto statement_start = clock::now();
+                    SQLite::Statement query(connections.at(worker), statements[i]);
+                    current.result.fill(query);
+                    current.elapsed_ms = milliseconds(clock::now() - statement_start).count();
+                }
+                catch (...)
+                {
+                    current.error = std::current_exception();
+                }
+                current.done.set_value();
+            });
+        }
+
+        /* Every task refers to slots, which must outlive them all */
+        parallel_summary summary;
+        std::exception_ptr error;
+        std::size_t failed = 0;
+        for (std::size_t i = 0; i < slots.size(); ++i)
+        {
+            slots[i].done.get_future().wait();
+            summary.query_ms += slots[i].elapsed_ms;
+            if (error != nullptr)
+            {
+                continue;
+            }
+            try
+            {
+                if (slots[i].error != nullptr)
+                {
+                    std::rethrow_exception(slots[i].error);
+                }
+                sink(i, slots[i].result);
+                /* Published results are released early */
+                slots[i].result = result_table();
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+                failed = i;
+                cancelled = true;
+                connections.interrupt();
+            }
+        }
+
+        if (error != nullptr)
+        {
+            try
+            {
+                std::rethrow_exception(error);
+            }
+            catch (const std::exception& err)
+            {
+                std::string message = "Statement " + std::to_string(failed + 1)
+                                      + " of the cell failed: " + err.what();
+                if (is_interrupt(err))
+                {
+                    throw SQLite::Exception(message, SQLITE_INTERRUPT);
+                }
+                throw std::runtime_error(message);
+            }
+        }
+
+        summary.statements = statements.size();
+        summary.elapsed_ms = milliseconds(clock::now() - start).count();
+        return summary;
+    }
+}
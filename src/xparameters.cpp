@@ -0,0 +1,327 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "xeus-sqlite/xparameters.hpp"
+#include "xeus-sqlite/xresult_table.hpp"
+
+namespace xeus_sqlite
+{
+    namespace
+    {
+        bool is_quoted(const std::string& literal, std::size_t first)
+        {
+            return literal.size() >= first + 2 && literal[first] == '\''
+                   && literal.back() == '\'';
+        }
+
+        int hex_digit(char c)
+        {
+            if (c >= '0' && c <= '9')
+            {
+                return c - '0';
+            }
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+        }
+
+        const char* kind_name(parameter_value::kind_type kind)
+        {
+            switch (kind)
+            {
+                case parameter_value::kind_type::integer: return "integer";
+                case parameter_value::kind_type::real: return "real";
+                case parameter_value::kind_type::text: return "text";
+                case parameter_value::kind_type::blob: return "blob";
+                default: return "null";
+            }
+        }
+    }
+
+    /*****************************
+     * parameter_value implementation
+     *****************************/
+
+    parameter_value parameter_value::parse(const std::string& literal)
+    {
+        parameter_value res;
+        if (literal.size() == 4
+            && std::toupper(static_cast<unsigned char>(literal[0])) == 'N'
+            && std::toupper(static_cast<unsigned char>(literal[1])) == 'U'
+            && std::toupper(static_cast<unsigned char>(literal[2])) == 'L'
+            && std::toupper(static_cast<unsigned char>(literal[3])) == 'L')
+        {
+            return res;
+        }
+
+        const char* first = literal.data();
+        const char* last = first + literal.size();
+        auto integer_res = std::from_chars(first + (literal.size() > 1 && literal[0] == '+'), last, res.integer);
+        if (!literal.empty() && integer_res.ec == std::errc() && integer_res.ptr == last)
+        {
+            res.kind = kind_type::integer;
+            return res;
+        }
+
+        /* Decimal notation only, inf, nan and hexadecimal floats are texts */
+        if (!literal.empty() && literal.find_first_not_of("0123456789+-.eE") == std::string::npos)
+        {
+            char* end = nullptr;
+            res.real = std::strtod(first, &end);
+            if (end == last)
+            {
+                res.kind = kind_type::real;
+                return res;
+            }
+            res.real = 0.;
+        }
+
+        /* X'...' with an even number of hexadecimal digits */
+        if ((literal[0] == 'x' || literal[0] == 'X') && is_quoted(literal, 1) && literal.size() % 2 == 1)
+        {
+            std::string bytes;
+            bool valid = true;
+            for (std::size_t i = 2; valid && i + 1 < literal.size(); i += 2)
+            {
+                int high = hex_digit(literal[i]);
+                int low = hex_digit(literal[i + 1]);
+                valid = high >= 0 && low >= 0;
+                bytes += static_cast<char>(high * 16 + low);
+            }
+            if (valid)
+            {
+                res.kind = kind_type::blob;
+                res.text = std::move(bytes);
+                return res;
+            }
+        }
+
+        res.kind = kind_type::text;
+        if (is_quoted(literal, 0))
+        {
+            /* '' stands for a quote */
+            for (std::size_t i = 1; i + 1 < literal.size(); ++i)
+            {
+                res.text += literal[i];
+                if (literal[i] == '\'' && literal[i + 1] == '\'')
+                {
+                    ++i;
+                }
+            }
+        }
+        else
+        {
+            res.text = literal;
+        }
+        return res;
+    }
+
+    std::string parameter_value::to_sql() const
+    {
+        switch (kind)
+        {
+            case kind_type::integer:
+                return std::to_string(integer);
+            case kind_type::real:
+            {
+                char buffer[32];
+                std::snprintf(buffer, sizeof(buffer), "%.15g", real);
+                return buffer;
+            }
+            case kind_type::text:
+            {
+                std::string res = "'";
+                for (char c : text)
+                {
+                    res += c;
+                    if (c == '\'')
+                    {
+                        res += c;
+                    }
+                }
+                return res + "'";
+            }
+            case kind_type::blob:
+            {
+                static const char digits[] = "0123456789ABCDEF";
+                std::string res = "X'";
+                for (char c : text)
+                {
+                    res += digits[static_cast<unsigned char>(c) >> 4];
+                    res += digits[static_cast<unsigned char>(c) & 0xF];
+                }
+                return res + "'";
+            }
+            default:
+                return "NULL";
+        }
+    }
+
+    /*****************************
+     * session_parameters implementation
+     *****************************/
+
+    void session_parameters::set(const std::string& name, parameter_value value)
+    {
+        m_values[name] = std::move(value);
+    }
+
+    bool session_parameters::erase(const std::string& name)
+    {
+        return m_values.erase(name) != 0;
+    }
+
+    void session_parameters::clear()
+    {
+        m_values.clear();
+    }
+
+    bool session_parameters::empty() const noexcept
+    {
+        return m_values.empty();
+    }
+
+    auto session_parameters::values() const noexcept -> const map_type&
+    {
+        return m_values;
+    }
+
+    void session_parameters::bind(SQLite::Statement& query) const
+    {
+        sqlite3_stmt* statement = query.getPreparedStatement();
+        int count = query.getBindParameterCount();
+        for (int index = 1; index <= count; ++index)
+        {
+            const parameter_value* found = find(statement, index);
+            if (found == nullptr)
+            {
+                continue;
+            }
+            const parameter_value& value = *found;
+            switch (value.kind)
+            {
+                case parameter_value::kind_type::integer:
+                    query.bind(index, static_cast<int64_t>(value.integer));
+                    break;
+                case parameter_value::kind_type::real:
+                    query.bind(index, value.real);
+                    break;
+                case parameter_value::kind_type::text:
+                    query.bind(index, value.text);
+                    break;
+                case parameter_value::kind_type::blob:
+                    query.bind(index, value.text.data(), static_cast<int>(value.text.size()));
+                    break;
+                default:
+                    query.bind(index);
+                    break;
+            }
+        }
+    }
+
+    void session_parameters::bind(sqlite3_stmt* statement) const
+    {
+        int count = sqlite3_bind_parameter_count(statement);
+        for (int index = 1; index <= count; ++index)
+        {
+            const parameter_value* found = find(statement, index);
+            if (found == nullptr)
+            {
+                continue;
+            }
+            const parameter_value& value = *found;
+            int rc = SQLITE_OK;
+            switch (value.kind)
+            {
+                case parameter_value::kind_type::integer:
+                    rc = sqlite3_bind_int64(statement, index, value.integer);
+                    break;
+                case parameter_value::kind_type::real:
+                    rc = sqlite3_bind_double(statement, index, value.real);
+                    break;
+                case parameter_value::kind_type::text:
+                    rc = sqlite3_bind_text(statement, index, value.text.data(),
+                                           static_cast<int>(value.text.size()), SQLITE_TRANSIENT);
+                    break;
+                case parameter_value::kind_type::blob:
+                    rc = sqlite3_bind_blob(statement, index, value.text.data(),
+                                           static_cast<int>(value.text.size()), SQLITE_TRANSIENT);
+                    break;
+                default:
+                    rc = sqlite3_bind_null(statement, index);
+                    break;
+            }
+            if (rc != SQLITE_OK)
+            {
+                throw SQLite::Exception(sqlite3_db_handle(statement), rc);
+            }
+        }
+    }
+
+    nl::json session_parameters::mime_bundle() const
+    {
+        std::string plain;
+        std::string html = "<table>\n<tr><th>Name</th><th>Type</th><th>Value</th></tr>\n";
+        for (const auto& item : m_values)
+        {
+            std::string sql = item.second.to_sql();
+            plain += item.first + " (" + kind_name(item.second.kind) + "): " + sql + "\n";
+            html += "<tr><td>";
+            append_escaped(item.first, html);
+            html += "</td><td>" + std::string(kind_name(item.second.kind)) + "</td><td>";
+            append_escaped(sql, html);
+            html += "</td></tr>\n";
+        }
+        html += "</table>";
+        if (m_values.empty())
+        {
+            plain = "No parameters, see %SET.";
+            html = "<p>" + plain + "</p>";
+        }
+
+        nl::json pub_data;
+        pub_data["text/plain"] = plain;
+        pub_data["text/html"] = html;
+        return pub_data;
+    }
+
+    std::string session_parameters::parameter_key(sqlite3_stmt* statement, int index)
+    {
+        const char* name = statement != nullptr ? sqlite3_bind_parameter_name(statement, index) : nullptr;
+        if (name == nullptr || name[0] == '\0')
+        {
+            return std::to_string(index);
+        }
+        /* Skips the prefix: ?, :, @ or $ */
+        return std::string(name + 1);
+    }
+
+    const parameter_value* session_parameters::find(sqlite3_stmt* statement, int index) const
+    {
+        std::string key = parameter_key(statement, index);
+        auto found = m_values.find(key);
+        if (found != m_values.end())
+        {
+            return &found->second;
+        }
+        /* Bare ? and the indexes skipped by ?NNN can't be told apart */
+        const char* name = statement != nullptr ? sqlite3_bind_parameter_name(statement, index) : nullptr;
+        if (name == nullptr)
+        {
+            return nullptr;
+        }
+        throw std::runtime_error("No value for the parameter " + std::string(name)
+                                 + ", use %SET " + key + " <value>.");
+    }
+}
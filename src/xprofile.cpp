@@ -0,0 +1,171 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cstdio>
+#include <map>
+#include <vector>
+
+#include "xeus-sqlite/xprofile.hpp"
+#include "xeus-sqlite/xresult_table.hpp"
+
+namespace xeus_sqlite
+{
+    namespace
+    {
+        std::string format_ms(double ms)
+        {
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.3f", ms);
+            return buffer;
+        }
+
+        struct plan_node
+        {
+            std::string detail;
+            std::vector<int> children;
+        };
+
+        void render_plan(const std::map<int, plan_node>& nodes, const std::vector<int>& ids,
+                         const std::string& prefix, std::string& plain, std::string& html)
+        {
+            html += "<ul>\n";
+            for (std::size_t i = 0; i < ids.size(); ++i)
+            {
+                const plan_node& node = nodes.at(ids[i]);
+                bool last = i + 1 == ids.size();
+                plain += prefix + (last ? "`--" : "|--") + node.detail + "\n";
+                html += "<li>";
+                append_escaped(node.detail, html);
+                if (!node.children.empty())
+                {
+                    html += "\n";
+                    render_plan(nodes, node.children, prefix + (last ? "   " : "|  "), plain, html);
+                }
+                html += "</li>\n";
+            }
+            html += "</ul>\n";
+        }
+    }
+
+    void statement_profile::read_counters(sqlite3_stmt* statement) noexcept
+    {
+        if (statement == nullptr)
+        {
+            return;
+        }
+        fullscan_steps = sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_FULLSCAN_STEP, 0);
+        sorts = sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_SORT, 0);
+        autoindexes = sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_AUTOINDEX, 0);
+        vm_steps = sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_VM_STEP, 0);
+        reprepares = sqlite3_stmt_status(statement, SQLITE_STMTSTATUS_REPREPARE, 0);
+    }
+
+    nl::json statement_profile::to_json() const
+    {
+        nl::json res;
+        res["prepare_ms"] = prepare_ms;
+        res["step_ms"] = step_ms;
+        res["render_ms"] = render_ms;
+        res["cached_statement"] = cached;
+        res["rows"] = rows;
+        res["bytes_published"] = bytes_published;
+        res["fullscan_steps"] = fullscan_steps;
+        res["sorts"] = sorts;
+        res["autoindexes"] = autoindexes;
+        res["vm_steps"] = vm_steps;
+        res["reprepares"] = reprepares;
+        return res;
+    }
+
+    nl::json statement_profile::mime_bundle() const
+    {
+        const std::vector<std::pair<std::string, std::string>> lines =
+        {
+            {"Prepare (ms)", format_ms(prepare_ms) + (cached ? " (cached)" : "")},
+            {"Step (ms)", format_ms(step_ms)},
+            {"Render (ms)", format_ms(render_ms)},
+            {"Rows", std::to_string(rows)},
+            {"Bytes published", std::to_string(bytes_published)},
+            {"Full scan steps", std::to_string(fullscan_steps)},
+            {"Sorts", std::to_string(sorts)},
+            {"Automatic indexes", std::to_string(autoindexes)},
+            {"VM steps", std::to_string(vm_steps)},
+            {"Reprepares", std::to_string(reprepares)}
+        };
+
+        std::string plain;
+        std::string html = "<table>\n";
+        for (const auto& line : lines)
+        {
+            plain += line.first + ": " + line.second + "\n";
+            html += "<tr><th>" + line.first + "</th><td>" + line.second + "</td></tr>\n";
+        }
+        html += "</table>";
+
+        nl::json pub_data;
+        pub_data["text/plain"] = plain;
+        pub_data["text/html"] = html;
+        return pub_data;
+    }
+
+    void reset_statement_counters(sqlite3_stmt* statement) noexcept
+    {
+        if (statement == nullptr)
+        {
+            return;
+        }
+        for (int counter : {SQLITE_STMTSTATUS_FULLSCAN_STEP, SQLITE_STMTSTATUS_SORT,
+                            SQLITE_STMTSTATUS_AUTOINDEX, SQLITE_STMTSTATUS_VM_STEP})
+        {
+            sqlite3_stmt_status(statement, counter, 1);
+        }
+    }
+
+    nl::json explain_query_plan(SQLite::Database& db, const std::string& code)
+    {
+        SQLite::Statement query(db, "EXPLAIN QUERY PLAN " + code);
+
+        /* Rows are (id, parent, unused, detail), parents come first */
+        std::map<int, plan_node> nodes;
+        std::vector<int> roots;
+        while (query.executeStep())
+        {
+            int id = query.getColumn(0).getInt();
+            int parent = query.getColumn(1).getInt();
+            nodes[id].detail = query.getColumn(3).getString();
+            auto found = nodes.find(parent);
+            if (parent != 0 && found != nodes.end())
+            {
+                found->second.children.push_back(id);
+            }
+            else
+            {
+                roots.push_back(id);
+            }
+        }
+
+        std::string plain = "QUERY PLAN\n";
+        std::string html = "<div><b>QUERY PLAN</b>\n";
+        render_plan(nodes, roots, "", plain, html);
+        html += "</div>";
+
+        nl::json pub_data;
+        pub_data["text/plain"] = plain;
+        pub_data["text/html"] = html;
+        return pub_data;
+    }
+
+    nl::json explain_bytecode(SQLite::Database& db, const std::string& code)
+    {
+        SQLite::Statement query(db, "EXPLAIN " + code);
+        result_table program;
+        program.fill(query);
+        return program.mime_bundle();
+    }
+}
@@ -0,0 +1,121 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include "xeus-sqlite/xprogress.hpp"
+
+namespace xeus_sqlite
+{
+    nl::json query_progress::mime_bundle() const
+    {
+        char seconds[32];
+        std::snprintf(seconds, sizeof(seconds), "%.1f s", elapsed_ms / 1000.);
+        std::string text = std::string(stopped ? "Stopped: " : done ? "Done: " : "Running: ")
+                           + std::to_string(rows) + " rows, "
+                           + std::to_string(vm_steps) + " VM steps, " + seconds;
+
+        /* Pages visited several times, e.g. by joins, may exceed the size
+           of the database */
+        std::size_t percent = 0;
+        if (database_pages != 0)
+        {
+            percent = std::min<std::size_t>(100, pages_read * 100 / database_pages);
+            text += ", ~" + std::to_string(percent) + "% of " + std::to_string(database_pages)
+                    + " pages read";
+        }
+
+        nl::json pub_data;
+        pub_data["text/plain"] = text;
+        std::string html = "<p>";
+        if (database_pages != 0)
+        {
+            html += "<progress value=\"" + std::to_string(done ? 100 : percent) + "\" max=\"100\"></progress> ";
+        }
+        pub_data["text/html"] = html + text + "</p>";
+        return pub_data;
+    }
+
+    progress_reporter::progress_reporter(SQLite::Database& db,
+                                         sqlite3_stmt* statement,
+                                         const result_table* result,
+                                         callback_type callback,
+                                         std::chrono::milliseconds interval,
+                                         std::chrono::milliseconds delay)
+        : p_handle(db.getHandle())
+        , p_statement(statement)
+        , p_result(result)
+        , m_callback(std::move(callback))
+        , m_interval(interval)
+        , m_start(clock::now())
+        , m_next(m_start + delay)
+    {
+        m_database_pages = static_cast<std::size_t>(db.execAndGet("PRAGMA page_count").getInt64());
+        m_initial_fetches = page_fetches();
+        sqlite3_progress_handler(p_handle, instructions, &progress_reporter::on_progress, this);
+    }
+
+    progress_reporter::~progress_reporter()
+    {
+        sqlite3_progress_handler(p_handle, 0, nullptr, nullptr);
+    }
+
+    std::size_t progress_reporter::reports() const noexcept
+    {
+        return m_reports;
+    }
+
+    query_progress progress_reporter::snapshot() const
+    {
+        query_progress res;
+        res.vm_steps = p_statement != nullptr
+                       ? static_cast<std::size_t>(sqlite3_stmt_status(p_statement, SQLITE_STMTSTATUS_VM_STEP, 0))
+                       : m_calls * instructions;
+        res.rows = p_result != nullptr ? p_result->rows() : 0;
+        res.pages_read = page_fetches() - m_initial_fetches;
+        res.database_pages = m_database_pages;
+        res.elapsed_ms = std::chrono::duration<double, std::milli>(clock::now() - m_start).count();
+        return res;
+    }
+
+    int progress_reporter::on_progress(void* reporter)
+    {
+        auto* self = static_cast<progress_reporter*>(reporter);
+        ++self->m_calls;
+        clock::time_point now = clock::now();
+        if (now < self->m_next)
+        {
+            return 0;
+        }
+        self->m_next = now + self->m_interval;
+
+        /* Nothing may be thrown through the frames of SQLite */
+        try
+        {
+            self->m_callback(self->snapshot());
+            ++self->m_reports;
+        }
+        catch (...)
+        {
+        }
+        return 0;
+    }
+
+    std::size_t progress_reporter::page_fetches() const noexcept
+    {
+        int hits = 0;
+        int misses = 0;
+        int highwater = 0;
+        sqlite3_db_status(p_handle, SQLITE_DBSTATUS_CACHE_HIT, &hits, &highwater, 0);
+        sqlite3_db_status(p_handle, SQLITE_DBSTATUS_CACHE_MISS, &misses, &highwater, 0);
+        return static_cast<std::size_t>(hits) + static_cast<std::size_t>(misses);
+    }
+}
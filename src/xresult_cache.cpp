@@ -0,0 +1,194 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <utility>
+
+#include "xeus-sqlite/xresult_cache.hpp"
+
+namespace xeus_sqlite
+{
+    namespace
+    {
+        /* Calls whose result depends on the time or on the connection,
+           matched on the upper case SQL text */
+        const char* const volatile_calls[] =
+        {
+            "RANDOM", "'NOW'", "CURRENT_TIME", "CURRENT_DATE", "CHANGES",
+            "LAST_INSERT_ROWID", "UNIXEPOCH", "DATE()", "TIME()", "DATETIME()",
+            "JULIANDAY()"
+        };
+
+        std::size_t bundle_bytes(const nl::json& pub_data)
+        {
+            std::size_t bytes = 0;
+            for (const auto& item : pub_data.items())
+            {
+                bytes += item.key().size();
+                bytes += item.value().is_string() ? item.value().get_ref<const std::string&>().size()
+                                                  : item.value().dump().size();
+            }
+            return bytes;
+        }
+    }
+
+    bool database_version::operator==(const database_version& rhs) const noexcept
+    {
+        return data_version == rhs.data_version
+            && total_changes == rhs.total_changes
+            && schema_version == rhs.schema_version;
+    }
+
+    bool database_version::operator!=(const database_version& rhs) const noexcept
+    {
+        return !(*this == rhs);
+    }
+
+    database_version database_version::read(SQLite::Database& db)
+    {
+        database_version version;
+        version.data_version = db.execAndGet("PRAGMA data_version").getInt64();
+        version.total_changes = sqlite3_total_changes(db.getHandle());
+        version.schema_version = db.execAndGet("PRAGMA schema_version").getInt64();
+        return version;
+    }
+
+    result_cache::result_cache(std::size_t capacity_bytes)
+        : m_capacity(capacity_bytes)
+    {
+    }
+
+    const nl::json* result_cache::find(const std::string& key, const database_version& version)
+    {
+        auto found = m_index.find(key);
+        if (found == m_index.end())
+        {
+            ++m_misses;
+            return nullptr;
+        }
+        if (found->second->version != version)
+        {
+            ++m_misses;
+            erase(found->second);
+            return nullptr;
+        }
+        ++m_hits;
+        m_entries.splice(m_entries.begin(), m_entries, found->second);
+        return &m_entries.front().pub_data;
+    }
+
+    void result_cache::insert(const std::string& key, const database_version& version, nl::json pub_data)
+    {
+        std::size_t bytes = key.size() + bundle_bytes(pub_data);
+        auto found = m_index.find(key);
+        if (found != m_index.end())
+        {
+            erase(found->second);
+        }
+        if (bytes > m_capacity)
+        {
+            return;
+        }
+        evict(m_capacity - bytes);
+        m_entries.push_front({key, version, std::move(pub_data), bytes});
+        m_index.emplace(key, m_entries.begin());
+        m_bytes += bytes;
+    }
+
+    void result_cache::set_capacity(std::size_t capacity_bytes)
+    {
+        m_capacity = capacity_bytes;
+        evict(m_capacity);
+    }
+
+    void result_cache::clear()
+    {
+        m_index.clear();
+        m_entries.clear();
+        m_bytes = 0;
+    }
+
+    bool result_cache::enabled() const noexcept
+    {
+        return m_capacity != 0;
+    }
+
+    std::size_t result_cache::size() const noexcept
+    {
+        return m_entries.size();
+    }
+
+    std::size_t result_cache::bytes() const noexcept
+    {
+        return m_bytes;
+    }
+
+    std::size_t result_cache::capacity() const noexcept
+    {
+        return m_capacity;
+    }
+
+    std::size_t result_cache::hits() const noexcept
+    {
+        return m_hits;
+    }
+
+    std::size_t result_cache::misses() const noexcept
+    {
+        return m_misses;
+    }
+
+    std::size_t result_cache::evictions() const noexcept
+    {
+        return m_evictions;
+    }
+
+    bool result_cache::is_cacheable(sqlite3_stmt* statement)
+    {
+        if (statement == nullptr
+            || !sqlite3_stmt_readonly(statement)
+            || sqlite3_stmt_isexplain(statement) != 0
+            || sqlite3_column_count(statement) == 0)
+        {
+            return false;
+        }
+
+        std::string sql = sqlite3_sql(statement);
+        std::transform(sql.begin(), sql.end(), sql.begin(), [](unsigned char c)
+        {
+            return static_cast<char>(std::toupper(c));
+        });
+        if (sql.compare(0, 6, "PRAGMA") == 0)
+        {
+            return false;
+        }
+        return std::none_of(std::begin(volatile_calls), std::end(volatile_calls), [&sql](const char* call)
+        {
+            return sql.find(call) != std::string::npos;
+        });
+    }
+
+    void result_cache::erase(list_type::iterator position)
+    {
+        m_bytes -= position->bytes;
+        m_index.erase(position->key);
+        m_entries.erase(position);
+    }
+
+    void result_cache::evict(std::size_t capacity_bytes)
+    {
+        while (m_bytes > capacity_bytes)
+        {
+            erase(std::prev(m_entries.end()));
+            ++m_evictions;
+        }
+    }
+}
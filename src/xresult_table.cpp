@@ -0,0 +1,709 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "xeus-sqlite/xblob.hpp"
+#include "xeus-sqlite/xresult_table.hpp"
+
+namespace xeus_sqlite
+{
+    namespace
+    {
+        void append_integer(std::int64_t value, std::string& out)
+        {
+            char buffer[24];
+            auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+            out.append(buffer, res.ptr);
+        }
+
+        /* Same output as the "%!.15g" format used by SQLite */
+        void append_real(double value, std::string& out)
+        {
+            char buffer[32];
+#if defined(__cpp_lib_to_chars)
+            auto res = std::to_chars(buffer, buffer + sizeof(buffer), value,
+                                     std::chars_format::general, 15);
+            std::string_view text(buffer, static_cast<std::size_t>(res.ptr - buffer));
+#else
+            int size = std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+            std::string_view text(buffer, static_cast<std::size_t>(size));
+#endif
+            out += text;
+            if (text.find_first_of(".eni") == std::string_view::npos)
+            {
+                out += ".0";
+            }
+        }
+
+        /* Longer blobs are previewed */
+        constexpr std::size_t blob_preview_bytes = 32;
+
+        /* Blobs are rendered as SQL literals, X'0A1B' */
+        void append_blob(std::string_view bytes, std::string& out)
+        {
+            static const char digits[] = "0123456789ABCDEF";
+            out.reserve(out.size() + 3 + 2 * bytes.size());
+            out += "X'";
+            for (char c : bytes)
+            {
+                unsigned char byte = static_cast<unsigned char>(c);
+                out += digits[byte >> 4];
+                out += digits[byte & 0xF];
+            }
+            out += '\'';
+        }
+
+        /* Code points of an UTF-8 text */
+        std::size_t display_width(std::string_view text)
+        {
+            return static_cast<std::size_t>(std::count_if(text.begin(), text.end(), [](char c)
+            {
+                return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+            }));
+        }
+
+        /* Bytes added to the rendering by a cell and by a row, besides the
+           text of the cells */
+        constexpr std::size_t cell_overhead = 10;
+        constexpr std::size_t row_overhead = 11;
+
+        /* Upper bound of the text of a cell, without formatting it */
+        std::size_t estimated_size(const result_column& column, std::size_t row)
+        {
+            switch (column.type(row))
+            {
+                case cell_type::integer:
+                case cell_type::real:
+                    return 24;
+                case cell_type::text:
+                    return column.bytes(row).size() + (column.truncated(row) ? 32 : 0);
+                case cell_type::blob:
+                    return 2 * std::min(column.bytes(row).size(), blob_preview_bytes) + 64;
+                default:
+                    return 0;
+            }
+        }
+
+        /* Stands for the omitted rows or columns in a layout */
+        constexpr std::size_t omitted = std::numeric_limits<std::size_t>::max();
+
+        std::vector<std::size_t> with_marker(const std::vector<std::size_t>& shown,
+                                             std::size_t head,
+                                             std::size_t total)
+        {
+            std::vector<std::size_t> res = shown;
+            if (shown.size() < total)
+            {
+                res.insert(res.begin() + static_cast<std::ptrdiff_t>(head), omitted);
+            }
+            return res;
+        }
+    }
+
+    void append_escaped(std::string_view text, std::string& out)
+    {
+        std::size_t begin = 0;
+        std::size_t special = text.find_first_of("&<>\"'");
+        while (special != std::string_view::npos)
+        {
+            out += text.substr(begin, special - begin);
+            switch (text[special])
+            {
+                case '&': out += "&amp;"; break;
+                case '<': out += "&lt;"; break;
+                case '>': out += "&gt;"; break;
+                case '"': out += "&quot;"; break;
+                default: out += "&#39;"; break;
+            }
+            begin = special + 1;
+            special = text.find_first_of("&<>\"'", begin);
+        }
+        out += text.substr(begin);
+    }
+
+    /**************************
+     * result_column implementation
+     **************************/
+
+    result_column::result_column(std::string name, std::size_t value_limit)
+        : m_name(std::move(name))
+        , m_value_limit(value_limit)
+    {
+    }
+
+    const std::string& result_column::name() const noexcept
+    {
+        return m_name;
+    }
+
+    std::size_t result_column::size() const noexcept
+    {
+        return m_types.size();
+    }
+
+    void result_column::reserve(std::size_t rows)
+    {
+        m_types.reserve(rows);
+        m_slots.reserve(rows);
+    }
+
+    void result_column::push_null()
+    {
+        cell_slot slot;
+        slot.integer = 0;
+        m_types.push_back(cell_type::null);
+        m_slots.push_back(slot);
+    }
+
+    void result_column::push_integer(std::int64_t value)
+    {
+        cell_slot slot;
+        slot.integer = value;
+        m_types.push_back(cell_type::integer);
+        m_slots.push_back(slot);
+    }
+
+    void result_column::push_real(double value)
+    {
+        cell_slot slot;
+        slot.real = value;
+        m_types.push_back(cell_type::real);
+        m_slots.push_back(slot);
+    }
+
+    void result_column::push_text(const char* data, std::size_t size)
+    {
+        push_bytes(cell_type::text, data, size);
+    }
+
+    void result_column::push_blob(const void* data, std::size_t size)
+    {
+        push_bytes(cell_type::blob, data, size);
+    }
+
+    void result_column::push_bytes(cell_type type, const void* data, std::size_t size)
+    {
+        if (size > m_value_limit)
+        {
+            m_full_sizes.emplace(m_types.size(), size);
+            size = m_value_limit;
+            if (type == cell_type::text)
+            {
+                /* Cut on a code point boundary */
+                const char* text = static_cast<const char*>(data);
+                while (size > 0 && (static_cast<unsigned char>(text[size]) & 0xC0) == 0x80)
+                {
+                    --size;
+                }
+            }
+        }
+        if (m_arena.size() + size > std::numeric_limits<std::uint32_t>::max())
+        {
+            throw std::runtime_error("Column " + m_name + " exceeds the 4GB result limit.");
+        }
+        cell_slot slot;
+        slot.ref.offset = static_cast<std::uint32_t>(m_arena.size());
+        slot.ref.size = static_cast<std::uint32_t>(size);
+        if (size != 0)
+        {
+            m_arena.append(static_cast<const char*>(data), size);
+        }
+        m_types.push_back(type);
+        m_slots.push_back(slot);
+    }
+
+    cell_type result_column::type(std::size_t row) const noexcept
+    {
+        return m_types[row];
+    }
+
+    std::int64_t result_column::integer(std::size_t row) const noexcept
+    {
+        return m_slots[row].integer;
+    }
+
+    double result_column::real(std::size_t row) const noexcept
+    {
+        return m_slots[row].real;
+    }
+
+    std::string_view result_column::bytes(std::size_t row) const noexcept
+    {
+        const arena_ref& ref = m_slots[row].ref;
+        return std::string_view(m_arena.data() + ref.offset, ref.size);
+    }
+
+    void result_column::append_to(std::size_t row, std::string& out) const
+    {
+        switch (m_types[row])
+        {
+            case cell_type::integer:
+                append_integer(m_slots[row].integer, out);
+                break;
+            case cell_type::real:
+                append_real(m_slots[row].real, out);
+                break;
+            case cell_type::text:
+                out += bytes(row);
+                if (truncated(row))
+                {
+                    out += "... (" + std::to_string(full_size(row)) + " bytes)";
+                }
+                break;
+            case cell_type::blob:
+            {
+                std::string_view value = bytes(row);
+                if (value.size() <= blob_preview_bytes)
+                {
+                    append_blob(value, out);
+                }
+                else
+                {
+                    append_blob(value.substr(0, blob_preview_bytes), out);
+                    out += "... (" + std::to_string(full_size(row)) + " bytes, "
+                           + detect_mime_type(value) + ")";
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    bool result_column::truncated(std::size_t row) const noexcept
+    {
+        return !m_full_sizes.empty() && m_full_sizes.count(row) != 0;
+    }
+
+    std::size_t result_column::full_size(std::size_t row) const noexcept
+    {
+        if (!m_full_sizes.empty())
+        {
+            auto found = m_full_sizes.find(row);
+            if (found != m_full_sizes.end())
+            {
+                return found->second;
+            }
+        }
+        return m_types[row] == cell_type::text || m_types[row] == cell_type::blob ? m_slots[row].ref.size : 0;
+    }
+
+    std::string result_column::to_string(std::size_t row) const
+    {
+        std::string res;
+        append_to(row, res);
+        return res;
+    }
+
+    nl::json result_column::to_json(std::size_t row) const
+    {
+        switch (m_types[row])
+        {
+            case cell_type::integer:
+                return m_slots[row].integer;
+            case cell_type::real:
+                return m_slots[row].real;
+            case cell_type::text:
+                return truncated(row) ? to_string(row) : std::string(bytes(row));
+            case cell_type::blob:
+                return to_string(row);
+            default:
+                return nullptr;
+        }
+    }
+
+    /*************************
+     * result_table implementation
+     *************************/
+
+    result_table::result_table(std::size_t value_limit)
+        : m_value_limit(value_limit)
+    {
+    }
+
+    void result_table::reset(SQLite::Statement& query)
+    {
+        m_columns.clear();
+        m_rows = 0;
+        int column_count = query.getColumnCount();
+        m_columns.reserve(static_cast<std::size_t>(column_count));
+        for (int col = 0; col < column_count; ++col)
+        {
+            m_columns.emplace_back(query.getColumnName(col), m_value_limit);
+        }
+    }
+
+    void result_table::append_row(SQLite::Statement& query)
+    {
+        for (std::size_t col = 0; col < m_columns.size(); ++col)
+        {
+            SQLite::Column cell = query.getColumn(static_cast<int>(col));
+            result_column& column = m_columns[col];
+            switch (cell.getType())
+            {
+                case SQLite::INTEGER:
+                    column.push_integer(cell.getInt64());
+                    break;
+                case SQLite::FLOAT:
+                    column.push_real(cell.getDouble());
+                    break;
+                case SQLite::TEXT:
+                {
+                    const char* text = cell.getText();
+                    column.push_text(text, static_cast<std::size_t>(cell.getBytes()));
+                    break;
+                }
+                case SQLite::BLOB:
+                    column.push_blob(cell.getBlob(), static_cast<std::size_t>(cell.getBytes()));
+                    break;
+                default:
+                    column.push_null();
+                    break;
+            }
+        }
+        ++m_rows;
+    }
+
+    std::size_t result_table::fill(SQLite::Statement& query, std::size_t max_rows)
+    {
+        reset(query);
+        while (m_rows < max_rows && query.executeStep())
+        {
+            append_row(query);
+        }
+        return m_rows;
+    }
+
+    std::size_t result_table::rows() const noexcept
+    {
+        return m_rows;
+    }
+
+    std::size_t result_table::columns() const noexcept
+    {
+        return m_columns.size();
+    }
+
+    const result_column& result_table::column(std::size_t index) const
+    {
+        return m_columns.at(index);
+    }
+
+    auto result_table::layout(const display_budget& budget) const -> display_layout
+    {
+        display_layout res;
+        std::size_t column_count = m_columns.size();
+        if (budget.columns != 0 && column_count > budget.columns)
+        {
+            res.head_columns = (budget.columns + 1) / 2;
+            for (std::size_t col = 0; col < res.head_columns; ++col)
+            {
+                res.columns.push_back(col);
+            }
+            for (std::size_t col = column_count - budget.columns / 2; col < column_count; ++col)
+            {
+                res.columns.push_back(col);
+            }
+        }
+        else
+        {
+            res.head_columns = column_count;
+            for (std::size_t col = 0; col < column_count; ++col)
+            {
+                res.columns.push_back(col);
+            }
+        }
+
+        std::size_t header_size = 32;
+        for (std::size_t col : res.columns)
+        {
+            header_size += m_columns[col].name().size() + cell_overhead;
+        }
+        auto row_size = [this, &res](std::size_t row)
+        {
+            std::size_t size = row_overhead;
+            for (std::size_t col : res.columns)
+            {
+                size += estimated_size(m_columns[col], row) + cell_overhead;
+            }
+            return size;
+        };
+
+        std::size_t head = m_rows;
+        std::size_t tail = 0;
+        if (budget.rows != 0 && m_rows > budget.rows)
+        {
+            head = (budget.rows + 1) / 2;
+            tail = budget.rows / 2;
+        }
+        std::size_t bytes = budget.bytes == 0 ? std::numeric_limits<std::size_t>::max() : budget.bytes;
+
+        /* Number of first rows fitting in head_bytes */
+        std::size_t used = header_size;
+        auto fill_head = [&](std::size_t head_bytes)
+        {
+            used = header_size;
+            std::size_t row = 0;
+            for (; row < head; ++row)
+            {
+                std::size_t size = row_size(row);
+                if (used + size > head_bytes)
+                {
+                    break;
+                }
+                used += size;
+            }
+            return row;
+        };
+
+        /* The first rows get half of the bytes when the last rows are shown,
+           also when the rows don't fit in the bytes */
+        std::size_t row = fill_head(tail == 0 ? bytes : bytes / 2);
+        if (row < head && tail == 0)
+        {
+            tail = m_rows;
+            row = fill_head(bytes / 2);
+        }
+        for (std::size_t i = 0; i < row; ++i)
+        {
+            res.rows.push_back(i);
+        }
+        res.head_rows = row;
+
+        std::size_t last = m_rows;
+        while (last > row && m_rows - last < tail)
+        {
+            std::size_t size = row_size(last - 1);
+            if (used + size > bytes)
+            {
+                break;
+            }
+            used += size;
+            --last;
+        }
+        for (std::size_t i = last; i < m_rows; ++i)
+        {
+            res.rows.push_back(i);
+        }
+        return res;
+    }
+
+    std::string result_table::omitted_summary(const display_layout& layout) const
+    {
+        std::size_t omitted_rows = m_rows - layout.rows.size();
+        std::size_t omitted_columns = m_columns.size() - layout.columns.size();
+        if (omitted_rows == 0 && omitted_columns == 0)
+        {
+            return "";
+        }
+        std::string res = std::to_string(m_rows) + " rows x " + std::to_string(m_columns.size()) + " columns";
+        if (omitted_rows != 0)
+        {
+            res += ", " + std::to_string(omitted_rows) + " rows omitted";
+        }
+        if (omitted_columns != 0)
+        {
+            res += ", " + std::to_string(omitted_columns) + " columns omitted";
+        }
+        return res;
+    }
+
+    bool result_table::exceeds(const display_budget& budget) const
+    {
+        display_layout shown = layout(budget);
+        return shown.rows.size() < m_rows || shown.columns.size() < m_columns.size();
+    }
+
+    std::string result_table::to_plain(const display_budget& budget) const
+    {
+        display_layout shown = layout(budget);
+        std::vector<std::size_t> columns = with_marker(shown.columns, shown.head_columns, m_columns.size());
+        std::vector<std::size_t> rows = with_marker(shown.rows, shown.head_rows, m_rows);
+
+        /* Texts of the header then of the cells, row after row, followed by
+           the widths of the columns */
+        std::string texts;
+        std::vector<std::size_t> ends;
+        ends.reserve((rows.size() + 1) * columns.size());
+        for (std::size_t col : columns)
+        {
+            texts += col == omitted ? std::string_view("...") : std::string_view(m_columns[col].name());
+            ends.push_back(texts.size());
+        }
+        for (std::size_t row : rows)
+        {
+            for (std::size_t col : columns)
+            {
+                std::size_t begin = texts.size();
+                if (row == omitted || col == omitted)
+                {
+                    texts += "...";
+                }
+                else
+                {
+                    m_columns[col].append_to(row, texts);
+                }
+                /* A cell stays on its line */
+                std::replace_if(texts.begin() + static_cast<std::ptrdiff_t>(begin), texts.end(), [](char c)
+                {
+                    return c == '\n' || c == '\r' || c == '\t';
+                }, ' ');
+                ends.push_back(texts.size());
+            }
+        }
+
+        std::vector<std::size_t> widths(columns.size(), 0);
+        std::size_t begin = 0;
+        for (std::size_t cell = 0; cell < ends.size(); ++cell)
+        {
+            std::size_t& width = widths[cell % columns.size()];
+            width = std::max(width, display_width(std::string_view(texts).substr(begin, ends[cell] - begin)));
+            begin = ends[cell];
+        }
+
+        std::string separator = "+";
+        for (std::size_t width : widths)
+        {
+            separator.append(width + 2, '-');
+            separator += '+';
+        }
+        separator += '\n';
+
+        std::string summary = omitted_summary(shown);
+        std::string plain;
+        plain.reserve((rows.size() + 4) * separator.size() + summary.size());
+        plain += separator;
+        begin = 0;
+        for (std::size_t cell = 0; cell < ends.size(); ++cell)
+        {
+            std::size_t col = cell % columns.size();
+            std::string_view text = std::string_view(texts).substr(begin, ends[cell] - begin);
+            plain += col == 0 ? "| " : " ";
+            plain += text;
+            plain.append(widths[col] - display_width(text), ' ');
+            plain += " |";
+            begin = ends[cell];
+            if (col + 1 == columns.size())
+            {
+                plain += '\n';
+                if (cell + 1 == columns.size())
+                {
+                    plain += separator;
+                }
+            }
+        }
+        if (!rows.empty())
+        {
+            plain += separator;
+        }
+        plain.pop_back();
+        if (!summary.empty())
+        {
+            plain += '\n';
+            plain += summary;
+        }
+        return plain;
+    }
+
+    std::string result_table::to_html(const display_budget& budget) const
+    {
+        display_layout shown = layout(budget);
+        std::vector<std::size_t> columns = with_marker(shown.columns, shown.head_columns, m_columns.size());
+        std::vector<std::size_t> rows = with_marker(shown.rows, shown.head_rows, m_rows);
+
+        std::string html_table;
+        html_table.reserve(32 + 16 * (rows.size() + 1) * (columns.size() + 1));
+
+        html_table += "<table>\n<tr>\n";
+        for (std::size_t col : columns)
+        {
+            html_table += "<th>";
+            append_escaped(col == omitted ? std::string_view("...") : std::string_view(m_columns[col].name()),
+                           html_table);
+            html_table += "</th>\n";
+        }
+        html_table += "</tr>\n";
+
+        std::string text;
+        for (std::size_t row : rows)
+        {
+            html_table += "<tr>\n";
+            for (std::size_t col : columns)
+            {
+                html_table += "<td>";
+                if (row == omitted || col == omitted)
+                {
+                    html_table += "...";
+                }
+                else
+                {
+                    const result_column& column = m_columns[col];
+                    cell_type type = column.type(row);
+                    /* Numbers need no escaping */
+                    if (type == cell_type::text || type == cell_type::blob)
+                    {
+                        text.clear();
+                        column.append_to(row, text);
+                        append_escaped(text, html_table);
+                    }
+                    else
+                    {
+                        column.append_to(row, html_table);
+                    }
+                }
+                html_table += "</td>\n";
+            }
+            html_table += "</tr>\n";
+        }
+        html_table += "</table>";
+
+        std::string summary = omitted_summary(shown);
+        if (!summary.empty())
+        {
+            html_table += "\n<p>" + summary + "</p>";
+        }
+        return html_table;
+    }
+
+    nl::json result_table::to_records() const
+    {
+        nl::json records = nl::json::array();
+        auto& rows = records.get_ref<nl::json::array_t&>();
+        rows.reserve(m_rows);
+        for (std::size_t row = 0; row < m_rows; ++row)
+        {
+            nl::json record = nl::json::object();
+            for (const result_column& column : m_columns)
+            {
+                record[column.name()] = column.to_json(row);
+            }
+            rows.push_back(std::move(record));
+        }
+        return records;
+    }
+
+    nl::json result_table::mime_bundle(const display_budget& budget, const mime_selection& mimes) const
+    {
+        nl::json pub_data = nl::json::object();
+        if (mimes.plain)
+        {
+            pub_data["text/plain"] = to_plain(budget);
+        }
+        if (mimes.html)
+        {
+            pub_data["text/html"] = to_html(budget);
+        }
+        return pub_data;
+    }
+}
@@ -0,0 +1,185 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <stdexcept>
+#include <utility>
+
+#include "xeus-sqlite/xsnapshot.hpp"
+
+namespace xeus_sqlite
+{
+    namespace
+    {
+        const char* transaction_error = "a transaction is open, run COMMIT or ROLLBACK first";
+    }
+
+    snapshotter::snapshotter(SQLite::Database& source,
+                             std::string path,
+                             std::chrono::milliseconds interval,
+                             int pages_per_step)
+        : m_source(source)
+        , m_path(std::move(path))
+        , m_interval(interval)
+        , m_pages_per_step(pages_per_step)
+    {
+        /* The file holds the state the source was loaded from */
+        m_signature = signature();
+        m_thread = std::thread(&snapshotter::run, this);
+    }
+
+    snapshotter::~snapshotter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+    }
+
+    snapshot_stats snapshotter::flush()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        std::size_t ticket = ++m_requested;
+        m_wake.notify_one();
+        m_done.wait(lock, [this, ticket]() { return m_completed >= ticket; });
+        if (!m_error.empty())
+        {
+            throw std::runtime_error("The snapshot to " + m_path + " failed: " + m_error);
+        }
+        return m_stats;
+    }
+
+    const std::string& snapshotter::path() const noexcept
+    {
+        return m_path;
+    }
+
+    void snapshotter::run()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_wake.wait_for(lock, m_interval, [this]() { return m_stop || m_requested != m_completed; });
+            std::size_t requested = m_requested;
+            bool forced = requested != m_completed;
+            bool stop = m_stop;
+
+            lock.unlock();
+            std::string error = snapshot(forced);
+            lock.lock();
+
+            if (forced)
+            {
+                m_completed = requested;
+                m_error = std::move(error);
+                m_done.notify_all();
+            }
+            if (stop)
+            {
+                return;
+            }
+        }
+    }
+
+    std::string snapshotter::snapshot(bool forced)
+    {
+        std::int64_t current = 0;
+        try
+        {
+            current = signature();
+        }
+        catch (const std::exception& err)
+        {
+            return err.what();
+        }
+        if (!forced && current == m_signature)
+        {
+            return "";
+        }
+        /* The changes of an open transaction aren't copied, a periodic
+           snapshot waits for the next interval */
+        if (in_transaction())
+        {
+            return forced ? transaction_error : "";
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        sqlite3* destination = nullptr;
+        int rc = sqlite3_open_v2(m_path.c_str(), &destination,
+                                 SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr);
+        sqlite3_backup* backup = rc == SQLITE_OK
+            ? sqlite3_backup_init(destination, "main", m_source.getHandle(), "main")
+            : nullptr;
+        if (backup == nullptr)
+        {
+            std::string error = destination != nullptr ? sqlite3_errmsg(destination)
+                                                       : sqlite3_errstr(rc);
+            sqlite3_close(destination);
+            return error;
+        }
+
+        /* Queries wait for the source mutex during a step only. Changes made
+           meanwhile through the source connection are copied by the backup,
+           it is abandoned if they start a transaction */
+        sqlite3_mutex* source_mutex = sqlite3_db_mutex(m_source.getHandle());
+        bool interrupted = false;
+        do
+        {
+            sqlite3_mutex_enter(source_mutex);
+            interrupted = in_transaction();
+            rc = interrupted ? SQLITE_DONE : sqlite3_backup_step(backup, m_pages_per_step);
+            sqlite3_mutex_leave(source_mutex);
+            if (rc == SQLITE_OK)
+            {
+                std::this_thread::yield();
+            }
+            else if (rc == SQLITE_BUSY || rc == SQLITE_LOCKED)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        while (rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED);
+
+        /* An unfinished backup rolls the file back */
+        int pages = sqlite3_backup_pagecount(backup);
+        rc = sqlite3_backup_finish(backup);
+        std::string error = rc == SQLITE_OK ? "" : sqlite3_errmsg(destination);
+        sqlite3_close(destination);
+        if (!error.empty())
+        {
+            return error;
+        }
+        if (interrupted)
+        {
+            return forced ? transaction_error : "";
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_signature = current;
+        ++m_stats.snapshots;
+        m_stats.pages = pages;
+        m_stats.elapsed_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        return "";
+    }
+
+    bool snapshotter::in_transaction()
+    {
+        return sqlite3_get_autocommit(m_source.getHandle()) == 0;
+    }
+
+    std::int64_t snapshotter::signature()
+    {
+        SQLite::Statement version(m_source, "PRAGMA schema_version");
+        version.executeStep();
+        return (version.getColumn(0).getInt64() << 32)
+               | static_cast<std::uint32_t>(sqlite3_total_changes(m_source.getHandle()));
+    }
+}
@@ -0,0 +1,183 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <cctype>
+
+#include "xeus-sqlite/xstatement_cache.hpp"
+
+namespace xeus_sqlite
+{
+    statement_cache::statement_cache(std::size_t capacity)
+        : m_capacity(capacity)
+    {
+    }
+
+    auto statement_cache::acquire(SQLite::Database& db, const std::string& code) -> statement_ptr
+    {
+        check_schema(db);
+
+        std::string key = normalize(code);
+        auto found = m_index.find(key);
+        if (found != m_index.end())
+        {
+            statement_ptr& statement = found->second->second;
+
+            /* Still stepped by someone else (e.g. a paged result), a private
+               copy is compiled instead */
+            if (statement.use_count() > 1)
+            {
+                ++m_misses;
+                return std::make_shared<SQLite::Statement>(db, key);
+            }
+
+            ++m_hits;
+            m_entries.splice(m_entries.begin(), m_entries, found->second);
+            statement->tryReset();
+            statement->clearBindings();
+            return statement;
+        }
+
+        ++m_misses;
+        statement_ptr statement = std::make_shared<SQLite::Statement>(db, key);
+        if (m_capacity == 0)
+        {
+            return statement;
+        }
+        if (m_entries.size() == m_capacity)
+        {
+            m_index.erase(m_entries.back().first);
+            m_entries.pop_back();
+            ++m_evictions;
+        }
+        m_entries.emplace_front(key, statement);
+        m_index.emplace(std::move(key), m_entries.begin());
+        return statement;
+    }
+
+    void statement_cache::clear()
+    {
+        m_index.clear();
+        m_entries.clear();
+        m_schema_query.reset();
+        m_schema_version = -1;
+    }
+
+    std::size_t statement_cache::size() const noexcept
+    {
+        return m_entries.size();
+    }
+
+    std::size_t statement_cache::capacity() const noexcept
+    {
+        return m_capacity;
+    }
+
+    std::size_t statement_cache::hits() const noexcept
+    {
+        return m_hits;
+    }
+
+    std::size_t statement_cache::misses() const noexcept
+    {
+        return m_misses;
+    }
+
+    std::size_t statement_cache::evictions() const noexcept
+    {
+        return m_evictions;
+    }
+
+    std::size_t statement_cache::invalidations() const noexcept
+    {
+        return m_invalidations;
+    }
+
+    void statement_cache::check_schema(SQLite::Database& db)
+    {
+        if (m_schema_query == nullptr)
+        {
+            m_schema_query = std::make_unique<SQLite::Statement>(db, "PRAGMA schema_version");
+        }
+        m_schema_query->tryReset();
+        m_schema_query->executeStep();
+        int schema_version = m_schema_query->getColumn(0).getInt();
+        m_schema_query->tryReset();
+
+        if (schema_version != m_schema_version)
+        {
+            if (!m_entries.empty())
+            {
+                ++m_invalidations;
+            }
+            m_index.clear();
+            m_entries.clear();
+            m_schema_version = schema_version;
+        }
+    }
+
+    std::string statement_cache::normalize(const std::string& code)
+    {
+        std::string res;
+        res.reserve(code.size());
+        bool pending_space = false;
+
+        std::size_t i = 0;
+        while (i < code.size())
+        {
+            char c = code[i];
+
+            if (std::isspace(static_cast<unsigned char>(c)))
+            {
+                pending_space = true;
+                ++i;
+            }
+            else if (c == '-' && i + 1 < code.size() && code[i + 1] == '-')
+            {
+                std::size_t end = code.find('\n', i);
+                i = end == std::string::npos ? code.size() : end;
+                pending_space = true;
+            }
+            else if (c == '/' && i + 1 < code.size() && code[i + 1] == '*')
+            {
+                std::size_t end = code.find("*/", i + 2);
+                i = end == std::string::npos ? code.size() : end + 2;
+                pending_space = true;
+            }
+            else
+            {
+                if (pending_space && !res.empty())
+                {
+                    res += ' ';
+                }
+                pending_space = false;
+
+                /* Quoted strings and identifiers are copied verbatim */
+                char closing = c == '[' ? ']' : c;
+                if (c == '\'' || c == '"' || c == '`' || c == '[')
+                {
+                    std::size_t end = code.find(closing, i + 1);
+                    end = end == std::string::npos ? code.size() : end + 1;
+                    res.append(code, i, end - i);
+                    i = end;
+                }
+                else
+                {
+                    res += c;
+                    ++i;
+                }
+            }
+        }
+
+        while (!res.empty() && (res.back() == ';' || res.back() == ' '))
+        {
+            res.pop_back();
+        }
+        return res;
+    }
+}
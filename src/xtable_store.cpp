@@ -0,0 +1,118 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+
+#include "xeus/xguid.hpp"
+
+#include "xeus-sqlite/xtable_store.hpp"
+
+namespace xeus_sqlite
+{
+    table_store::table_store(std::size_t capacity)
+        : m_capacity(capacity)
+    {
+    }
+
+    nl::json table_store::add(std::shared_ptr<const result_table> table, std::size_t page_rows)
+    {
+        nl::json entry;
+        entry["id"] = std::string(xeus::new_xguid());
+        entry["comm_target"] = comm_target;
+        entry["rows"] = table->rows();
+        entry["columns"] = nl::json::array();
+        for (std::size_t col = 0; col < table->columns(); ++col)
+        {
+            entry["columns"].push_back(table->column(col).name());
+        }
+        entry["page"] = rows(*table, 0, page_rows);
+        keep({entry["id"].get<std::string>(), std::move(table), nullptr});
+        return entry;
+    }
+
+    nl::json table_store::add_stream(std::shared_ptr<const stream_type> stream, std::size_t rows)
+    {
+        nl::json entry;
+        entry["id"] = std::string(xeus::new_xguid());
+        entry["comm_target"] = comm_target;
+        entry["rows"] = rows;
+        entry["messages"] = stream->size();
+        std::size_t bytes = 0;
+        for (const auto& message : *stream)
+        {
+            bytes += message.size();
+        }
+        entry["bytes"] = bytes;
+        keep({entry["id"].get<std::string>(), nullptr, std::move(stream)});
+        return entry;
+    }
+
+    nl::json table_store::page(const std::string& id, std::size_t offset, std::size_t count) const
+    {
+        std::shared_ptr<const result_table> table = find(id).table;
+        nl::json res;
+        if (table == nullptr)
+        {
+            res["error"] = "The result was dropped, run the cell again.";
+            return res;
+        }
+        res["offset"] = offset;
+        res["rows"] = rows(*table, offset, count);
+        return res;
+    }
+
+    auto table_store::stream(const std::string& id) const -> std::shared_ptr<const stream_type>
+    {
+        return find(id).stream;
+    }
+
+    void table_store::clear()
+    {
+        m_tables.clear();
+    }
+
+    std::size_t table_store::size() const
+    {
+        return m_tables.size();
+    }
+
+    void table_store::keep(entry_type entry)
+    {
+        m_tables.push_front(std::move(entry));
+        if (m_tables.size() > m_capacity)
+        {
+            m_tables.pop_back();
+        }
+    }
+
+    auto table_store::find(const std::string& id) const -> entry_type
+    {
+        auto found = std::find_if(m_tables.begin(), m_tables.end(), [&id](const entry_type& entry)
+        {
+            return entry.id == id;
+        });
+        return found == m_tables.end() ? entry_type() : *found;
+    }
+
+    nl::json table_store::rows(const result_table& table, std::size_t offset, std::size_t count)
+    {
+        nl::json res = nl::json::array();
+        std::size_t end = offset + std::min(count, table.rows() - std::min(offset, table.rows()));
+        for (std::size_t row = offset; row < end; ++row)
+        {
+            nl::json values = nl::json::array();
+            for (std::size_t col = 0; col < table.columns(); ++col)
+            {
+                values.push_back(table.column(col).to_json(row));
+            }
+            res.push_back(std::move(values));
+        }
+        return res;
+    }
+}
@@ -0,0 +1,137 @@
+/***************************************************************************
+* Copyright (c) 2020, QuantStack and Xeus-SQLite contributors              *
+*                                                                          *
+*                                                                          *
+* Distributed under the terms of the BSD 3-Clause License.                 *
+*                                                                          *
+* The full license is in the file LICENSE, distributed with this software. *
+****************************************************************************/
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+#include "xeus-sqlite/xtune.hpp"
+
+namespace xeus_sqlite
+{
+    namespace
+    {
+        const std::vector<tuning_profile>& tuning_profiles()
+        {
+            static const std::vector<tuning_profile> profiles =
+            {
+                {"analytics", {{"journal_mode", "WAL"},
+                               {"synchronous", "NORMAL"},
+                               {"mmap_size", "1073741824"},
+                               {"cache_size", "-262144"},
+                               {"temp_store", "MEMORY"}}},
+                {"bulkload", {{"journal_mode", "MEMORY"},
+                              {"synchronous", "OFF"},
+                              {"mmap_size", "0"},
+                              {"cache_size", "-524288"},
+                              {"temp_store", "MEMORY"}}},
+                {"safe", {{"journal_mode", "DELETE"},
+                          {"synchronous", "FULL"},
+                          {"mmap_size", "0"},
+                          {"cache_size", "-2000"},
+                          {"temp_store", "DEFAULT"}}}
+            };
+            return profiles;
+        }
+
+        std::string read_pragma(SQLite::Database& db, const std::string& name)
+        {
+            SQLite::Statement query(db, "PRAGMA " + name);
+            return query.executeStep() ? query.getColumn(0).getString() : "";
+        }
+
+        nl::json render_report(const std::string& title,
+                               const std::vector<std::vector<std::string>>& rows)
+        {
+            std::string plain = title + "\nPragma\tRequested\tValue\n";
+            std::string html = "<p>" + title + "</p>\n<table>\n<tr>\n<th>Pragma</th>\n"
+                               "<th>Requested</th>\n<th>Value</th>\n</tr>\n";
+            for (const auto& row : rows)
+            {
+                plain += row[0] + "\t" + row[1] + "\t" + row[2] + "\n";
+                html += "<tr>\n<td>" + row[0] + "</td>\n<td>" + row[1] + "</td>\n<td>"
+                        + row[2] + "</td>\n</tr>\n";
+            }
+            html += "</table>";
+
+            nl::json pub_data;
+            pub_data["text/plain"] = std::move(plain);
+            pub_data["text/html"] = std::move(html);
+            return pub_data;
+        }
+    }
+
+    std::vector<std::string> tuning_profile_names()
+    {
+        std::vector<std::string> names;
+        for (const tuning_profile& profile : tuning_profiles())
+        {
+            names.push_back(profile.name);
+        }
+        return names;
+    }
+
+    const tuning_profile& find_tuning_profile(const std::string& name)
+    {
+        std::string names;
+        for (const tuning_profile& profile : tuning_profiles())
+        {
+            bool equal = profile.name.size() == name.size()
+                && std::equal(name.begin(), name.end(), profile.name.begin(), [](char a, char b)
+                   {
+                       return std::tolower(static_cast<unsigned char>(a)) == b;
+                   });
+            if (equal)
+            {
+                return profile;
+            }
+            names += (names.empty() ? "" : ", ") + profile.name;
+        }
+        throw std::runtime_error("Unknown tuning profile " + name + ", the profiles are " + names + ".");
+    }
+
+    nl::json apply_tuning_profile(SQLite::Database& db, const tuning_profile& profile)
+    {
+        std::vector<std::vector<std::string>> rows;
+        for (const auto& pragma : profile.pragmas)
+        {
+            std::string value;
+            try
+            {
+                /* journal_mode returns the resulting mode */
+                SQLite::Statement set(db, "PRAGMA " + pragma.first + " = " + pragma.second);
+                while (set.executeStep())
+                {
+                }
+                value = read_pragma(db, pragma.first);
+            }
+            catch (const SQLite::Exception& err)
+            {
+                value = std::string("error: ") + err.what();
+            }
+            rows.push_back({pragma.first, pragma.second, value});
+        }
+        return render_report("Profile " + profile.name + " applied.", rows);
+    }
+
+    nl::json tuning_report(SQLite::Database& db)
+    {
+        std::vector<std::vector<std::string>> rows;
+        for (const auto& pragma : tuning_profiles().front().pragmas)
+        {
+            rows.push_back({pragma.first, "", read_pragma(db, pragma.first)});
+        }
+        std::string names;
+        for (const std::string& name : tuning_profile_names())
+        {
+            names += (names.empty() ? "" : ", ") + name;
+        }
+        return render_report("Current settings, the profiles are " + names + ".", rows);
+    }
+}
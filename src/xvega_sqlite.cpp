@@ -9,10 +9,16 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <sstream>
 #include <vector>
 #include <iterator>
 #include <map>
 
+#include "xeus-sqlite/xdataframe.hpp"
+#include "xeus-sqlite/xstatement_cache.hpp"
 #include "xeus-sqlite/xvega_sqlite.hpp"
 #include "xvega-bindings/xvega_bindings.hpp"
 
@@ -20,6 +26,136 @@ namespace nl = nlohmann;
 
 namespace xeus_sqlite
 {
+    namespace
+    {
+        std::string quote_identifier(const std::string& name)
+        {
+            std::string res = "\"";
+            for (char c : name)
+            {
+                res += c;
+                if (c == '"')
+                {
+                    res += '"';
+                }
+            }
+            return res + "\"";
+        }
+
+        std::string sql_number(double value)
+        {
+            std::ostringstream stream;
+            stream.precision(17);
+            stream << value;
+            return stream.str();
+        }
+
+        std::string upper(std::string text)
+        {
+            std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c)
+            {
+                return static_cast<char>(std::toupper(c));
+            });
+            return text;
+        }
+
+        /* SQLite expression of a Vega-Lite aggregate of field, "" if it has
+           none. median, var and stddev are the functions of xfunctions */
+        std::string sql_aggregate(const std::string& op, const std::string& field)
+        {
+            static const std::map<std::string, std::string> functions =
+            {
+                {"SUM", "sum"}, {"MEAN", "avg"}, {"AVERAGE", "avg"}, {"MIN", "min"},
+                {"MAX", "max"}, {"MEDIAN", "median"}, {"VARIANCE", "var"}, {"STDEV", "stddev"},
+                {"VALID", "count"}
+            };
+            if (op == "COUNT")
+            {
+                return "count(*)";
+            }
+            if (field.empty())
+            {
+                return "";
+            }
+            if (op == "DISTINCT")
+            {
+                return "count(DISTINCT " + field + ")";
+            }
+            auto found = functions.find(op);
+            return found == functions.end() ? "" : found->second + "(" + field + ")";
+        }
+
+        bool is_line_mark(const std::string& mark)
+        {
+            return mark == "LINE" || mark == "AREA" || mark == "TRAIL";
+        }
+
+        /* Name of the aggregated column, the field itself unless it is also
+           the x field */
+        std::string value_field(const xv_sqlite::chart_encoding& encoding)
+        {
+            if (!encoding.y_field.empty() && encoding.y_field != encoding.x_field)
+            {
+                return encoding.y_field;
+            }
+            std::string op = encoding.y_aggregate;
+            std::transform(op.begin(), op.end(), op.begin(), [](unsigned char c)
+            {
+                return static_cast<char>(std::tolower(c));
+            });
+            return encoding.x_field + "_" + op;
+        }
+
+        /* Reservoir sampling with Li's algorithm L: the rows replacing a
+           sample are drawn as skips, the others are only stepped. The
+           replacing rows are appended to the dataframe and the reservoir
+           holds the indices of the rows kept */
+        nl::json sample_rows(SQLite::Statement& query, std::size_t budget)
+        {
+            dataframe frame;
+            frame.fill(query, budget);
+            std::vector<std::size_t> reservoir(frame.rows());
+            for (std::size_t row = 0; row < reservoir.size(); ++row)
+            {
+                reservoir[row] = row;
+            }
+
+            if (reservoir.size() == budget)
+            {
+                /* Seeded, so that a cell run again draws the same points */
+                std::mt19937_64 generator(budget);
+                std::uniform_real_distribution<double> unit(0., 1.);
+                std::uniform_int_distribution<std::size_t> slot(0, budget - 1);
+                auto draw = [&]() { return 1. - unit(generator); };
+                auto skip = [&](double weight)
+                {
+                    double rows = std::floor(std::log(draw()) / std::log(1. - weight));
+                    return rows < 1e18 ? static_cast<std::size_t>(rows) : std::numeric_limits<std::size_t>::max() / 2;
+                };
+
+                double weight = std::exp(std::log(draw()) / static_cast<double>(budget));
+                std::size_t row = budget;
+                std::size_t next = row + skip(weight);
+                while (query.executeStep())
+                {
+                    if (row == next)
+                    {
+                        frame.append_row(query);
+                        reservoir[slot(generator)] = frame.rows() - 1;
+                        weight *= std::exp(std::log(draw()) / static_cast<double>(budget));
+                        next += skip(weight) + 1;
+                    }
+                    ++row;
+                }
+            }
+
+            /* Rows appended later were read later, the order of the query
+               is kept */
+            std::sort(reservoir.begin(), reservoir.end());
+            return frame.to_values(reservoir);
+        }
+    }
+
     std::pair<std::vector<std::string>, std::vector<std::string>> 
         xv_sqlite::split_xv_sqlite_input(std::vector<std::string> complete_input)
     {
@@ -33,4 +169,280 @@ namespace xeus_sqlite
 
         return std::make_pair(xvega_input, sqlite_input);
     }
+
+    void xv_sqlite::set_chart_values(nl::json& chart, nl::json values)
+    {
+        for (auto& spec : chart.items())
+        {
+            if (spec.key().rfind("application/vnd.vegalite", 0) == 0 && spec.value().is_object())
+            {
+                spec.value()["data"]["values"] = values;
+            }
+        }
+    }
+
+    auto xv_sqlite::parse_encoding(const std::vector<std::string>& xvega_input) -> chart_encoding
+    {
+        chart_encoding encoding;
+        bool on_x = true;
+        for (std::size_t i = 0; i + 1 < xvega_input.size(); ++i)
+        {
+            std::string token = upper(xvega_input[i]);
+            const std::string& value = xvega_input[i + 1];
+            if (token == "X_FIELD" || token == "Y_FIELD")
+            {
+                on_x = token == "X_FIELD";
+                (on_x ? encoding.x_field : encoding.y_field) = value;
+            }
+            else if (token == "MARK")
+            {
+                encoding.mark = upper(value);
+            }
+            else if (token == "TYPE")
+            {
+                (on_x ? encoding.x_type : encoding.y_type) = upper(value);
+            }
+            else if (token == "AGGREGATE")
+            {
+                (on_x ? encoding.x_aggregate : encoding.y_aggregate) = upper(value);
+            }
+            else if (token == "BIN" && on_x)
+            {
+                encoding.x_bin = upper(value) != "FALSE";
+            }
+            else if (token == "TIME_UNIT" && on_x)
+            {
+                encoding.x_time_unit = true;
+            }
+            else if (token == "MAXBINS")
+            {
+                encoding.max_bins = std::max<std::size_t>(1, std::stoul(value));
+            }
+            else if (token == "STEP")
+            {
+                encoding.bin_step = std::stod(value);
+            }
+        }
+        return encoding;
+    }
+
+    const char* xv_sqlite::reduction_name(reduction_kind kind)
+    {
+        switch (kind)
+        {
+            case reduction_kind::group:
+                return "group";
+            case reduction_kind::bins:
+                return "bins";
+            case reduction_kind::lttb:
+                return "lttb";
+            case reduction_kind::sample:
+                return "sample";
+            default:
+                return "none";
+        }
+    }
+
+    auto xv_sqlite::plan_reduction(SQLite::Database& db,
+                                   const chart_encoding& encoding,
+                                   const std::string& sql,
+                                   std::size_t budget) -> chart_reduction
+    {
+        chart_reduction res;
+        res.query = sql;
+        if (budget == 0 || encoding.x_field.empty())
+        {
+            return res;
+        }
+
+        std::string from = " FROM (" + statement_cache::normalize(sql) + ")";
+        std::string x = quote_identifier(encoding.x_field);
+        std::string y = encoding.y_field.empty() ? "" : quote_identifier(encoding.y_field);
+        std::string fields = x + (y.empty() || y == x ? "" : ", " + y);
+        bool plain_x = !encoding.x_bin && !encoding.x_time_unit && encoding.x_aggregate.empty();
+        std::string aggregate = sql_aggregate(encoding.y_aggregate, y);
+
+        if (encoding.x_bin && encoding.x_aggregate.empty() && encoding.y_aggregate == "COUNT")
+        {
+            SQLite::Statement bounds(db, "SELECT min(" + x + "), max(" + x + ")" + from);
+            if (!bounds.executeStep() || bounds.getColumn(0).isNull())
+            {
+                return res;
+            }
+            double low = bounds.getColumn(0).getDouble();
+            double high = bounds.getColumn(1).getDouble();
+            double step = encoding.bin_step > 0. ? encoding.bin_step
+                                                 : (high - low) / static_cast<double>(encoding.max_bins);
+            step = step > 0. ? step : 1.;
+            std::size_t bins = static_cast<std::size_t>(std::max(1., std::ceil((high - low) / step)));
+
+            res.kind = reduction_kind::bins;
+            res.aggregated = true;
+            res.bin_step = step;
+            res.value_field = value_field(encoding);
+            res.bin_end_field = encoding.x_field + "_end";
+            res.query = "SELECT " + sql_number(low) + " + " + sql_number(step) + " * bin AS " + x + ", "
+                        + sql_number(low) + " + " + sql_number(step) + " * (bin + 1) AS "
+                        + quote_identifier(res.bin_end_field) + ", count(*) AS "
+                        + quote_identifier(res.value_field)
+                        + " FROM (SELECT min(CAST((" + x + " - " + sql_number(low) + ") / "
+                        + sql_number(step) + " AS INTEGER), " + std::to_string(bins - 1) + ") AS bin"
+                        + from + " WHERE " + x + " IS NOT NULL) GROUP BY bin ORDER BY bin";
+        }
+        else if (plain_x && !aggregate.empty())
+        {
+            /* Lines are downsampled afterwards, the other marks keep the
+               largest groups */
+            res.kind = is_line_mark(encoding.mark) ? reduction_kind::lttb : reduction_kind::group;
+            res.aggregated = true;
+            res.value_field = value_field(encoding);
+            res.query = "SELECT " + x + ", " + aggregate + " AS " + quote_identifier(res.value_field)
+                        + from + " GROUP BY 1"
+                        + (is_line_mark(encoding.mark) ? " ORDER BY 1"
+                                                       : " ORDER BY 2 DESC LIMIT " + std::to_string(budget));
+        }
+        else if (plain_x && encoding.mark == "BAR" && encoding.y_aggregate.empty() && !y.empty() && y != x
+                 && encoding.y_type != "NOMINAL" && encoding.y_type != "ORDINAL")
+        {
+            /* Bars of a same x are stacked, their sum is drawn */
+            res.kind = reduction_kind::group;
+            res.value_field = encoding.y_field;
+            res.query = "SELECT " + x + ", sum(" + y + ") AS " + y + from
+                        + " GROUP BY 1 ORDER BY 2 DESC LIMIT " + std::to_string(budget);
+        }
+        else if (!encoding.x_bin && encoding.x_aggregate.empty() && encoding.y_aggregate.empty())
+        {
+            res.kind = is_line_mark(encoding.mark) && !y.empty() ? reduction_kind::lttb : reduction_kind::sample;
+            res.query = "SELECT " + fields + from
+                        + (res.kind == reduction_kind::lttb ? " ORDER BY 1" : "");
+        }
+        /* Other aggregates are computed on every row by the front end */
+        return res;
+    }
+
+    nl::json xv_sqlite::chart_values(SQLite::Statement& query,
+                                     const chart_reduction& reduction,
+                                     std::size_t budget)
+    {
+        if (budget != 0 && reduction.kind == reduction_kind::sample)
+        {
+            return sample_rows(query, budget);
+        }
+
+        dataframe frame;
+        frame.fill(query);
+        if (budget == 0 || reduction.kind != reduction_kind::lttb || frame.rows() <= budget
+            || frame.columns() < 2)
+        {
+            return frame.to_values();
+        }
+
+        /* x values that aren't numbers, e.g. dates, are spaced evenly */
+        std::vector<double> x(frame.rows());
+        std::vector<double> y(frame.rows());
+        for (std::size_t row = 0; row < frame.rows(); ++row)
+        {
+            x[row] = frame.column(0).number(row, static_cast<double>(row));
+            y[row] = frame.column(1).number(row, 0.);
+        }
+        return frame.to_values(largest_triangle_buckets(x, y, budget));
+    }
+
+    void xv_sqlite::rewrite_encoding(nl::json& chart,
+                                     const chart_encoding& encoding,
+                                     const chart_reduction& reduction)
+    {
+        if (!reduction.aggregated)
+        {
+            return;
+        }
+        for (auto& spec : chart.items())
+        {
+            if (spec.key().rfind("application/vnd.vegalite", 0) != 0 || !spec.value().is_object()
+                || !spec.value().contains("encoding"))
+            {
+                continue;
+            }
+            nl::json& channels = spec.value()["encoding"];
+            nl::json& y = channels["y"];
+            y.erase("aggregate");
+            y["field"] = reduction.value_field;
+            if (reduction.kind == reduction_kind::bins)
+            {
+                channels["x"]["field"] = encoding.x_field;
+                channels["x"]["bin"] = {{"binned", true}, {"step", reduction.bin_step}};
+                channels["x2"] = {{"field", reduction.bin_end_field}};
+            }
+        }
+    }
+
+    std::vector<std::size_t> xv_sqlite::largest_triangle_buckets(const std::vector<double>& x,
+                                                                 const std::vector<double>& y,
+                                                                 std::size_t threshold)
+    {
+        std::size_t size = x.size();
+        std::vector<std::size_t> res;
+        if (threshold >= size)
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                res.push_back(i);
+            }
+            return res;
+        }
+        if (threshold < 3)
+        {
+            res.push_back(0);
+            if (threshold == 2)
+            {
+                res.push_back(size - 1);
+            }
+            return res;
+        }
+
+        res.reserve(threshold);
+        double every = static_cast<double>(size - 2) / static_cast<double>(threshold - 2);
+        std::size_t kept = 0;
+        res.push_back(kept);
+        for (std::size_t bucket = 0; bucket + 2 < threshold; ++bucket)
+        {
+            /* Average of the next bucket, the last point after the last one */
+            std::size_t next_begin = static_cast<std::size_t>(std::floor((bucket + 1) * every)) + 1;
+            std::size_t next_end = std::min(static_cast<std::size_t>(std::floor((bucket + 2) * every)) + 1, size);
+            double average_x = 0.;
+            double average_y = 0.;
+            for (std::size_t i = next_begin; i < next_end; ++i)
+            {
+                average_x += x[i];
+                average_y += y[i];
+            }
+            std::size_t next_size = std::max<std::size_t>(next_end - next_begin, 1);
+            average_x /= static_cast<double>(next_size);
+            average_y /= static_cast<double>(next_size);
+            if (next_end <= next_begin)
+            {
+                average_x = x[size - 1];
+                average_y = y[size - 1];
+            }
+
+            std::size_t begin = static_cast<std::size_t>(std::floor(bucket * every)) + 1;
+            std::size_t end = static_cast<std::size_t>(std::floor((bucket + 1) * every)) + 1;
+            double max_area = -1.;
+            std::size_t max_index = begin;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                double area = std::abs((x[kept] - average_x) * (y[i] - y[kept])
+                                       - (x[kept] - x[i]) * (average_y - y[kept]));
+                if (area > max_area)
+                {
+                    max_area = area;
+                    max_index = i;
+                }
+            }
+            kept = max_index;
+            res.push_back(kept);
+        }
+        res.push_back(size - 1);
+        return res;
+    }
 }
@@ -10,14 +10,73 @@
 #ifndef TEST_DB_HPP
 #define TEST_DB_HPP
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
 #include "gtest/gtest.h"
 
+#include "xeus-sqlite/xblob.hpp"
+#include "xeus-sqlite/xdataframe.hpp"
 #include "xeus-sqlite/xeus_sqlite_interpreter.hpp"
+#include "xeus-sqlite/xfunctions.hpp"
+#include "xeus-sqlite/xinterrupt.hpp"
+#include "xeus-sqlite/xparallel.hpp"
+#include "xeus-sqlite/xparameters.hpp"
+#include "xeus-sqlite/xprofile.hpp"
+#include "xeus-sqlite/xprogress.hpp"
+#include "xeus-sqlite/xresult_cache.hpp"
+#include "xeus-sqlite/xsnapshot.hpp"
+#include "xeus-sqlite/xtable_store.hpp"
+#include "xeus-sqlite/xvega_sqlite.hpp"
 #include "xvega-bindings/utils.hpp"
 
 namespace xeus_sqlite
 {
 
+/* Runs cells the way the kernel does, keeping the published messages */
+class test_interpreter : public interpreter
+{
+public:
+
+    test_interpreter()
+    {
+        register_publisher([this](const std::string& msg_type, nl::json, nl::json content, auto&&)
+        {
+            messages.push_back({{"msg_type", msg_type}, {"content", std::move(content)}});
+        });
+    }
+
+    /* Returns the execute reply */
+    nl::json execute(const std::string& code)
+    {
+        nl::json res;
+        execute_request_impl([&res](nl::json reply) { res = std::move(reply); },
+                             1, code, xeus::execute_request_config{false, true, false},
+                             nl::json::object());
+        return res;
+    }
+
+    /* text/plain of the last execute_result */
+    std::string last_result() const
+    {
+        for (auto it = messages.rbegin(); it != messages.rend(); ++it)
+        {
+            if ((*it)["msg_type"] == "execute_result")
+            {
+                return (*it)["content"]["data"]["text/plain"].get<std::string>();
+            }
+        }
+        return "";
+    }
+
+    std::vector<nl::json> messages;
+};
+
 //TODO: move this test to xvega-bindings test dir
 TEST(xeus_sqlite_interpreter, sanitize_string_check)
 {
@@ -35,6 +94,747 @@ TEST(xeus_sqlite_interpreter, tokenizer_check)
     EXPECT_EQ(tokenized_code[1], "database.db");
 }
 
+TEST(xeus_sqlite_interpreter, result_table_check)
+{
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    SQLite::Statement query(db, "SELECT 1 AS a, 2.5 AS b, 'x' AS c, NULL AS d, x'0aff' AS e "
+                                "UNION ALL SELECT 2, 3.0, 'y', NULL, NULL");
+    result_table result;
+    EXPECT_EQ(result.fill(query), 2u);
+    EXPECT_EQ(result.columns(), 5u);
+    EXPECT_EQ(result.column(0).type(1), cell_type::integer);
+    EXPECT_EQ(result.column(1).to_string(1), "3.0");
+    EXPECT_EQ(result.column(2).bytes(0), "x");
+    EXPECT_EQ(result.column(3).type(0), cell_type::null);
+    EXPECT_EQ(result.column(4).to_string(0), "X'0AFF'");
+
+    /* Only the selected types are rendered */
+    nl::json plain_only = result.mime_bundle(display_budget(), mime_selection{true, false});
+    EXPECT_EQ(plain_only.count("text/plain"), 1u);
+    EXPECT_EQ(plain_only.count("text/html"), 0u);
+    nl::json records = result.to_records();
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0]["a"], 1);
+    EXPECT_EQ(records[0]["b"], 2.5);
+    EXPECT_EQ(records[1]["c"], "y");
+    EXPECT_TRUE(records[1]["d"].is_null());
+}
+
+TEST(xeus_sqlite_interpreter, display_budget_check)
+{
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    SQLite::Statement query(db, "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 100) "
+                                "SELECT i AS a, '<' || i || '>' AS b, i AS c FROM n");
+    auto result = std::make_shared<result_table>();
+    result->fill(query);
+
+    display_budget budget;
+    budget.rows = 4;
+    budget.columns = 2;
+    EXPECT_TRUE(result->exceeds(budget));
+    std::string html = result->to_html(budget);
+    EXPECT_NE(html.find("<td>2</td>"), std::string::npos);
+    EXPECT_EQ(html.find("<td>3</td>"), std::string::npos);
+    EXPECT_NE(html.find("<td>99</td>"), std::string::npos);
+    EXPECT_EQ(html.find("<th>b</th>"), std::string::npos);
+    EXPECT_NE(html.find("96 rows omitted, 1 columns omitted"), std::string::npos);
+    EXPECT_NE(result->to_html().find("<td>&lt;2&gt;</td>"), std::string::npos);
+    EXPECT_EQ(result->to_plain().substr(0, 24), "+-----+-------+-----+\n| ");
+
+    budget = display_budget();
+    budget.bytes = 1024;
+    EXPECT_LT(result->to_html(budget).size(), 1024u);
+    EXPECT_FALSE(result->exceeds(display_budget()));
+
+    table_store tables(1);
+    nl::json entry = tables.add(result, 2);
+    EXPECT_EQ(entry["rows"], 100);
+    EXPECT_EQ(entry["page"].size(), 2u);
+    nl::json page = tables.page(entry["id"], 98, 10);
+    ASSERT_EQ(page["rows"].size(), 2u);
+    EXPECT_EQ(page["rows"][1][1], "<100>");
+    tables.add(result, 2);
+    EXPECT_TRUE(tables.page(entry["id"], 0, 1).contains("error"));
+}
+
+TEST(xeus_sqlite_interpreter, statement_cache_check)
+{
+    EXPECT_EQ(statement_cache::normalize("  SELECT *\n  FROM t -- all\n WHERE a = 'x  y';  "),
+              "SELECT * FROM t WHERE a = 'x  y'");
+
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    statement_cache cache(1);
+    cache.acquire(db, "SELECT 1");
+    cache.acquire(db, "SELECT   1;");
+    EXPECT_EQ(cache.hits(), 1u);
+    cache.acquire(db, "SELECT 2");
+    EXPECT_EQ(cache.evictions(), 1u);
+
+    db.exec("CREATE TABLE t(a)");
+    cache.acquire(db, "SELECT 2");
+    EXPECT_EQ(cache.invalidations(), 1u);
+    EXPECT_EQ(cache.misses(), 3u);
+}
+
+TEST(xeus_sqlite_interpreter, cursor_check)
+{
+    {
+        test_interpreter interp;
+        EXPECT_EQ(interp.execute("%CREATE cursor_check.db")["status"], "ok");
+        interp.execute("CREATE TABLE t(a)");
+        interp.execute("INSERT INTO t WITH RECURSIVE c(v) AS (SELECT 1 UNION ALL SELECT v + 1 FROM c LIMIT 25) "
+                       "SELECT v FROM c");
+        interp.execute("%PAGE 10");
+
+        /* Each page replaces the display of the previous one */
+        auto page = [&interp](const std::string& code)
+        {
+            EXPECT_EQ(interp.execute(code)["status"], "ok") << code;
+            const nl::json& msg = interp.messages.back();
+            EXPECT_EQ(msg["msg_type"], code == "%NEXT" ? "update_display_data" : "display_data");
+            EXPECT_EQ(msg["content"]["transient"]["display_id"],
+                      interp.messages.front()["content"]["transient"]["display_id"]);
+            return msg["content"]["data"]["text/plain"].get<std::string>();
+        };
+        interp.messages.clear();
+        std::string rows = page("SELECT a FROM t");
+        EXPECT_NE(rows.find("| 1 "), std::string::npos);
+        EXPECT_NE(rows.find("| 10 "), std::string::npos);
+        EXPECT_EQ(rows.find("| 11 "), std::string::npos);
+        EXPECT_NE(rows.find("Rows 1 to 10, run %NEXT to fetch the next page."), std::string::npos);
+
+        rows = page("%NEXT");
+        EXPECT_EQ(rows.find("| 10 "), std::string::npos);
+        EXPECT_NE(rows.find("| 11 "), std::string::npos);
+        EXPECT_NE(rows.find("| 20 "), std::string::npos);
+        EXPECT_EQ(rows.find("| 21 "), std::string::npos);
+        EXPECT_NE(rows.find("Rows 11 to 20, run %NEXT to fetch the next page."), std::string::npos);
+
+        rows = page("%NEXT");
+        EXPECT_EQ(rows.find("| 20 "), std::string::npos);
+        EXPECT_NE(rows.find("| 21 "), std::string::npos);
+        EXPECT_NE(rows.find("| 25 "), std::string::npos);
+        EXPECT_NE(rows.find("Rows 21 to 25, end of the result."), std::string::npos);
+
+        /* The cursor is closed once the rows are exhausted */
+        EXPECT_EQ(interp.execute("%NEXT")["status"], "error");
+
+        /* A full last page is followed by an empty one */
+        interp.messages.clear();
+        rows = page("SELECT a FROM t WHERE a > 15");
+        EXPECT_NE(rows.find("| 16 "), std::string::npos);
+        EXPECT_NE(rows.find("| 25 "), std::string::npos);
+        EXPECT_NE(rows.find("Rows 1 to 10, run %NEXT to fetch the next page."), std::string::npos);
+        EXPECT_NE(page("%NEXT").find("No more rows."), std::string::npos);
+        EXPECT_EQ(interp.execute("%NEXT")["status"], "error");
+        interp.execute("%PAGE off");
+
+        /* The cached statement no longer holds the table */
+        EXPECT_EQ(interp.execute("DROP TABLE t")["status"], "ok");
+    }
+    std::remove("cursor_check.db");
+}
+
+TEST(xeus_sqlite_interpreter, load_failure_check)
+{
+    {
+        test_interpreter interp;
+        interp.execute("%CREATE load_failure_check.db");
+        interp.execute("CREATE TABLE t(a)");
+        std::size_t free_slots = free_connection_slots();
+
+        /* A directory exists but isn't a database, the current one is kept */
+        EXPECT_EQ(interp.execute("%LOAD . rw")["status"], "error");
+        EXPECT_EQ(free_connection_slots(), free_slots);
+        EXPECT_EQ(interp.execute("SELECT count(*) FROM t")["status"], "ok");
+    }
+    std::remove("load_failure_check.db");
+}
+
+TEST(xeus_sqlite_interpreter, batch_check)
+{
+    {
+        test_interpreter interp;
+        interp.execute("%CREATE batch_check.db");
+        interp.execute("CREATE TABLE t(a)");
+
+        /* Semicolons in literals and comments don't split the cell */
+        EXPECT_EQ(interp.execute("INSERT INTO t VALUES ('a;b'); -- c;d\n"
+                                 "INSERT INTO t VALUES ('e') /* ; */; SELECT a FROM t WHERE a = 'a;b'")["status"],
+                  "ok");
+        EXPECT_NE(interp.last_result().find("a;b"), std::string::npos);
+
+        /* Only the result of the last query is displayed */
+        interp.messages.clear();
+        interp.execute("SELECT 1 AS first_query; SELECT count(*) AS last_query FROM t");
+        std::size_t results = std::count_if(interp.messages.begin(), interp.messages.end(), [](const nl::json& m)
+        {
+            return m["msg_type"] == "execute_result";
+        });
+        EXPECT_EQ(results, 1u);
+        EXPECT_NE(interp.last_result().find("last_query"), std::string::npos);
+        EXPECT_EQ(interp.last_result().find("first_query"), std::string::npos);
+        EXPECT_NE(interp.last_result().find("2"), std::string::npos);
+
+        /* The report escapes the statements */
+        interp.messages.clear();
+        interp.execute("SELECT 1 WHERE 1 < 5; SELECT '<b>'");
+        std::string report = interp.messages.front()["content"]["data"]["text/html"].get<std::string>();
+        EXPECT_NE(report.find("1 &lt; 5"), std::string::npos);
+        EXPECT_EQ(report.find("<b>"), std::string::npos);
+
+        /* A failing statement rolls the whole cell back */
+        interp.execute("%TRANSACTION ON");
+        EXPECT_EQ(interp.execute("INSERT INTO t VALUES ('f'); DELETE FROM t; INSERT INTO missing VALUES (1)")["status"],
+                  "error");
+        interp.execute("SELECT count(*) AS rows_left FROM t");
+        EXPECT_NE(interp.last_result().find("| 2 "), std::string::npos);
+    }
+    std::remove("batch_check.db");
+}
+
+TEST(xeus_sqlite_interpreter, import_check)
+{
+    std::string csv = "id,name,score\r\n1,\"a, \"\"b\"\"\",2.5\n2,plain,\n";
+    delimited_scanner scanner(csv.data(), csv.size(), ',');
+    std::vector<std::string_view> fields;
+    ASSERT_TRUE(scanner.next_record(fields));
+    EXPECT_EQ(fields.size(), 3u);
+    ASSERT_TRUE(scanner.next_record(fields));
+    EXPECT_EQ(fields[1], "a, \"b\"");
+    ASSERT_TRUE(scanner.next_record(fields));
+    EXPECT_EQ(fields[2], "");
+    EXPECT_FALSE(scanner.next_record(fields));
+
+    EXPECT_EQ(infer_column_type({"1", "", "-3"}), "INTEGER");
+    EXPECT_EQ(infer_column_type({"1", "2.5e3"}), "REAL");
+    EXPECT_EQ(infer_column_type({"1", "x"}), "TEXT");
+}
+
+TEST(xeus_sqlite_interpreter, export_check)
+{
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    SQLite::Statement query(db, "SELECT 1 AS a, 0.1 AS b, 'x,\"y\"' AS c "
+                                "UNION ALL SELECT 2, NULL, NULL");
+    export_summary summary = export_query(query, "export_check.csv", export_format::csv, 1);
+    EXPECT_EQ(summary.rows, 2u);
+    EXPECT_EQ(summary.batches, 2u);
+
+    std::ifstream file("export_check.csv");
+    std::stringstream content;
+    content << file.rdbuf();
+    EXPECT_EQ(content.str(), "a,b,c\n1,0.1,\"x,\"\"y\"\"\"\n2,,\n");
+    std::remove("export_check.csv");
+
+    EXPECT_THROW(export_format_from("parquet"), std::runtime_error);
+}
+
+TEST(xeus_sqlite_interpreter, stream_query_check)
+{
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    SQLite::Statement query(db, "SELECT 1 AS a, 'x' AS b UNION ALL SELECT 2, NULL UNION ALL SELECT 3, 'z'");
+    result_table result;
+    message_buffers messages;
+    export_summary summary = stream_query(query, result, messages, 2);
+    EXPECT_EQ(result.rows(), 3u);
+    EXPECT_EQ(summary.rows, 3u);
+    EXPECT_EQ(summary.batches, 2u);
+
+    /* Schema, two record batches and the end of stream marker */
+    ASSERT_EQ(messages.size(), 4u);
+    for (const std::vector<char>& message : messages)
+    {
+        ASSERT_GE(message.size(), 8u);
+        EXPECT_EQ(message.size() % 8, 0u);
+        EXPECT_EQ(std::string(message.data(), 4), std::string(4, '\xFF'));
+    }
+    EXPECT_EQ(messages.back(), std::vector<char>({'\xFF', '\xFF', '\xFF', '\xFF', 0, 0, 0, 0}));
+}
+
+TEST(xeus_sqlite_interpreter, progress_check)
+{
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    SQLite::Statement query(db, "WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c LIMIT 200000) "
+                                "SELECT x FROM c");
+    result_table result;
+    std::vector<query_progress> reports;
+    {
+        auto report = [&reports](const query_progress& p) { reports.push_back(p); };
+        progress_reporter progress(db, query.getPreparedStatement(), &result,
+                                   report, std::chrono::milliseconds(0), std::chrono::milliseconds(0));
+        result.fill(query);
+        EXPECT_EQ(progress.reports(), reports.size());
+        EXPECT_GT(progress.snapshot().vm_steps, 0u);
+    }
+    ASSERT_FALSE(reports.empty());
+    EXPECT_LE(reports.back().rows, 200000u);
+    EXPECT_NE(reports.back().mime_bundle()["text/plain"].get<std::string>().find("Running: "), std::string::npos);
+}
+
+TEST(xeus_sqlite_interpreter, switch_check)
+{
+    test_interpreter interp;
+    for (const std::string magic : {"%PROGRESS", "%PROFILE", "%TRANSACTION", "%DISPLAY VIRTUAL"})
+    {
+        EXPECT_EQ(interp.execute(magic + " on")["status"], "ok") << magic;
+        EXPECT_EQ(interp.execute(magic + " OFF")["status"], "ok") << magic;
+        EXPECT_EQ(interp.execute(magic + " yes")["status"], "error") << magic;
+        EXPECT_EQ(interp.execute(magic)["status"], "error") << magic;
+    }
+}
+
+TEST(xeus_sqlite_interpreter, interrupt_check)
+{
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    register_connection(db.getHandle());
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread interrupter([]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        interrupt_connections();
+    });
+    try
+    {
+        db.execAndGet("WITH RECURSIVE c(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM c) "
+                      "SELECT count(*) FROM c");
+        ADD_FAILURE() << "The query wasn't interrupted";
+    }
+    catch (const std::exception& err)
+    {
+        EXPECT_TRUE(is_interrupt(err));
+    }
+    interrupter.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+
+    /* The connection is still usable */
+    EXPECT_EQ(db.execAndGet("SELECT 1").getInt(), 1);
+    unregister_connection(db.getHandle());
+}
+
+TEST(xeus_sqlite_interpreter, explain_check)
+{
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    db.exec("CREATE TABLE t(a, b)");
+    nl::json plan = explain_query_plan(db, "SELECT * FROM t WHERE a IN (SELECT b FROM t)");
+    std::string plain = plan["text/plain"];
+    EXPECT_EQ(plain.rfind("QUERY PLAN\n", 0), 0u);
+    EXPECT_NE(plain.find("`--"), std::string::npos);
+
+    SQLite::Statement query(db, "SELECT * FROM t ORDER BY b");
+    sqlite3_stmt* statement = query.getPreparedStatement();
+    ASSERT_NE(statement, nullptr);
+    query.executeStep();
+    statement_profile profile;
+    profile.read_counters(statement);
+    EXPECT_EQ(profile.sorts, 1);
+}
+
+TEST(xeus_sqlite_interpreter, catalog_check)
+{
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    db.exec("CREATE TABLE customers(id, name); CREATE TABLE orders(id, customer_id, total)");
+
+    catalog names;
+    EXPECT_TRUE(names.refresh(db));
+    EXPECT_FALSE(names.refresh(db));
+
+    std::string code = "SELECT o. FROM orders o JOIN cu";
+    catalog::completion completion = names.complete(code, code.size());
+    EXPECT_EQ(completion.cursor_start, code.size() - 2);
+    EXPECT_EQ(completion.matches, std::vector<std::string>({"customers"}));
+
+    completion = names.complete(code, 9);
+    EXPECT_EQ(completion.matches, std::vector<std::string>({"id", "customer_id", "total"}));
+
+    /* Schema changes are picked up by the next refresh */
+    db.exec("ALTER TABLE customers ADD COLUMN country");
+    EXPECT_TRUE(names.refresh(db));
+    code = "SELECT * FROM customers c WHERE c.co";
+    EXPECT_EQ(names.complete(code, code.size()).matches, std::vector<std::string>({"country"}));
+}
+
+TEST(xeus_sqlite_interpreter, blob_check)
+{
+    EXPECT_EQ(base64_encode("xeus-sqlite"), "eGV1cy1zcWxpdGU=");
+    EXPECT_EQ(detect_mime_type("\x89PNG\r\n\x1a\n"), "image/png");
+    EXPECT_EQ(detect_mime_type("caf\xc3\xa9"), "text/plain");
+
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    db.exec("CREATE TABLE t(v); INSERT INTO t VALUES (zeroblob(100000))");
+
+    SQLite::Statement query(db, "SELECT v FROM t");
+    result_table result;
+    result.fill(query);
+    EXPECT_TRUE(result.column(0).truncated(0));
+    EXPECT_EQ(result.column(0).bytes(0).size(), result_table::default_value_limit);
+    EXPECT_EQ(result.column(0).full_size(0), 100000u);
+
+    blob_reader blob(db, "t", "v", 1);
+    std::size_t bytes = 0;
+    std::size_t chunks = 0;
+    blob.stream([&](std::string_view chunk)
+    {
+        bytes += chunk.size();
+        ++chunks;
+    }, 30000);
+    EXPECT_EQ(bytes, 100000u);
+    EXPECT_EQ(chunks, 4u);
+}
+
+TEST(xeus_sqlite_interpreter, parallel_check)
+{
+    {
+        SQLite::Database db("parallel_check.db", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+        db.exec("PRAGMA journal_mode = WAL; CREATE TABLE t(a); INSERT INTO t VALUES (1), (2), (3)");
+    }
+    {
+        connection_pool connections("parallel_check.db", 2);
+        work_stealing_pool workers(2);
+        std::vector<std::string> statements = split_read_statements(
+            connections.at(0), "SELECT count(*) FROM t; SELECT sum(a) FROM t;\nSELECT max(a) FROM t");
+        ASSERT_EQ(statements.size(), 3u);
+        EXPECT_THROW(split_read_statements(connections.at(0), "SELECT 1; DELETE FROM t"), std::runtime_error);
+
+        std::vector<std::string> values;
+        parallel_summary summary = parallel_query(connections, workers, statements,
+            [&values](std::size_t, result_table& result)
+            {
+                values.push_back(result.column(0).to_string(0));
+            });
+        EXPECT_EQ(summary.statements, 3u);
+        EXPECT_EQ(values, std::vector<std::string>({"3", "6", "3"}));
+
+        /* Results before the failing statement are still sent */
+        values.clear();
+        statements.insert(statements.begin() + 1, "SELECT abs(-9223372036854775807 - 1)");
+        EXPECT_THROW(parallel_query(connections, workers, statements,
+            [&values](std::size_t, result_table& result)
+            {
+                values.push_back(result.column(0).to_string(0));
+            }), std::runtime_error);
+        EXPECT_EQ(values, std::vector<std::string>({"3"}));
+    }
+    {
+        /* A pool larger than the registry doesn't leave slots behind */
+        std::size_t free_slots = free_connection_slots();
+        EXPECT_THROW(connection_pool("parallel_check.db", max_registered_connections + 1), std::runtime_error);
+        EXPECT_EQ(free_connection_slots(), free_slots);
+        connection_pool connections("parallel_check.db", 2);
+        EXPECT_EQ(connections.at(1).execAndGet("SELECT count(*) FROM t").getInt64(), 3);
+        EXPECT_EQ(free_connection_slots(), free_slots - 2);
+    }
+    std::remove("parallel_check.db");
+    std::remove("parallel_check.db-wal");
+    std::remove("parallel_check.db-shm");
+}
+
+TEST(xeus_sqlite_interpreter, functions_check)
+{
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    register_functions(db);
+    db.exec("CREATE TABLE t(x, y); INSERT INTO t VALUES (1, 2), (2, 4), (3, 6), (4, 9), (NULL, 1)");
+
+    EXPECT_DOUBLE_EQ(db.execAndGet("SELECT median(x) FROM t").getDouble(), 2.5);
+    EXPECT_DOUBLE_EQ(db.execAndGet("SELECT percentile_cont(x, 0.25) FROM t").getDouble(), 1.75);
+    EXPECT_DOUBLE_EQ(db.execAndGet("SELECT var(x) FROM t").getDouble(), 5. / 3.);
+    EXPECT_DOUBLE_EQ(db.execAndGet("SELECT stddev(y) FROM t").getDouble(),
+                     db.execAndGet("SELECT sqrt((sum(y * y) - 1.0 * sum(y) * sum(y) / count(y)) / (count(y) - 1)) "
+                                   "FROM t").getDouble());
+    EXPECT_DOUBLE_EQ(db.execAndGet("SELECT corr(y, x) FROM t").getDouble(), 11.5 / std::sqrt(5. * 26.75));
+    EXPECT_TRUE(db.execAndGet("SELECT median(x) FROM t WHERE 0").isNull());
+    EXPECT_EQ(db.execAndGet("SELECT histogram(x, 3) FROM t").getString(),
+              "[{\"count\":1,\"hi\":2.0,\"lo\":1.0},{\"count\":1,\"hi\":3.0,\"lo\":2.0},"
+              "{\"count\":2,\"hi\":4.0,\"lo\":3.0}]");
+    EXPECT_THROW(db.execAndGet("SELECT percentile_cont(x, 2) FROM t"), SQLite::Exception);
+
+    /* Rows leaving the frame are removed from the accumulators */
+    SQLite::Statement window(db, "SELECT median(x) OVER w, var(x) OVER w FROM t WHERE x IS NOT NULL "
+                                 "WINDOW w AS (ORDER BY x ROWS BETWEEN 1 PRECEDING AND CURRENT ROW)");
+    ASSERT_TRUE(window.executeStep());
+    ASSERT_TRUE(window.executeStep());
+    ASSERT_TRUE(window.executeStep());
+    EXPECT_DOUBLE_EQ(window.getColumn(0).getDouble(), 2.5);
+    EXPECT_DOUBLE_EQ(window.getColumn(1).getDouble(), 0.5);
+
+    /* Integers and reals of equal value count once */
+    db.exec("WITH RECURSIVE s(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM s WHERE n < 20000) "
+            "INSERT INTO t SELECT n, n * 1.0 FROM s");
+    std::int64_t estimate = db.execAndGet("SELECT approx_count_distinct(y) FROM t").getInt64();
+    EXPECT_NEAR(static_cast<double>(estimate), 20001., 20001. * 0.03);
+}
+
+TEST(xeus_sqlite_interpreter, snapshot_check)
+{
+    SQLite::Database(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE)
+        .backup("snapshot_check.db", SQLite::Database::Save);
+
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE | SQLITE_OPEN_FULLMUTEX);
+    {
+        snapshotter snapshots(db, "snapshot_check.db", std::chrono::hours(1), 1);
+        db.exec("CREATE TABLE t(a); INSERT INTO t VALUES (1)");
+        EXPECT_EQ(snapshots.flush().snapshots, 1u);
+        {
+            SQLite::Database file("snapshot_check.db", SQLite::OPEN_READONLY);
+            EXPECT_EQ(file.execAndGet("SELECT count(*) FROM t").getInt(), 1);
+        }
+
+        /* The last changes are written when the snapshots stop */
+        db.exec("INSERT INTO t VALUES (2)");
+    }
+    {
+        SQLite::Database file("snapshot_check.db", SQLite::OPEN_READONLY);
+        EXPECT_EQ(file.execAndGet("SELECT count(*) FROM t").getInt(), 2);
+    }
+
+    /* The changes of an open transaction are never written */
+    {
+        snapshotter snapshots(db, "snapshot_check.db", std::chrono::milliseconds(1), 1);
+        db.exec("BEGIN; INSERT INTO t VALUES (3)");
+        EXPECT_THROW(snapshots.flush(), std::runtime_error);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        {
+            SQLite::Database file("snapshot_check.db", SQLite::OPEN_READONLY);
+            EXPECT_EQ(file.execAndGet("SELECT count(*) FROM t").getInt(), 2);
+        }
+        db.exec("COMMIT");
+        EXPECT_EQ(snapshots.flush().pages, 2);
+        db.exec("BEGIN; INSERT INTO t VALUES (4)");
+    }
+    {
+        SQLite::Database file("snapshot_check.db", SQLite::OPEN_READONLY);
+        EXPECT_EQ(file.execAndGet("SELECT count(*) FROM t").getInt(), 3);
+    }
+    db.exec("ROLLBACK");
+
+    {
+        test_interpreter interp;
+        interp.execute("%LOAD snapshot_check.db memory");
+        interp.execute("BEGIN");
+        interp.execute("INSERT INTO t VALUES (5)");
+        EXPECT_EQ(interp.execute("%SNAPSHOT")["status"], "error");
+        interp.execute("COMMIT");
+        EXPECT_EQ(interp.execute("%SNAPSHOT")["status"], "ok");
+        interp.execute("BEGIN");
+        interp.execute("INSERT INTO t VALUES (6)");
+    }
+    {
+        SQLite::Database file("snapshot_check.db", SQLite::OPEN_READONLY);
+        EXPECT_EQ(file.execAndGet("SELECT count(*) FROM t").getInt(), 4);
+    }
+    std::remove("snapshot_check.db");
+}
+
+TEST(xeus_sqlite_interpreter, tune_check)
+{
+    {
+        test_interpreter interp;
+        interp.execute("%CREATE tune_check.db");
+        EXPECT_EQ(interp.execute("%TUNE analytics")["status"], "ok");
+        interp.execute("PRAGMA journal_mode");
+        EXPECT_NE(interp.last_result().find("wal"), std::string::npos);
+        interp.execute("PRAGMA cache_size");
+        EXPECT_NE(interp.last_result().find("| -262144 "), std::string::npos);
+        interp.execute("PRAGMA mmap_size");
+        EXPECT_NE(interp.last_result().find("| 1073741824 "), std::string::npos);
+
+        /* The profile is applied to the databases loaded next */
+        EXPECT_EQ(interp.execute("%TUNE safe")["status"], "ok");
+        interp.execute("%LOAD tune_check.db rw");
+        interp.execute("PRAGMA journal_mode");
+        EXPECT_NE(interp.last_result().find("delete"), std::string::npos);
+        interp.execute("PRAGMA cache_size");
+        EXPECT_NE(interp.last_result().find("| -2000 "), std::string::npos);
+        interp.execute("PRAGMA mmap_size");
+        EXPECT_NE(interp.last_result().find("| 0 "), std::string::npos);
+
+        nl::json reply = interp.execute("%TUNE fast");
+        EXPECT_EQ(reply["status"], "error");
+        EXPECT_NE(reply["evalue"].get<std::string>().find("Unknown tuning profile"), std::string::npos);
+    }
+    std::remove("tune_check.db");
+    std::remove("tune_check.db-wal");
+    std::remove("tune_check.db-shm");
+}
+
+TEST(xeus_sqlite_interpreter, result_cache_check)
+{
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    db.exec("CREATE TABLE t(a); INSERT INTO t VALUES (1)");
+
+    result_cache cache(64);
+    database_version version = database_version::read(db);
+    cache.insert("SELECT a FROM t", version, {{"text/plain", "1"}});
+    ASSERT_NE(cache.find("SELECT a FROM t", version), nullptr);
+    EXPECT_EQ(cache.bytes(), std::string("SELECT a FROM t" "text/plain" "1").size());
+
+    /* Stale once the data changed */
+    db.exec("INSERT INTO t VALUES (2)");
+    EXPECT_EQ(cache.find("SELECT a FROM t", database_version::read(db)), nullptr);
+    EXPECT_EQ(cache.size(), 0u);
+
+    cache.insert("a", version, {{"text/plain", std::string(40, 'x')}});
+    cache.insert("b", version, {{"text/plain", std::string(40, 'x')}});
+    EXPECT_EQ(cache.evictions(), 1u);
+    EXPECT_EQ(cache.find("a", version), nullptr);
+    EXPECT_EQ(cache.hits(), 1u);
+
+    SQLite::Statement read(db, "SELECT a FROM t");
+    SQLite::Statement now(db, "SELECT datetime('now')");
+    SQLite::Statement write(db, "DELETE FROM t");
+    EXPECT_TRUE(result_cache::is_cacheable(read.getPreparedStatement()));
+    EXPECT_FALSE(result_cache::is_cacheable(now.getPreparedStatement()));
+    EXPECT_FALSE(result_cache::is_cacheable(write.getPreparedStatement()));
+}
+
+TEST(xeus_sqlite_interpreter, display_cache_check)
+{
+    {
+        test_interpreter interp;
+        interp.execute("%CREATE display_cache_check.db");
+        interp.execute("%RESULT_CACHE 8");
+        interp.execute("CREATE TABLE t(a)");
+        interp.execute("INSERT INTO t WITH RECURSIVE c(v) AS (SELECT 1 UNION ALL SELECT v + 1 FROM c LIMIT 10) "
+                       "SELECT v FROM c");
+        interp.execute("SELECT a FROM t");
+        EXPECT_EQ(interp.last_result().find("rows omitted"), std::string::npos);
+
+        /* The result is rendered again within the new budget */
+        interp.execute("%DISPLAY 3");
+        interp.execute("SELECT a FROM t");
+        EXPECT_NE(interp.last_result().find("7 rows omitted"), std::string::npos);
+        EXPECT_FALSE(interp.messages.back()["content"]["metadata"].contains("cached"));
+
+        /* Only the selected MIME types are published */
+        EXPECT_EQ(interp.execute("%DISPLAY MIME plain")["status"], "ok");
+        interp.execute("SELECT a FROM t");
+        EXPECT_TRUE(interp.messages.back()["content"]["data"].contains("text/plain"));
+        EXPECT_FALSE(interp.messages.back()["content"]["data"].contains("text/html"));
+        EXPECT_EQ(interp.execute("%DISPLAY MIME xml")["status"], "error");
+    }
+    std::remove("display_cache_check.db");
+}
+
+TEST(xeus_sqlite_interpreter, dataframe_check)
+{
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    SQLite::Statement query(db, "SELECT 1 AS i, 1 AS r, 'a' AS t, NULL AS n "
+                                "UNION ALL SELECT NULL, 2.5, 'b', NULL "
+                                "UNION ALL SELECT 3, 4, 'a', x'00'");
+    dataframe frame;
+    EXPECT_EQ(frame.fill(query), 3u);
+    EXPECT_EQ(frame.column(0).kind(), column_kind::integer);
+    EXPECT_TRUE(frame.column(0).is_null(1));
+    EXPECT_EQ(frame.column(0).null_count(), 1u);
+    EXPECT_EQ(frame.column(1).kind(), column_kind::real);
+    EXPECT_EQ(frame.column(1).real(0), 1.);
+    EXPECT_EQ(frame.column(2).kind(), column_kind::text);
+    EXPECT_EQ(frame.column(2).dictionary().size(), 2u);
+    EXPECT_EQ(frame.column(3).null_count(), 3u);
+
+    /* Numbers are written as numbers, there is no header row */
+    nl::json values = frame.to_values();
+    ASSERT_EQ(values.size(), 3u);
+    EXPECT_EQ(values[0]["i"], 1);
+    EXPECT_TRUE(values[1]["i"].is_null());
+    EXPECT_EQ(values[1]["r"], 2.5);
+    EXPECT_EQ(values[2]["t"], "a");
+    EXPECT_EQ(frame.to_values({2, 0}).dump(), "[" + values[2].dump() + "," + values[0].dump() + "]");
+}
+
+TEST(xeus_sqlite_interpreter, xvega_reduction_check)
+{
+    std::vector<double> x, y;
+    for (int i = 0; i < 100; ++i)
+    {
+        x.push_back(i);
+        y.push_back(i == 50 ? 100. : 0.);
+    }
+    std::vector<std::size_t> kept = xv_sqlite::largest_triangle_buckets(x, y, 10);
+    ASSERT_EQ(kept.size(), 10u);
+    EXPECT_EQ(kept.front(), 0u);
+    EXPECT_EQ(kept.back(), 99u);
+    EXPECT_NE(std::find(kept.begin(), kept.end(), 50u), kept.end());
+
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    db.exec("CREATE TABLE t(g, v);"
+            "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 1000)"
+            "INSERT INTO t SELECT 'g' || (i % 4), i FROM n");
+
+    /* Aggregates are computed by SQLite, one row per group */
+    auto bars = xv_sqlite::parse_encoding({"X_FIELD", "g", "Y_FIELD", "v", "AGGREGATE", "mean", "MARK", "bar"});
+    EXPECT_EQ(bars.y_aggregate, "MEAN");
+    auto grouped = xv_sqlite::plan_reduction(db, bars, "SELECT * FROM t", 100);
+    EXPECT_EQ(grouped.kind, xv_sqlite::reduction_kind::group);
+    EXPECT_TRUE(grouped.aggregated);
+    SQLite::Statement group_query(db, grouped.query);
+    EXPECT_EQ(xv_sqlite::chart_values(group_query, grouped, 100).size(), 4u);
+
+    /* Points are sampled within the budget */
+    auto points = xv_sqlite::parse_encoding({"X_FIELD", "g", "Y_FIELD", "v", "MARK", "point"});
+    auto sampled = xv_sqlite::plan_reduction(db, points, "SELECT * FROM t", 100);
+    EXPECT_EQ(sampled.kind, xv_sqlite::reduction_kind::sample);
+    SQLite::Statement sample_query(db, sampled.query);
+    EXPECT_EQ(xv_sqlite::chart_values(sample_query, sampled, 100).size(), 100u);
+}
+
+TEST(xeus_sqlite_interpreter, parameters_check)
+{
+    EXPECT_EQ(parameter_value::parse("42").kind, parameter_value::kind_type::integer);
+    EXPECT_EQ(parameter_value::parse("-1.5e3").real, -1500.);
+    EXPECT_EQ(parameter_value::parse("null").kind, parameter_value::kind_type::null);
+    EXPECT_EQ(parameter_value::parse("'it''s'").text, "it's");
+    EXPECT_EQ(parameter_value::parse("X'CAFE'").text, "\xCA\xFE");
+    EXPECT_EQ(parameter_value::parse("nan").kind, parameter_value::kind_type::text);
+    EXPECT_EQ(parameter_value::parse("'it''s'").to_sql(), "'it''s'");
+
+    SQLite::Database db(":memory:", SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    session_parameters parameters;
+    parameters.set("lo", parameter_value::parse("2"));
+    parameters.set("name", parameter_value::parse("'x'"));
+    parameters.set("5", parameter_value::parse("1.5"));
+
+    /* $name and @name are two parameters reading name, ?5 skips 4 */
+    SQLite::Statement query(db, "SELECT :lo + 1, $name || @name, ?5");
+    parameters.bind(query);
+    ASSERT_TRUE(query.executeStep());
+    EXPECT_EQ(query.getColumn(0).getInt64(), 3);
+    EXPECT_EQ(query.getColumn(1).getString(), "xx");
+    EXPECT_EQ(query.getColumn(2).getDouble(), 1.5);
+
+    /* The same statement is reused with other values */
+    parameters.set("lo", parameter_value::parse("10"));
+    query.reset();
+    parameters.bind(query);
+    ASSERT_TRUE(query.executeStep());
+    EXPECT_EQ(query.getColumn(0).getInt64(), 11);
+
+    SQLite::Statement missing(db, "SELECT :other");
+    EXPECT_THROW(parameters.bind(missing), std::runtime_error);
+
+    /* A copy of a statement with the same SQL is bound on its own */
+    SQLite::Statement copy(db, "SELECT :lo + 1, $name || @name, ?5");
+    parameters.set("lo", parameter_value::parse("20"));
+    query.reset();
+    parameters.bind(query);
+    ASSERT_TRUE(query.executeStep());
+    EXPECT_EQ(query.getColumn(0).getInt64(), 21);
+    ASSERT_TRUE(copy.executeStep());
+    EXPECT_TRUE(copy.getColumn(0).isNull());
+
+    /* %SET keeps the whitespace of its value */
+    {
+        test_interpreter interp;
+        interp.execute("%CREATE parameters_check.db");
+        EXPECT_EQ(interp.execute("%SET :s 'a  b'\n")["status"], "ok");
+        interp.execute("SELECT length(:s) AS len, :s = 'a  b' AS same");
+        EXPECT_NE(interp.last_result().find("| 4 "), std::string::npos);
+        EXPECT_NE(interp.last_result().find("| 1 "), std::string::npos);
+        EXPECT_EQ(interp.execute("%SET s")["status"], "error");
+    }
+    std::remove("parameters_check.db");
+}
+
 // TEST(xeus_sqlite_interpreter, is_magic_check)
 // {
 //     std::string code = "%LOAD database.db rw";